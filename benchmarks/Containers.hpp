@@ -0,0 +1,334 @@
+#ifndef BENCHMARK_CONTAINERS_HPP
+#define BENCHMARK_CONTAINERS_HPP
+
+#include "HugePages.hpp"
+#include "Map.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef BPLUS_BENCH_HAVE_ABSL
+#include <absl/container/btree_map.h>
+#endif
+
+/// @brief Bytes currently allocated through every CountingAllocator
+inline size_t g_allocated_bytes = 0;
+
+/**
+ * @struct CountingAllocator
+ * @brief std::allocator that keeps track of the bytes in use
+ * @details Used by every benchmarked container so that bytes/element compares
+ * node and value storage alike. Heap memory owned by the keys themselves,
+ * e.g. long strings, is not counted.
+ * */
+template <typename T> struct CountingAllocator {
+  using value_type = T;
+
+  CountingAllocator() = default;
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U> & /*other*/) noexcept {}
+
+  T *allocate(size_t count) {
+    g_allocated_bytes += count * sizeof(T);
+    return std::allocator<T>{}.allocate(count);
+  }
+
+  void deallocate(T *pointer, size_t count) noexcept {
+    g_allocated_bytes -= count * sizeof(T);
+    std::allocator<T>{}.deallocate(pointer, count);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U> & /*other*/) const noexcept {
+    return true;
+  }
+};
+
+/**
+ * @struct CountingHugePageAllocator
+ * @brief HugePageAllocator that keeps track of the bytes in use
+ * */
+template <typename T> struct CountingHugePageAllocator : HugePageAllocator<T> {
+  using value_type = T;
+
+  CountingHugePageAllocator() = default;
+  template <typename U>
+  CountingHugePageAllocator(
+      const CountingHugePageAllocator<U> & /*other*/) noexcept {}
+
+  T *allocate(size_t count) {
+    g_allocated_bytes += count * sizeof(T);
+    return HugePageAllocator<T>::allocate(count);
+  }
+
+  void deallocate(T *pointer, size_t count) noexcept {
+    g_allocated_bytes -= count * sizeof(T);
+    HugePageAllocator<T>::deallocate(pointer, count);
+  }
+};
+
+// *** Keys *** //
+
+/// @brief Scrambles index into a 62 bit value, splitmix64 finalizer
+inline uint64_t scramble(uint64_t index) {
+  index += 0x9e3779b97f4a7c15ULL;
+  index = (index ^ (index >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+  index = (index ^ (index >> 27U)) * 0x94d049bb133111ebULL;
+  return (index ^ (index >> 31U)) >> 2U;
+}
+
+template <typename Key> Key make_key(uint64_t value);
+
+template <> inline int64_t make_key<int64_t>(uint64_t value) {
+  return static_cast<int64_t>(value);
+}
+
+/// @brief Fixed width strings sort like the numbers they encode, 20
+/// characters do not fit the small string buffer
+template <> inline std::string make_key<std::string>(uint64_t value) {
+  char buffer[21];
+  std::snprintf(buffer, sizeof(buffer), "key-%016llx",
+                static_cast<unsigned long long>(value));
+  return buffer;
+}
+
+/// @brief Keys that are stored, the even values, in random order
+template <typename Key> std::vector<Key> hit_keys(size_t count) {
+  std::vector<Key> keys;
+  keys.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    keys.push_back(make_key<Key>(scramble(i) & ~1ULL));
+  }
+  return keys;
+}
+
+/// @brief Keys that are never stored, the odd values, in random order
+template <typename Key> std::vector<Key> miss_keys(size_t count) {
+  std::vector<Key> keys;
+  keys.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    keys.push_back(make_key<Key>(scramble(i + count) | 1ULL));
+  }
+  return keys;
+}
+
+// *** Containers *** //
+
+/**
+ * @class OrderedAdapter
+ * @brief Benchmark interface over a std::map like container
+ * */
+template <typename Container> class OrderedAdapter {
+public:
+  using key_type = typename Container::key_type;
+
+  bool insert(const key_type &key, uint64_t value) {
+    return m_container.insert({key, value}).second;
+  }
+
+  size_t erase(const key_type &key) { return m_container.erase(key); }
+
+  [[nodiscard]] bool contains(const key_type &key) const {
+    return m_container.contains(key);
+  }
+
+  [[nodiscard]] uint64_t lower_bound(const key_type &key) const {
+    auto it = m_container.lower_bound(key);
+    return it == m_container.end() ? 0 : it->second;
+  }
+
+  /// @brief Sums count values from the first key not less than key
+  [[nodiscard]] uint64_t sum_range(const key_type &key, size_t count) const {
+    uint64_t sum = 0;
+    for (auto it = m_container.lower_bound(key);
+         it != m_container.end() && count > 0; ++it, --count) {
+      sum += it->second;
+    }
+    return sum;
+  }
+
+  [[nodiscard]] uint64_t sum_all() const {
+    uint64_t sum = 0;
+    for (const auto &value : m_container) {
+      sum += value.second;
+    }
+    return sum;
+  }
+
+  [[nodiscard]] size_t size() const { return m_container.size(); }
+
+private:
+  Container m_container;
+};
+
+template <typename Search> struct SearchTraits : DefaultTraits {
+  using node_search = Search;
+};
+
+template <size_t M, typename Key, typename Search = LinearSearch>
+struct BPlusMap
+    : OrderedAdapter<Map<M, Key, uint64_t, std::less<Key>,
+                         CountingAllocator<std::pair<const Key, uint64_t>>,
+                         SearchTraits<Search>>> {
+  static constexpr bool C_RANDOM_WRITES = true;
+};
+
+template <typename Key> struct FingerprintTraits : DefaultTraits {
+  using leaf_fingerprint = HashFingerprint<std::hash<Key>>;
+};
+
+template <size_t M, typename Key>
+struct FingerprintBPlusMap
+    : OrderedAdapter<Map<M, Key, uint64_t, std::less<Key>,
+                         CountingAllocator<std::pair<const Key, uint64_t>>,
+                         FingerprintTraits<Key>>> {
+  static constexpr bool C_RANDOM_WRITES = true;
+};
+
+template <typename Key> struct IndexedTraits : DefaultTraits {
+  using point_index = HashPointIndex<std::hash<Key>>;
+};
+
+template <size_t M, typename Key>
+struct IndexedBPlusMap
+    : OrderedAdapter<Map<M, Key, uint64_t, std::less<Key>,
+                         CountingAllocator<std::pair<const Key, uint64_t>>,
+                         IndexedTraits<Key>>> {
+  static constexpr bool C_RANDOM_WRITES = true;
+};
+
+template <size_t M, typename Key>
+struct HugePageBPlusMap
+    : OrderedAdapter<
+          Map<M, Key, uint64_t, std::less<Key>,
+              CountingHugePageAllocator<std::pair<const Key, uint64_t>>>> {
+  static constexpr bool C_RANDOM_WRITES = true;
+};
+
+template <typename Key>
+struct StdMap
+    : OrderedAdapter<
+          std::map<Key, uint64_t, std::less<Key>,
+                   CountingAllocator<std::pair<const Key, uint64_t>>>> {
+  static constexpr bool C_RANDOM_WRITES = true;
+};
+
+#ifdef BPLUS_BENCH_HAVE_ABSL
+template <typename Key>
+struct AbslBtreeMap
+    : OrderedAdapter<absl::btree_map<
+          Key, uint64_t, std::less<Key>,
+          CountingAllocator<std::pair<const Key, uint64_t>>>> {
+  static constexpr bool C_RANDOM_WRITES = true;
+};
+#endif
+
+/**
+ * @class SortedVector
+ * @brief Sorted std::vector of pairs, the lower bound for read only workloads
+ * @details Random insertion and erasure are O(n) per element, so the write
+ * benchmarks skip it.
+ * */
+template <typename Key> class SortedVector {
+public:
+  using key_type = Key;
+  static constexpr bool C_RANDOM_WRITES = false;
+
+  bool insert(const key_type &key, uint64_t value) {
+    auto it = find_position(key);
+    if (it != m_values.end() && it->first == key) {
+      return false;
+    }
+    m_values.insert(it, {key, value});
+    return true;
+  }
+
+  size_t erase(const key_type &key) {
+    auto it = find_position(key);
+    if (it == m_values.end() || it->first != key) {
+      return 0;
+    }
+    m_values.erase(it);
+    return 1;
+  }
+
+  [[nodiscard]] bool contains(const key_type &key) const {
+    auto it = find_position(key);
+    return it != m_values.end() && it->first == key;
+  }
+
+  [[nodiscard]] uint64_t lower_bound(const key_type &key) const {
+    auto it = find_position(key);
+    return it == m_values.end() ? 0 : it->second;
+  }
+
+  [[nodiscard]] uint64_t sum_range(const key_type &key, size_t count) const {
+    uint64_t sum = 0;
+    for (auto it = find_position(key); it != m_values.end() && count > 0;
+         ++it, --count) {
+      sum += it->second;
+    }
+    return sum;
+  }
+
+  [[nodiscard]] uint64_t sum_all() const {
+    uint64_t sum = 0;
+    for (const auto &value : m_values) {
+      sum += value.second;
+    }
+    return sum;
+  }
+
+  [[nodiscard]] size_t size() const { return m_values.size(); }
+
+  /// @brief Builds the vector from unsorted keys in O(n log n)
+  void assign(const std::vector<key_type> &keys) {
+    m_values.clear();
+    m_values.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      m_values.emplace_back(keys[i], i);
+    }
+    std::sort(m_values.begin(), m_values.end());
+  }
+
+private:
+  using value_type = std::pair<key_type, uint64_t>;
+
+  auto find_position(const key_type &key) const {
+    return std::lower_bound(
+        m_values.begin(), m_values.end(), key,
+        [](const value_type &value, const key_type &k) {
+          return value.first < k;
+        });
+  }
+  auto find_position(const key_type &key) {
+    return std::lower_bound(
+        m_values.begin(), m_values.end(), key,
+        [](const value_type &value, const key_type &k) {
+          return value.first < k;
+        });
+  }
+
+  std::vector<value_type, CountingAllocator<value_type>> m_values;
+};
+
+/// @brief Fills container with keys, the value of keys[i] is i
+template <typename Container>
+void fill(Container &container,
+          const std::vector<typename Container::key_type> &keys) {
+  if constexpr (Container::C_RANDOM_WRITES) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      container.insert(keys[i], i);
+    }
+  } else {
+    container.assign(keys);
+  }
+}
+
+#endif // !BENCHMARK_CONTAINERS_HPP
@@ -0,0 +1,100 @@
+#ifndef BENCHMARK_PERF_COUNTERS_HPP
+#define BENCHMARK_PERF_COUNTERS_HPP
+
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @class PerfCounter
+ * @brief Hardware event counted for the calling thread
+ * @details Opened through perf_event_open on Linux. When the kernel, the
+ * PMU or the permissions (kernel.perf_event_paranoid) do not allow the
+ * event, available() is false and the counter reads as zero, so benchmarks
+ * simply omit it.
+ * */
+class PerfCounter {
+public:
+  PerfCounter(uint32_t type, uint64_t config) {
+#if defined(__linux__)
+    perf_event_attr attributes{};
+    attributes.type = type;
+    attributes.size = sizeof(attributes);
+    attributes.config = config;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    m_fd = static_cast<int>(
+        syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#else
+    (void)type;
+    (void)config;
+#endif
+  }
+
+  PerfCounter(const PerfCounter &) = delete;
+  PerfCounter &operator=(const PerfCounter &) = delete;
+
+  ~PerfCounter() {
+#if defined(__linux__)
+    if (available()) {
+      close(m_fd);
+    }
+#endif
+  }
+
+  [[nodiscard]] bool available() const noexcept { return m_fd >= 0; }
+
+  void start() {
+#if defined(__linux__)
+    if (available()) {
+      ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  /// @brief Stops counting and returns the events since start()
+  uint64_t stop() {
+    uint64_t count = 0;
+#if defined(__linux__)
+    if (available()) {
+      ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(m_fd, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+#endif
+    return count;
+  }
+
+  /// @brief Last level cache misses
+  static PerfCounter llc_misses() {
+#if defined(__linux__)
+    return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES};
+#else
+    return {0, 0};
+#endif
+  }
+
+  /// @brief Data TLB misses of loads, each one costs a page walk
+  static PerfCounter dtlb_misses() {
+#if defined(__linux__)
+    return {PERF_TYPE_HW_CACHE,
+            PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8U) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16U)};
+#else
+    return {0, 0};
+#endif
+  }
+
+private:
+  int m_fd = -1;
+};
+
+#endif // !BENCHMARK_PERF_COUNTERS_HPP
@@ -0,0 +1,339 @@
+#include <benchmark/benchmark.h>
+
+#include "Containers.hpp"
+#include "PerfCounters.hpp"
+
+#include <algorithm>
+#include <random>
+
+#ifndef BPLUS_BENCH_MAX_SIZE
+#define BPLUS_BENCH_MAX_SIZE 100000000
+#endif
+
+/*
+ * Every benchmark reports
+ *   items_per_second  operations per second
+ *   time/op           seconds per operation
+ *   bytes/element     memory allocated by the container per stored element
+ *   LLC-misses/op     last level cache misses, only when perf is available
+ *   dTLB-misses/op    data TLB misses of loads, only when perf is available
+ */
+
+namespace {
+
+/// @brief Sizes from 1K up to BPLUS_BENCH_MAX_SIZE, growing tenfold
+void sizes(benchmark::internal::Benchmark *benchmark) {
+  for (int64_t size = 1000; size <= BPLUS_BENCH_MAX_SIZE; size *= 10) {
+    benchmark->Arg(size);
+  }
+}
+
+/// @brief Sizes combined with the percentage of writes of mixed workloads
+void mixed_sizes(benchmark::internal::Benchmark *benchmark) {
+  for (int64_t size = 1000; size <= BPLUS_BENCH_MAX_SIZE; size *= 10) {
+    for (int64_t writes : {5, 50}) {
+      benchmark->Args({size, writes});
+    }
+  }
+}
+
+/**
+ * @class Measure
+ * @brief Collects the counters shared by every benchmark
+ * */
+class Measure {
+public:
+  explicit Measure(benchmark::State &state)
+      : m_state(state), m_llc(PerfCounter::llc_misses()),
+        m_dtlb(PerfCounter::dtlb_misses()) {
+    m_llc.start();
+    m_dtlb.start();
+  }
+
+  Measure(const Measure &) = delete;
+  Measure &operator=(const Measure &) = delete;
+
+  ~Measure() {
+    const auto misses = m_llc.stop();
+    const auto tlb_misses = m_dtlb.stop();
+    m_state.SetItemsProcessed(static_cast<int64_t>(m_operations));
+    m_state.counters["time/op"] = benchmark::Counter(
+        static_cast<double>(m_operations),
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    if (m_llc.available() && m_operations > 0) {
+      m_state.counters["LLC-misses/op"] =
+          static_cast<double>(misses) / static_cast<double>(m_operations);
+    }
+    if (m_dtlb.available() && m_operations > 0) {
+      m_state.counters["dTLB-misses/op"] =
+          static_cast<double>(tlb_misses) / static_cast<double>(m_operations);
+    }
+    if (m_elements > 0) {
+      m_state.counters["bytes/element"] =
+          static_cast<double>(m_bytes) / static_cast<double>(m_elements);
+    }
+  }
+
+  void operations(size_t count) { m_operations += count; }
+
+  /// @brief Records the memory held by a container of elements values
+  void footprint(size_t bytes, size_t elements) {
+    m_bytes = bytes;
+    m_elements = elements;
+  }
+
+private:
+  benchmark::State &m_state;
+  PerfCounter m_llc;
+  PerfCounter m_dtlb;
+  size_t m_operations = 0;
+  size_t m_bytes = 0;
+  size_t m_elements = 0;
+};
+
+/// @brief Container filled with hit_keys(size), built outside of timing
+template <typename Container> struct Filled {
+  explicit Filled(size_t size)
+      : keys(hit_keys<typename Container::key_type>(size)) {
+    const auto before = g_allocated_bytes;
+    fill(container, keys);
+    bytes = g_allocated_bytes - before;
+  }
+
+  std::vector<typename Container::key_type> keys;
+  Container container;
+  size_t bytes = 0;
+};
+
+// *** Writes *** //
+
+template <typename Container>
+void build(benchmark::State &state, bool sequential) {
+  const auto size = static_cast<size_t>(state.range(0));
+  auto keys = hit_keys<typename Container::key_type>(size);
+  if (sequential) {
+    std::sort(keys.begin(), keys.end());
+  }
+
+  Measure measure(state);
+  for (auto _ : state) {
+    const auto before = g_allocated_bytes;
+    {
+      Container container;
+      for (size_t i = 0; i < size; ++i) {
+        container.insert(keys[i], i);
+      }
+      measure.footprint(g_allocated_bytes - before, container.size());
+      state.PauseTiming();
+    }
+    state.ResumeTiming();
+    measure.operations(size);
+  }
+}
+
+template <typename Container> void InsertRandom(benchmark::State &state) {
+  build<Container>(state, false);
+}
+
+template <typename Container> void InsertSequential(benchmark::State &state) {
+  build<Container>(state, true);
+}
+
+template <typename Container> void Erase(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto keys = hit_keys<typename Container::key_type>(size);
+
+  Measure measure(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    {
+      const auto before = g_allocated_bytes;
+      Container container;
+      fill(container, keys);
+      measure.footprint(g_allocated_bytes - before, size);
+      state.ResumeTiming();
+      for (const auto &key : keys) {
+        container.erase(key);
+      }
+      state.PauseTiming();
+    }
+    state.ResumeTiming();
+    measure.operations(size);
+  }
+}
+
+template <typename Container> void Mixed(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto writes = static_cast<uint64_t>(state.range(1));
+  Filled<Container> filled(size);
+  const auto misses = miss_keys<typename Container::key_type>(size);
+
+  // Writes toggle keys that are not part of the initial contents, so the
+  // size stays around the initial one
+  std::mt19937_64 generator(42);
+  Measure measure(state);
+  measure.footprint(filled.bytes, size);
+  size_t index = 0;
+  for (auto _ : state) {
+    const auto random = generator();
+    if (random % 100 < writes) {
+      const auto &key = misses[index];
+      if (!filled.container.insert(key, index)) {
+        filled.container.erase(key);
+      }
+    } else {
+      benchmark::DoNotOptimize(filled.container.contains(filled.keys[index]));
+    }
+    index = index + 1 == size ? 0 : index + 1;
+    measure.operations(1);
+  }
+}
+
+// *** Reads *** //
+
+template <typename Container> void FindHit(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  Filled<Container> filled(size);
+
+  Measure measure(state);
+  measure.footprint(filled.bytes, size);
+  size_t index = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(filled.container.contains(filled.keys[index]));
+    index = index + 1 == size ? 0 : index + 1;
+    measure.operations(1);
+  }
+}
+
+template <typename Container> void FindMiss(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  Filled<Container> filled(size);
+  const auto misses = miss_keys<typename Container::key_type>(size);
+
+  Measure measure(state);
+  measure.footprint(filled.bytes, size);
+  size_t index = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(filled.container.contains(misses[index]));
+    index = index + 1 == size ? 0 : index + 1;
+    measure.operations(1);
+  }
+}
+
+template <typename Container> void LowerBound(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  Filled<Container> filled(size);
+  const auto misses = miss_keys<typename Container::key_type>(size);
+
+  Measure measure(state);
+  measure.footprint(filled.bytes, size);
+  size_t index = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(filled.container.lower_bound(misses[index]));
+    index = index + 1 == size ? 0 : index + 1;
+    measure.operations(1);
+  }
+}
+
+template <typename Container> void IterateFull(benchmark::State &state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  Filled<Container> filled(size);
+
+  Measure measure(state);
+  measure.footprint(filled.bytes, size);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(filled.container.sum_all());
+    measure.operations(size);
+  }
+}
+
+/// @brief lower_bound followed by a scan of 100 elements
+template <typename Container> void IterateRange(benchmark::State &state) {
+  constexpr size_t C_RANGE = 100;
+  const auto size = static_cast<size_t>(state.range(0));
+  Filled<Container> filled(size);
+  const auto misses = miss_keys<typename Container::key_type>(size);
+
+  Measure measure(state);
+  measure.footprint(filled.bytes, size);
+  size_t index = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        filled.container.sum_range(misses[index], C_RANGE));
+    index = index + 1 == size ? 0 : index + 1;
+    measure.operations(C_RANGE);
+  }
+}
+
+} // namespace
+
+// *** Registration *** //
+
+#define BPLUS_READ_BENCHMARKS(...)                                             \
+  BENCHMARK_TEMPLATE(FindHit, __VA_ARGS__)->Apply(sizes);                      \
+  BENCHMARK_TEMPLATE(FindMiss, __VA_ARGS__)->Apply(sizes);                     \
+  BENCHMARK_TEMPLATE(LowerBound, __VA_ARGS__)->Apply(sizes);                   \
+  BENCHMARK_TEMPLATE(IterateFull, __VA_ARGS__)->Apply(sizes);                  \
+  BENCHMARK_TEMPLATE(IterateRange, __VA_ARGS__)->Apply(sizes)
+
+#define BPLUS_WRITE_BENCHMARKS(...)                                            \
+  BENCHMARK_TEMPLATE(InsertRandom, __VA_ARGS__)->Apply(sizes);                 \
+  BENCHMARK_TEMPLATE(InsertSequential, __VA_ARGS__)->Apply(sizes);             \
+  BENCHMARK_TEMPLATE(Erase, __VA_ARGS__)->Apply(sizes);                        \
+  BENCHMARK_TEMPLATE(Mixed, __VA_ARGS__)->Apply(mixed_sizes)
+
+#define BPLUS_ALL_BENCHMARKS(...)                                              \
+  BPLUS_READ_BENCHMARKS(__VA_ARGS__);                                          \
+  BPLUS_WRITE_BENCHMARKS(__VA_ARGS__)
+
+// B+ tree order sweep
+BPLUS_ALL_BENCHMARKS(BPlusMap<8, int64_t>);
+BPLUS_ALL_BENCHMARKS(BPlusMap<16, int64_t>);
+BPLUS_ALL_BENCHMARKS(BPlusMap<64, int64_t>);
+BPLUS_ALL_BENCHMARKS(BPlusMap<256, int64_t>);
+BPLUS_ALL_BENCHMARKS(BPlusMap<8, std::string>);
+BPLUS_ALL_BENCHMARKS(BPlusMap<16, std::string>);
+BPLUS_ALL_BENCHMARKS(BPlusMap<64, std::string>);
+BPLUS_ALL_BENCHMARKS(BPlusMap<256, std::string>);
+
+// In-node search policies for page sized nodes, against the linear scan of
+// the sweep above
+BPLUS_READ_BENCHMARKS(BPlusMap<256, int64_t, BranchlessSearch>);
+BPLUS_READ_BENCHMARKS(BPlusMap<256, int64_t, CountingSearch>);
+BPLUS_READ_BENCHMARKS(BPlusMap<512, int64_t>);
+BPLUS_READ_BENCHMARKS(BPlusMap<512, int64_t, BranchlessSearch>);
+BPLUS_READ_BENCHMARKS(BPlusMap<512, int64_t, CountingSearch>);
+BPLUS_READ_BENCHMARKS(BPlusMap<256, int64_t, InterpolationSearch>);
+BPLUS_READ_BENCHMARKS(BPlusMap<512, int64_t, InterpolationSearch>);
+BPLUS_READ_BENCHMARKS(BPlusMap<256, std::string, BranchlessSearch>);
+BPLUS_WRITE_BENCHMARKS(BPlusMap<512, int64_t, BranchlessSearch>);
+BPLUS_WRITE_BENCHMARKS(BPlusMap<512, int64_t, InterpolationSearch>);
+
+// Leaf fingerprints, which only change point lookups
+BENCHMARK_TEMPLATE(FindHit, FingerprintBPlusMap<64, int64_t>)->Apply(sizes);
+BENCHMARK_TEMPLATE(FindMiss, FingerprintBPlusMap<64, int64_t>)->Apply(sizes);
+BENCHMARK_TEMPLATE(FindHit, FingerprintBPlusMap<64, std::string>)
+    ->Apply(sizes);
+BENCHMARK_TEMPLATE(FindMiss, FingerprintBPlusMap<64, std::string>)
+    ->Apply(sizes);
+
+// Hash point index, which speeds up point lookups and slows down writes
+BPLUS_ALL_BENCHMARKS(IndexedBPlusMap<64, int64_t>);
+BPLUS_ALL_BENCHMARKS(IndexedBPlusMap<64, std::string>);
+
+// Nodes and values carved out of 2 MiB slabs, against the sweep above
+BPLUS_ALL_BENCHMARKS(HugePageBPlusMap<64, int64_t>);
+BPLUS_ALL_BENCHMARKS(HugePageBPlusMap<256, int64_t>);
+BPLUS_READ_BENCHMARKS(HugePageBPlusMap<64, std::string>);
+
+// Baselines
+BPLUS_ALL_BENCHMARKS(StdMap<int64_t>);
+BPLUS_ALL_BENCHMARKS(StdMap<std::string>);
+BPLUS_READ_BENCHMARKS(SortedVector<int64_t>);
+BPLUS_READ_BENCHMARKS(SortedVector<std::string>);
+#ifdef BPLUS_BENCH_HAVE_ABSL
+BPLUS_ALL_BENCHMARKS(AbslBtreeMap<int64_t>);
+BPLUS_ALL_BENCHMARKS(AbslBtreeMap<std::string>);
+#endif
+
+BENCHMARK_MAIN();
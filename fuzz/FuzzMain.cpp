@@ -0,0 +1,59 @@
+/*
+ * Driver for toolchains without libFuzzer. Runs random inputs, or replays
+ * the files given as arguments, e.g. crashes reported by libFuzzer.
+ *   treeFuzzer [-runs=N] [-seed=S] [file...]
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int main(int argc, char **argv) {
+  unsigned long runs = 1000;
+  unsigned long seed = 1;
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string argument = argv[i];
+    if (argument.rfind("-runs=", 0) == 0) {
+      runs = std::stoul(argument.substr(6));
+    } else if (argument.rfind("-seed=", 0) == 0) {
+      seed = std::stoul(argument.substr(6));
+    } else {
+      files.push_back(argument);
+    }
+  }
+
+  for (const auto &file : files) {
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream) {
+      std::cerr << "Cant open " << file << '\n';
+      return EXIT_FAILURE;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)),
+                              std::istreambuf_iterator<char>());
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+  }
+  if (!files.empty()) {
+    return EXIT_SUCCESS;
+  }
+
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<size_t> length(0, 4096);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<uint8_t> data;
+  for (unsigned long run = 0; run < runs; ++run) {
+    data.resize(length(generator));
+    for (auto &value : data) {
+      value = static_cast<uint8_t>(byte(generator));
+    }
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+  }
+  return EXIT_SUCCESS;
+}
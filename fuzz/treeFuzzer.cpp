@@ -0,0 +1,276 @@
+/*
+ * Differential fuzz target: replays the operations encoded in the input on
+ * several tree configurations and on std::map, validating the tree and
+ * comparing both containers after every step.
+ */
+#include "Map.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct LazyTraits : DefaultTraits {
+  static constexpr size_t lazy_delete_threshold = 1;
+};
+
+struct CountedTraits : DefaultTraits {
+  using augmentation = SubtreeSize;
+};
+
+template <typename Search> struct SearchTraits : DefaultTraits {
+  using node_search = Search;
+};
+
+struct FingerprintTraits : DefaultTraits {
+  using leaf_fingerprint = HashFingerprint<std::hash<int>>;
+};
+
+struct IndexedTraits : DefaultTraits {
+  using point_index = HashPointIndex<std::hash<int>>;
+};
+
+template <size_t M, typename Traits = DefaultTraits>
+using TraitsMap =
+    Map<M, int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+        Traits>;
+
+using Oracle = std::map<int, int>;
+
+/// @brief Reads the input byte by byte, zeroes once it is exhausted
+class Input {
+public:
+  Input(const uint8_t *data, size_t size) : m_data(data), m_size(size) {}
+
+  [[nodiscard]] bool empty() const noexcept { return m_position >= m_size; }
+
+  uint8_t byte() noexcept {
+    return m_position < m_size ? m_data[m_position++] : 0;
+  }
+
+  /// @brief Key in [0, 512), small enough for frequent collisions
+  int key() noexcept {
+    const auto high = static_cast<unsigned>(byte());
+    return static_cast<int>(((high << 8U) | byte()) % 512U);
+  }
+
+private:
+  const uint8_t *m_data;
+  size_t m_size;
+  size_t m_position = 0;
+};
+
+void expect(bool holds, const char *what) {
+  if (!holds) {
+    throw std::logic_error(what);
+  }
+}
+
+template <typename Tree>
+void expect_same(const Tree &tree, const Oracle &oracle) {
+  tree.validate();
+  expect(tree.size() == oracle.size(), "size differs from std::map");
+  expect(std::equal(tree.begin(), tree.end(), oracle.begin(), oracle.end()),
+         "contents differ from std::map");
+}
+
+template <typename Snapshot>
+void expect_unchanged(const Snapshot &snapshot, const Oracle &oracle) {
+  expect(snapshot.size() == oracle.size() &&
+             std::equal(snapshot.begin(), snapshot.end(), oracle.begin(),
+                        oracle.end()),
+         "snapshot sees a later write");
+}
+
+/// @brief Replicas follow the insertions and erasures, values written in
+/// place may lag behind in leaves copied for a snapshot
+template <typename Snapshot>
+void expect_replica(const Snapshot &replica, const Oracle &oracle) {
+  expect(replica.size() == oracle.size() &&
+             std::equal(replica.begin(), replica.end(), oracle.begin(),
+                        oracle.end(),
+                        [](const auto &value, const auto &expected) {
+                          return value.first == expected.first;
+                        }),
+         "replica misses a write");
+  for (const auto &[key, value] : oracle) {
+    expect(replica.contains(key), "replica misses a write");
+  }
+}
+
+template <typename Tree> void run(const uint8_t *data, size_t size) {
+  Tree tree;
+  Oracle oracle;
+  Input input(data, size);
+  // Resumed across the other operations, like a background compaction
+  typename Tree::Compaction compaction;
+  // Snapshots taken along the way, with the contents they must keep
+  std::vector<std::pair<typename Tree::Snapshot, Oracle>> versions;
+  // Replica following every write, while enabled
+  typename Tree::Snapshot replica;
+  bool replicated = false;
+
+  while (!input.empty()) {
+    const auto operation = input.byte() % 11;
+    const auto key = input.key();
+
+    switch (operation) {
+    case 0:
+    case 1:
+    case 2: {
+      const int value = input.byte();
+      const auto inserted = tree.insert({key, value}).second;
+      expect(inserted == oracle.insert({key, value}).second,
+             "insert result differs");
+      break;
+    }
+    case 3:
+      expect(tree.erase(key) == oracle.erase(key), "erase result differs");
+      break;
+    case 4: {
+      auto it = tree.find(key);
+      expect((it == tree.end()) == !oracle.contains(key), "find differs");
+      if (it != tree.end()) {
+        auto next = tree.erase(it);
+        auto oracle_next = oracle.erase(oracle.find(key));
+        expect((next == tree.end()) == (oracle_next == oracle.end()),
+               "erase(iterator) result differs");
+        expect(next == tree.end() || next->first == oracle_next->first,
+               "erase(iterator) result differs");
+      }
+      break;
+    }
+    case 5: {
+      auto high = input.key();
+      auto low = std::min(key, high);
+      high = std::max(key, high);
+      tree.erase(tree.lower_bound(low), tree.lower_bound(high));
+      oracle.erase(oracle.lower_bound(low), oracle.lower_bound(high));
+      break;
+    }
+    case 6: {
+      Tree upper;
+      tree.split(key, upper);
+      expect(upper.empty() || !(upper.begin()->first < key), "split leaks");
+      tree.validate();
+      upper.validate();
+      expect(tree.size() + upper.size() == oracle.size(), "split loses keys");
+      if (input.byte() % 2 == 0) {
+        tree.join(upper);
+      } else {
+        upper.join(tree);
+        tree.swap(upper);
+      }
+      break;
+    }
+    case 7:
+      if (tree.compact(compaction, static_cast<size_t>(key) % 8 + 1)) {
+        compaction = {};
+      }
+      break;
+    case 8: {
+      // Snapshots interleaved with the writes that copy shared nodes
+      const int value = input.byte();
+      switch (input.byte() % 5) {
+      case 0:
+        if (versions.size() < 4) {
+          versions.emplace_back(tree.snapshot(), oracle);
+        }
+        break;
+      case 1:
+        if (!versions.empty()) {
+          versions.erase(versions.begin());
+        }
+        break;
+      case 2: {
+        // Writes through iterators stepping over several leaves, forward
+        // from key or backward from end()
+        auto steps = value % 16;
+        if (value % 2 == 0) {
+          auto it = tree.lower_bound(key);
+          for (auto at = oracle.lower_bound(key);
+               steps > 0 && at != oracle.end(); --steps, ++it, ++at) {
+            it->second = value;
+            at->second = value;
+          }
+        } else {
+          auto it = tree.end();
+          for (auto at = oracle.end(); steps > 0 && at != oracle.begin();
+               --steps) {
+            (--it)->second = value;
+            (--at)->second = value;
+          }
+        }
+        break;
+      }
+      case 3:
+        replicated = !replicated;
+        if (replicated) {
+          replica = tree.replica(tree.get_allocator());
+          tree.on_write([&tree, &replica](const int *written) {
+            replica = tree.replica(tree.get_allocator(), replica, written);
+          });
+        } else {
+          tree.on_write(nullptr);
+          replica = {};
+        }
+        break;
+      default:
+        tree[key] = value;
+        oracle[key] = value;
+        break;
+      }
+      break;
+    }
+    default: {
+      expect(tree.contains(key) == oracle.contains(key), "contains differs");
+      auto lower = tree.lower_bound(key);
+      auto oracle_lower = oracle.lower_bound(key);
+      expect((lower == tree.end()) == (oracle_lower == oracle.end()),
+             "lower_bound differs");
+      expect(lower == tree.end() || *lower == *oracle_lower,
+             "lower_bound differs");
+      auto upper = tree.upper_bound(key);
+      auto oracle_upper = oracle.upper_bound(key);
+      expect((upper == tree.end()) == (oracle_upper == oracle.end()),
+             "upper_bound differs");
+      expect(upper == tree.end() || *upper == *oracle_upper,
+             "upper_bound differs");
+      if constexpr (SizedAugmentation<typename Tree::augmentation>) {
+        expect(tree.rank(key) ==
+                   static_cast<size_t>(std::distance(oracle.begin(),
+                                                     oracle_lower)),
+               "rank differs");
+      }
+      break;
+    }
+    }
+    expect_same(tree, oracle);
+    for (const auto &[snapshot, contents] : versions) {
+      expect_unchanged(snapshot, contents);
+    }
+    if (replicated) {
+      expect_replica(replica, oracle);
+    }
+  }
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  run<TraitsMap<3>>(data, size);
+  run<TraitsMap<4, LazyTraits>>(data, size);
+  run<TraitsMap<8, CountedTraits>>(data, size);
+  run<TraitsMap<5, SearchTraits<BranchlessSearch>>>(data, size);
+  run<TraitsMap<16, SearchTraits<CountingSearch>>>(data, size);
+  run<TraitsMap<6, SearchTraits<InterpolationSearch>>>(data, size);
+  run<TraitsMap<4, FingerprintTraits>>(data, size);
+  run<TraitsMap<3, IndexedTraits>>(data, size);
+  return 0;
+}
@@ -0,0 +1,168 @@
+#ifndef AUGMENTATION_HPP
+#define AUGMENTATION_HPP
+
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+/// @defgroup Augmentation B+Tree augmentation policies
+/// @name Augmentation
+/// @brief Monoids whose per-child aggregates are cached in internal nodes
+/// @details
+/// An augmentation maps every element to an aggregate (`lift`) and folds
+/// aggregates with an associative `combine` whose neutral element is
+/// `identity`. Each InternalNode caches the aggregate of every child, which
+/// turns range folds, rank and select into O(M log n) descents.
+/// @{
+
+/**
+ * @brief Default augmentation: internal nodes cache nothing
+ * */
+struct NoAugmentation {
+  struct aggregate_type {};
+
+  static constexpr aggregate_type identity() noexcept { return {}; }
+
+  template <typename V>
+  static constexpr aggregate_type lift(const V & /*value*/) noexcept {
+    return {};
+  }
+
+  static constexpr aggregate_type combine(aggregate_type /*lhs*/,
+                                          aggregate_type /*rhs*/) noexcept {
+    return {};
+  }
+};
+
+/**
+ * @brief Concept for an augmentation monoid over the tree elements
+ * */
+template <typename A, typename value_type>
+concept Augmentation =
+    requires(const typename A::aggregate_type &agg, const value_type &value) {
+      { A::identity() } -> std::convertible_to<typename A::aggregate_type>;
+      { A::lift(value) } -> std::convertible_to<typename A::aggregate_type>;
+      {
+        A::combine(agg, agg)
+      } -> std::convertible_to<typename A::aggregate_type>;
+    };
+
+/**
+ * @brief Concept for an augmentation that knows its subtree element count
+ * @details Required by rank, select and range count.
+ * */
+template <typename A>
+concept SizedAugmentation = requires(const typename A::aggregate_type &agg) {
+  { A::size(agg) } -> std::convertible_to<std::size_t>;
+};
+
+template <typename A>
+inline constexpr bool is_augmented_v = !std::is_same_v<A, NoAugmentation>;
+
+/**
+ * @brief Subtree element counts
+ * */
+struct SubtreeSize {
+  using aggregate_type = std::size_t;
+
+  static constexpr aggregate_type identity() noexcept { return 0; }
+
+  template <typename V>
+  static constexpr aggregate_type lift(const V & /*value*/) noexcept {
+    return 1;
+  }
+
+  static constexpr aggregate_type combine(aggregate_type lhs,
+                                          aggregate_type rhs) noexcept {
+    return lhs + rhs;
+  }
+
+  static constexpr std::size_t size(aggregate_type agg) noexcept { return agg; }
+};
+
+/**
+ * @brief Sum of the mapped values, accumulated as R
+ * */
+template <typename R> struct MappedSum {
+  using aggregate_type = R;
+
+  static constexpr aggregate_type identity() { return R{}; }
+
+  template <typename V> static constexpr aggregate_type lift(const V &value) {
+    return static_cast<R>(value.second);
+  }
+
+  static constexpr aggregate_type combine(const R &lhs, const R &rhs) {
+    return lhs + rhs;
+  }
+};
+
+/**
+ * @brief Minimum of the mapped values, accumulated as R
+ * */
+template <typename R> struct MappedMin {
+  using aggregate_type = R;
+
+  static constexpr aggregate_type identity() {
+    return std::numeric_limits<R>::max();
+  }
+
+  template <typename V> static constexpr aggregate_type lift(const V &value) {
+    return static_cast<R>(value.second);
+  }
+
+  static constexpr aggregate_type combine(const R &lhs, const R &rhs) {
+    return rhs < lhs ? rhs : lhs;
+  }
+};
+
+/**
+ * @brief Maximum of the mapped values, accumulated as R
+ * */
+template <typename R> struct MappedMax {
+  using aggregate_type = R;
+
+  static constexpr aggregate_type identity() {
+    return std::numeric_limits<R>::lowest();
+  }
+
+  template <typename V> static constexpr aggregate_type lift(const V &value) {
+    return static_cast<R>(value.second);
+  }
+
+  static constexpr aggregate_type combine(const R &lhs, const R &rhs) {
+    return lhs < rhs ? rhs : lhs;
+  }
+};
+
+/**
+ * @brief Pairs a user monoid with subtree counts
+ * @details Keeps rank and select available next to the user aggregate, which
+ * is exposed as `aggregate_type::value`.
+ * */
+template <typename Monoid> struct WithSize {
+  struct aggregate_type {
+    std::size_t size;
+    typename Monoid::aggregate_type value;
+  };
+
+  static constexpr aggregate_type identity() { return {0, Monoid::identity()}; }
+
+  template <typename V> static constexpr aggregate_type lift(const V &value) {
+    return {1, Monoid::lift(value)};
+  }
+
+  static constexpr aggregate_type combine(const aggregate_type &lhs,
+                                          const aggregate_type &rhs) {
+    return {lhs.size + rhs.size, Monoid::combine(lhs.value, rhs.value)};
+  }
+
+  static constexpr std::size_t size(const aggregate_type &agg) noexcept {
+    return agg.size;
+  }
+};
+
+/// @}
+
+#endif // !AUGMENTATION_HPP
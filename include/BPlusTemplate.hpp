@@ -1,12 +1,13 @@
 #ifndef BPLUS_TEMPLATES
 #define BPLUS_TEMPLATES                                                        \
-  size_t M, properKeyValue Key, properKeyValue T,                              \
-      Indexor<Key, std::pair<Key, T>> Indexor,                                 \
-      std::predicate<Key, Key> Compare, IsAllocator Allocator
+  size_t M, properKeyValue Key, properMappedValue T,                           \
+      Indexor<Key, std::pair<const Key, T>> Indexor,                           \
+      std::predicate<Key, Key> Compare, IsAllocator Allocator,                 \
+      TreeTraits<std::pair<const Key, T>> Traits
 #endif
 
 #ifndef BPLUS_TEMPLATE_PARAMS
-#define BPLUS_TEMPLATE_PARAMS M, Key, T, Indexor, Compare, Allocator
+#define BPLUS_TEMPLATE_PARAMS M, Key, T, Indexor, Compare, Allocator, Traits
 #endif
 
 #ifndef NODE_TEMPLATES
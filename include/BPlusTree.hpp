@@ -3,11 +3,28 @@
 
 #include "Concepts.hpp"
 #include "Iterator.hpp"
+#include "NodeHandle.hpp"
 #include "NodeHandler.hpp"
+#include "Prefetch.hpp"
+#include "Stats.hpp"
+#include "Traits.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstring>
+#include <exception>
 #include <functional>
+#include <future>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 
 constexpr size_t MIN_DEGREE = 3;
 
@@ -19,6 +36,7 @@ constexpr size_t MIN_DEGREE = 3;
  * @tparam T Value type
  * @tparam Compare Comparison function
  * @tparam Allocator Allocator type
+ * @tparam Traits Compile time configuration, see @ref DefaultTraits
  *
  * @details
  * B+ Tree is a self-balancing tree data structure that keeps data sorted and
@@ -26,17 +44,25 @@ constexpr size_t MIN_DEGREE = 3;
  * time.
  *
  * */
-template <size_t M, properKeyValue Key, properKeyValue T,
-          Indexor<Key, std::pair<Key, T>> Indexor,
-          std ::predicate<Key, Key> Compare, IsAllocator Allocator>
+template <size_t M, properKeyValue Key, properMappedValue T,
+          Indexor<Key, std::pair<const Key, T>> Indexor,
+          std ::predicate<Key, Key> Compare, IsAllocator Allocator,
+          TreeTraits<std::pair<const Key, T>> Traits>
 class BPlusTree {
 
-  // size_t C_MIN_CHILDS = static_cast<size_t>(std::ceil(M / 2));
-  // size_t C_MIN_KEYS = static_cast<size_t>(std::ceil(M / 2)) - 1;
-
   // M must be at least 3
   static_assert(M >= MIN_DEGREE, "M(B+Tree degree) must be at least 3");
 
+  /// Minimum number of keys of a non root internal node, ceil(M / 2) childs
+  static constexpr size_t C_MIN_INTERNAL_KEYS = (M + 1) / 2 - 1;
+
+  /// Minimum number of values of a non root leaf, ceil((M - 1) / 2) unless
+  /// lazy deletion lowers it
+  static constexpr size_t C_MIN_LEAF_KEYS =
+      Traits::lazy_delete_threshold == 0
+          ? M / 2
+          : std::min<size_t>(Traits::lazy_delete_threshold, M / 2);
+
   using NodeHandler_ = NodeHandler<BPLUS_TEMPLATE_PARAMS, M, M - 1>;
   using LeafNode = typename NodeHandler_::LeafNode_;
   using InternalNode = typename NodeHandler_::InternalNode_;
@@ -56,7 +82,7 @@ public:
   using data_type = T;
 
   /// @brief Type definition for representing value pairs in BPlusTree
-  using value_type = std::pair<Key, data_type>;
+  using value_type = std::pair<const Key, data_type>;
 
   /// @brief Type definition for representing size in BPlusTree
   using size_type = size_t;
@@ -74,6 +100,8 @@ public:
       typename allocator_traits::template rebind_alloc<LeafNode>;
   using internal_allocator_type =
       typename allocator_traits::template rebind_alloc<InternalNode>;
+  using value_allocator_type =
+      typename allocator_traits::template rebind_alloc<value_type>;
 
   /// @brief Type definition for reference to the value_type
   using reference = value_type &;
@@ -99,6 +127,18 @@ public:
   /// @brief Type definition for constant reverse BPlusTree iterator
   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
+  /// @brief Type definition for the augmentation policy, see @ref Augmentation
+  using augmentation = typename Traits::augmentation;
+
+  /// @brief Type definition for the aggregate cached per child
+  using aggregate_type = typename augmentation::aggregate_type;
+
+  /// @brief Type definition for a value extracted from the tree
+  using node_type = NodeHandle<Key, T, Allocator>;
+
+  /// @brief Type definition for the result of inserting a node_type
+  using insert_return_type = InsertReturnType<iterator, node_type>;
+
   /// @}
 
   /// @defgroup Constructors B+Tree Constructors
@@ -107,7 +147,10 @@ public:
   /// @details These constructors allow for any combination of comp, alloc and
 
 protected:
-  ~BPlusTree() { clear(); }
+  ~BPlusTree() {
+    m_on_write.reset();
+    clear();
+  }
 
   /// @{
   /// @brief Default constructor
@@ -119,7 +162,8 @@ protected:
   /// @param comp Comparator configuration.
   /// @param alloc Allocator configuration. Defaults to Allocator().
   explicit BPlusTree(const Compare &comp, const Allocator &alloc = Allocator())
-      : m_comp(comp), m_leaf_allocator(alloc) {}
+      : m_comp(comp), m_allocator(alloc), m_leaf_allocator(alloc),
+        m_internal_allocator(alloc) {}
 
   /// @brief Allocator-based constructor
   /// @details It allows for configuration of allocator.
@@ -136,7 +180,7 @@ protected:
   template <ValueInputIterator<value_type> InputIt>
   BPlusTree(InputIt first, InputIt last, const Compare &comp,
             const Allocator &alloc = Allocator())
-      : m_comp(comp), m_leaf_allocator(alloc) {
+      : BPlusTree(comp, alloc) {
     insert(first, last);
   }
 
@@ -198,9 +242,14 @@ public:
   /// @brief Move assignment operator
   /// @details Replaces the contents with those of other using move semantics
   /// (i.e., the data in other is moved from other into this container).
+  /// Without propagate_on_container_move_assignment the tree keeps its
+  /// allocator, and moves every value if the allocators are unequal.
   /// @param other Another object to be used as source to initialize elements of
   /// the container with.
-  BPlusTree &operator=(BPlusTree &&other) noexcept;
+  BPlusTree &operator=(BPlusTree &&other) noexcept(
+      std::allocator_traits<Allocator>::propagate_on_container_move_assignment::
+          value ||
+      std::allocator_traits<Allocator>::is_always_equal::value);
 
   /// @brief Copy assignment operator.
   /// @details Replaces the contents with a copy of the contents of other.
@@ -218,10 +267,15 @@ public:
 
   /**
    * @name Iterators
-   * Iterator related methods
+   * Iterator related methods. While a snapshot shares nodes, the leaf a
+   * mutable iterator is returned on, or steps on, is copied with its path
+   * first, so it only writes leaves of the tree alone. A copied leaf
+   * invalidates the const iterators into it, and the mutable iterators
+   * obtained before the snapshot must not write after it. The const
+   * overloads keep sharing.
    * */
   /// @{
-  iterator begin() noexcept;
+  iterator begin();
   const_iterator begin() const noexcept;
   const_iterator cbegin() const noexcept;
 
@@ -233,7 +287,7 @@ public:
   const_reverse_iterator rbegin() const noexcept;
   const_reverse_iterator crbegin() const noexcept;
 
-  reverse_iterator rend() noexcept;
+  reverse_iterator rend();
   const_reverse_iterator rend() const noexcept;
   const_reverse_iterator crend() const noexcept;
   /// @}
@@ -255,20 +309,26 @@ public:
 
   // Insert
 
+  /// @details Values are constructed once, in their final allocation, and
+  /// never copied or moved afterwards: leaves hold pointers, so splits and
+  /// rebalancing only move those. Move-only data_type are supported.
   std::pair<iterator, bool> insert(const value_type &value);
 
   template <rvalue_constructible_from<value_type> P>
   std::pair<iterator, bool> insert(P &&value) {
-    emplace(std::forward<P>(value));
+    return emplace(std::forward<P>(value));
   }
 
   std::pair<iterator, bool> insert(value_type &&value);
 
+  /// @details The hint is used when the value belongs right before it, in
+  /// the same leaf, or after the last value; otherwise, and always with an
+  /// augmentation, the tree is descended from the root.
   iterator insert(const_iterator position, const value_type &value);
 
   template <rvalue_constructible_from<value_type> P>
   iterator insert(const_iterator position, P &&value) {
-    emplace_hint(position, std::forward<P>(value));
+    return emplace_hint(position, std::forward<P>(value));
   }
 
   iterator insert(const_iterator position, value_type &&value);
@@ -279,24 +339,37 @@ public:
   void insert(std::initializer_list<value_type> ilist);
 
   // emplace
-  template <InverseConstructibleFrom<value_type>... Args>
+
+  /// @details The value is constructed before its key is known, and
+  /// destroyed again if the key is already present.
+  template <typename... Args>
+    requires std::constructible_from<value_type, Args...>
   std::pair<iterator, bool> emplace(Args &&...args);
 
   // emplace_hint
-  template <InverseConstructibleFrom<value_type>... Args>
+  template <typename... Args>
+    requires std::constructible_from<value_type, Args...>
   iterator emplace_hint(const_iterator hint, Args &&...args);
 
   // try_emplace
-  template <InverseConstructibleFrom<data_type>... Args>
+
+  /// @details Nothing is constructed, and key and args are left untouched,
+  /// if key is already present.
+  template <typename... Args>
+    requires std::constructible_from<data_type, Args...>
   std::pair<iterator, bool> try_emplace(const key_type &key, Args &&...args);
 
-  template <InverseConstructibleFrom<data_type>... Args>
+  template <typename... Args>
+    requires std::constructible_from<data_type, Args...>
   std::pair<iterator, bool> try_emplace(key_type &&key, Args &&...args);
 
-  template <InverseConstructibleFrom<data_type>... Args>
+  template <typename... Args>
+    requires std::constructible_from<data_type, Args...>
   iterator try_emplace(const_iterator hint, const key_type &key,
                        Args &&...args);
-  template <InverseConstructibleFrom<data_type>... Args>
+
+  template <typename... Args>
+    requires std::constructible_from<data_type, Args...>
   iterator try_emplace(const_iterator hint, key_type &&key, Args &&...args);
 
   // erase
@@ -304,7 +377,63 @@ public:
   iterator erase(const_iterator position);
   iterator erase(const_iterator first, const_iterator last);
   size_type erase(const key_type &key);
-  template <ComparableKey<key_type> K> size_type erase(const K &key_compare);
+  template <TransparentKey<key_type, Compare> K>
+    requires(!std::convertible_to<K, iterator> &&
+             !std::convertible_to<K, const_iterator>)
+  size_type erase(const K &key);
+
+  // Node handles
+
+  /// @brief Unlinks the value at position and hands it over in a node_type
+  /// @details The value is neither copied nor reallocated.
+  node_type extract(const_iterator position);
+
+  /// @brief Unlinks the value with key, an empty node_type when absent
+  node_type extract(const key_type &key);
+  template <TransparentKey<key_type, Compare> K>
+    requires(!std::convertible_to<K, iterator> &&
+             !std::convertible_to<K, const_iterator>)
+  node_type extract(const K &key);
+
+  /// @brief Links the value owned by node, unless its key is present
+  /// @details The value keeps its address when the allocator of node equals
+  /// the one of the tree, otherwise it is moved into a new allocation. On
+  /// failure node is handed back in the result still owning the value.
+  insert_return_type insert(node_type &&node);
+
+  /// @brief Links the value owned by node next to hint, as std::map does
+  /// @details When the key is present, node is left untouched and the
+  /// result points to the value holding the key.
+  iterator insert(const_iterator hint, node_type &&node);
+
+  /// @brief Moves the values of source whose keys are not present here
+  /// @details Values are relinked as by extract() and insert(), the ones
+  /// whose keys are present stay in source. When the key ranges do not
+  /// overlap and the allocators are equal the trees are joined instead, in
+  /// O(M log n).
+  void merge(BPlusTree &source);
+  void merge(BPlusTree &&source);
+
+  /// @brief Moves the values whose keys are not less than key into other
+  /// @details The previous contents of other are cleared. Only the nodes
+  /// along the path to key are restructured, in O(M log n). The cost of the
+  /// rest depends on the configuration, for k values moved:
+  /// - size() of both trees comes from the aggregates of a
+  ///   @ref SizedAugmentation for free, otherwise from counting the leaves
+  ///   of the smaller part, O(min(k, n - k) / M);
+  /// - a Traits::point_index hands over the entries of the smaller part,
+  ///   O(min(k, n - k));
+  /// - nodes still shared with a snapshot are copied along the cut only,
+  ///   O(M log n);
+  /// - trees with unequal allocators move every value, O(k log n).
+  void split(const key_type &key, BPlusTree &other);
+
+  /// @brief Moves every value of other into this tree, leaving other empty
+  /// @details Both trees are concatenated along their spines in O(M log n),
+  /// other may hold the lower or the higher keys. Trees with unequal
+  /// allocators fall back to inserting every value.
+  /// @throws std::runtime_error if the key ranges of both trees overlap.
+  void join(BPlusTree &other);
 
   // swap
   void swap(BPlusTree &other) noexcept(
@@ -317,55 +446,710 @@ public:
    * Methods for looking up elements in the B+Tree
    * */
   /// @{
+  /// @details The overloads templated on K are heterogeneous lookups, enabled
+  /// when Compare::is_transparent exists. They compare K against the stored
+  /// keys directly, e.g. std::string_view against std::string keys with
+  /// std::less<>, without building a key_type. With a Traits::point_index,
+  /// count and contains of a key_type, and find of an absent one, take O(1).
+  /// The non const overloads copy the leaf they return, like begin().
   [[nodiscard]] size_type count(const Key &key) const;
-  template <ComparableKey<key_type> K>
-  [[nodiscard]] size_type count(const K &key_compare) const;
+  template <TransparentKey<key_type, Compare> K>
+  [[nodiscard]] size_type count(const K &key) const;
 
   [[nodiscard]] iterator find(const Key &key);
   [[nodiscard]] const_iterator find(const Key &key) const;
 
-  template <ComparableKey<key_type> K>
+  template <TransparentKey<key_type, Compare> K>
   [[nodiscard]] iterator find(const K &key);
-  template <ComparableKey<key_type> K>
+  template <TransparentKey<key_type, Compare> K>
   [[nodiscard]] const_iterator find(const K &key) const;
 
   bool contains(const Key &key) const;
-  template <ComparableKey<key_type> K> bool contains(const K &key) const;
+  template <TransparentKey<key_type, Compare> K>
+  bool contains(const K &key) const;
 
   std::pair<iterator, iterator> equal_range(const Key &key);
   std::pair<const_iterator, const_iterator> equal_range(const Key &key) const;
 
-  template <ComparableKey<key_type> K>
+  template <TransparentKey<key_type, Compare> K>
   std::pair<iterator, iterator> equal_range(const K &key);
-  template <ComparableKey<key_type> K>
+  template <TransparentKey<key_type, Compare> K>
   std::pair<const_iterator, const_iterator> equal_range(const K &key) const;
 
   iterator lower_bound(const Key &key);
   const_iterator lower_bound(const Key &key) const;
 
-  template <ComparableKey<key_type> K> iterator lower_bound(const K &key);
-  template <ComparableKey<key_type> K> const_iterator lower_bound(const K &key);
+  template <TransparentKey<key_type, Compare> K>
+  iterator lower_bound(const K &key);
+  template <TransparentKey<key_type, Compare> K>
+  const_iterator lower_bound(const K &key) const;
 
   iterator upper_bound(const Key &key);
   const_iterator upper_bound(const Key &key) const;
-  template <ComparableKey<key_type> K> iterator upper_bound(const K &key);
-  template <ComparableKey<key_type> K> const_iterator upper_bound(const K &key);
+  template <TransparentKey<key_type, Compare> K>
+  iterator upper_bound(const K &key);
+  template <TransparentKey<key_type, Compare> K>
+  const_iterator upper_bound(const K &key) const;
+
+  /// @brief Looks up every key of keys, storing find(keys[i]) in results[i]
+  /// @details Descents are interleaved in groups of Traits::batch_width and
+  /// the next node of every descent is prefetched, so the cache misses of one
+  /// lookup overlap with the others.
+  /// @throws std::runtime_error if results is smaller than keys.
+  void find_batch(std::span<const key_type> keys, std::span<iterator> results);
+  void find_batch(std::span<const key_type> keys,
+                  std::span<const_iterator> results) const;
+
+  /// @brief Batched contains, see find_batch
+  void contains_batch(std::span<const key_type> keys,
+                      std::span<bool> results) const;
+
+  /// @}
+
+  /**
+   * @name Augmented queries
+   * Queries answered from the aggregates cached in internal nodes, they run
+   * in O(M log n) instead of walking the elements. See @ref Augmentation
+   * */
+  /// @{
+
+  /// @brief Aggregate of the elements with keys in [low, high)
+  [[nodiscard]] aggregate_type range_aggregate(const key_type &low,
+                                               const key_type &high) const
+    requires is_augmented_v<augmentation>;
+
+  /// @brief Number of elements with keys in [low, high)
+  [[nodiscard]] size_type count(const key_type &low,
+                                const key_type &high) const
+    requires SizedAugmentation<augmentation>;
+
+  /// @brief Number of elements with keys less than key
+  [[nodiscard]] size_type rank(const key_type &key) const
+    requires SizedAugmentation<augmentation>;
+
+  /// @brief Iterator to the element at position index in key order
+  /// @return end() if index >= size()
+  [[nodiscard]] iterator select(size_type index)
+    requires SizedAugmentation<augmentation>;
+  [[nodiscard]] const_iterator select(size_type index) const
+    requires SizedAugmentation<augmentation>;
+  /// @}
+
+  /**
+   * @name Observers
+   * */
+  /// @{
+  [[nodiscard]] key_compare key_comp() const { return m_comp; }
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return m_allocator;
+  }
+  /// @}
+
+  /**
+   * @name Statistics
+   * */
+  /// @{
+
+  /// @brief Snapshot of the tree shape and of the operation counters
+  /// @details Walks every node, O(n / M). The counters are only collected
+  /// when Traits::collect_stats is true and read 0 otherwise.
+  [[nodiscard]] TreeStats stats() const;
+
+  /// @brief Zeroes the operation counters
+  void reset_stats() noexcept;
+
+  /// @brief Bytes of the nodes and values of the tree, O(n / M)
+  /// @details Nodes take the size their rebound allocator allocates. The
+  /// point index is not counted. With a BudgetedAllocator, such as
+  /// BudgetAllocator, an insertion of an absent key first lets the allocator
+  /// call its budget callback when the value it allocates, and the leaf it
+  /// splits, would exceed the budget.
+  [[nodiscard]] MemoryUsage memory_usage() const;
+
+  /// @brief Checks every structural invariant of the tree
+  /// @details Key order inside and across nodes, separator bounds, fill
+  /// bounds, uniform leaf depth, cached aggregates, the leaf chain against
+  /// m_head and m_tail, and size(). Runs in O(n), meant for tests and
+  /// fuzzing of the optimized code paths.
+  /// @throws std::runtime_error naming the first invariant that does not hold
+  void validate() const;
+  /// @}
+
+  /**
+   * @name Compaction
+   * */
+  /// @{
+
+  /// @brief Position and progress of an incremental compaction
+  class Compaction {
+  public:
+    /// @brief Whether compaction went past the last leaf
+    [[nodiscard]] bool done() const noexcept { return m_done; }
+    /// @brief Work done by every slice so far
+    [[nodiscard]] const CompactionStats &stats() const noexcept {
+      return m_stats;
+    }
+
+  private:
+    friend class BPlusTree;
+
+    std::optional<key_type> m_next; ///< First key of the next slice
+    bool m_done = false;
+    CompactionStats m_stats;
+  };
+
+  /// @brief Packs the leaves of the whole tree
+  /// @details See compact(Compaction &, size_type).
+  CompactionStats compact();
+
+  /// @brief Packs at most max_leaves leaves, from where compaction stopped
+  /// @details Leaves are filled up from their right sibling under the same
+  /// parent, and emptied siblings are freed. Each parent then merges with
+  /// its left sibling when both fit in one node, and the root is dropped
+  /// while it has a single child. Values never move, so references and
+  /// the point index stay valid, but iterators are invalidated. Each slice
+  /// takes O(max_leaves * M + M log n). The tree may be written between
+  /// slices, compaction resumes from a key. Leaves shared with a snapshot
+  /// are copied first.
+  /// @return Whether compaction went past the last leaf
+  bool compact(Compaction &compaction, size_type max_leaves);
+  /// @}
+
+  /**
+   * @name Snapshots
+   * */
+  /// @{
+
+  /// @brief Immutable view of the tree at the time it was taken
+  class Snapshot;
 
+  /// @brief Takes a snapshot in O(1), sharing every node with the tree
+  /// @details Writes copy the nodes they touch while a snapshot shares them:
+  /// insert, emplace, erase and extract of one key copy the nodes along its
+  /// path and the siblings erasure rebalances with, the range erase the
+  /// nodes along both ends of the range and the siblings it joins them
+  /// with, and split and join the nodes along the cut or the seam. A
+  /// copied leaf copies its values. A mutable iterator copies the path of
+  /// each leaf it reaches, and find_value(), at() and operator[] the path
+  /// of their key. Once the last snapshot is destroyed the writes stop
+  /// copying, also those of the trees that took nodes over from it.
+  /// Snapshots may be read and destroyed on other threads while the tree
+  /// is written, with a thread safe allocator; snapshot() itself is a
+  /// write.
+  [[nodiscard]] Snapshot snapshot()
+    requires std::copy_constructible<value_type>;
+
+  /// @brief Snapshot whose internal nodes are copies allocated by alloc
+  /// @details The leaves are shared like those of snapshot(), the internal
+  /// levels are compared to those of previous, an older replica made with
+  /// alloc, in O(n / M): the subtrees left unchanged since are shared with
+  /// it, and only the paths to the leaves written since are copied. With
+  /// key, previous must be the replica of the tree as it was before one
+  /// write of the leaf of key, and only the nodes along its path and their
+  /// siblings are compared, in O(M height). NumaReplicas places a replica
+  /// on every NUMA node this way.
+  ///
+  /// Unlike snapshots, replicas do not make the reads of the tree copy the
+  /// leaves: values written through iterators, at() and operator[] change
+  /// the leaves they share in place, and must not race with their readers.
+  /// A leaf copied for a snapshot instead reaches the replicas with the
+  /// next insertion or erasure in it.
+  /// alloc must compare equal to get_allocator().
+  /// @throws std::runtime_error if it does not
+  [[nodiscard]] Snapshot replica(const allocator_type &alloc,
+                                 const Snapshot &previous = Snapshot(),
+                                 const key_type *key = nullptr)
+    requires std::copy_constructible<value_type>;
+
+  /// @brief Called after the writes, see on_write()
+  using write_callback = std::function<void(const key_type *key)>;
+
+  /// @brief Calls callback after each insertion, erasure or bulk write
+  /// @details Insertions and erasures of one key pass a key of the leaf they
+  /// wrote, the bulk writes nullptr, they may have written any leaf. Values
+  /// written in place, and the leaves reads copy for a snapshot, are not
+  /// reported. The callback stays with this object, moves and swaps do not
+  /// take it along, and an empty one removes it. It must not throw.
+  void on_write(write_callback callback);
+  /// @}
+
+protected:
+  /**
+   * @name Set algebra
+   * Replace the contents with the result of a linear merge of the leaf
+   * chains of first and second, which is then bulk built bottom up instead
+   * of inserted value by value. When one cursor falls behind the other by
+   * more than its current leaf, it jumps ahead with a root to leaf descent,
+   * skipping the subtrees in between. Map and Set expose these as
+   * merge_union, intersect and difference.
+   * */
+  /// @{
+
+  /// @brief Keys present in first or second, the values of first win
+  void assign_union(const BPlusTree &first, const BPlusTree &second);
+
+  /// @brief Keys present in both trees, with the values of first
+  void assign_intersection(const BPlusTree &first, const BPlusTree &second);
+
+  /// @brief Keys of first that are not present in second
+  void assign_difference(const BPlusTree &first, const BPlusTree &second);
   /// @}
 
+  /// @brief Value stored under key, or nullptr
+  /// @details O(1) with a Traits::point_index, a descent otherwise. The non
+  /// const overload first unshares the path to key, so the snapshots do not
+  /// see writes through the result.
+  [[nodiscard]] value_type *find_value(const key_type &key);
+  [[nodiscard]] const value_type *find_value(const key_type &key) const;
+
 private:
+  static constexpr bool C_AUGMENTED = is_augmented_v<augmentation>;
+
+  using value_traits = std::allocator_traits<value_allocator_type>;
+
+  /// Values whose destructor is a no-op are only deallocated, unless the
+  /// allocator customizes destroy
+  static constexpr bool C_TRIVIAL_DESTROY =
+      std::is_trivially_destructible_v<value_type> &&
+      !requires(value_allocator_type allocator, value_type *value) {
+        allocator.destroy(value);
+      };
+  /// Values of trivially copyable keys and mapped types are copied as bytes,
+  /// unless the allocator customizes construct
+  static constexpr bool C_TRIVIAL_COPY =
+      std::is_trivially_copyable_v<key_type> &&
+      std::is_trivially_copyable_v<T> &&
+      std::is_trivially_copy_constructible_v<value_type> &&
+      std::is_trivially_destructible_v<value_type> &&
+      !requires(value_allocator_type allocator, value_type *value,
+                const value_type &source) {
+        allocator.construct(value, source);
+      };
+  using leaf_traits = std::allocator_traits<leaf_allocator_type>;
+  using internal_traits = std::allocator_traits<internal_allocator_type>;
+
+  static constexpr bool C_BUDGETED = BudgetedAllocator<allocator_type>;
+
+  /// @brief Separator and new right sibling produced by a node split
+  using Split = std::optional<std::pair<Key, NodeHandler_>>;
+
+  /// @brief Detached subtree, height 0 is a single leaf
+  /// @details Every node but the root satisfies the fill bounds.
+  struct Piece {
+    NodeHandler_ root = nullptr;
+    size_type height = 0;
+  };
+
   // Private members
   NodeHandler_ m_root = nullptr;
-  key_compare m_comp;
 
-  allocator_type m_allocator;
-  leaf_allocator_type m_leaf_allocator;
-  internal_allocator_type m_internal_allocator;
+  // Nodes hold no reference to these, the tree passes them down. Stateless
+  // comparators and allocators take no space.
+  [[no_unique_address]] key_compare m_comp;
+  [[no_unique_address]] allocator_type m_allocator;
+  [[no_unique_address]] leaf_allocator_type m_leaf_allocator;
+  [[no_unique_address]] internal_allocator_type m_internal_allocator;
 
   LeafNode *m_head = nullptr;
   LeafNode *m_tail = nullptr;
 
+  size_type m_size = 0;
+
+  /// Whether a snapshot may share nodes, see shared()
+  bool m_shared = false;
+
+  /// @brief Snapshots and replicas taken and not yet destroyed
+  struct Versions {
+    std::atomic<size_type> snapshots{0};
+    std::atomic<size_type> replicas{0};
+    /// Versions of the trees whose nodes split() or join() took over, only
+    /// the tree reads them
+    std::vector<std::shared_ptr<Versions>> adopted;
+
+    /// @brief Whether a snapshot, or unless only_snapshots a replica, of
+    /// this or an adopted tree is alive
+    bool alive(bool only_snapshots) const noexcept {
+      // Acquire pairs with the release of the last version destroyed
+      const auto counted = [only_snapshots](const Versions &versions) {
+        return versions.snapshots.load(std::memory_order_acquire) > 0 ||
+               (!only_snapshots &&
+                versions.replicas.load(std::memory_order_acquire) > 0);
+      };
+      return counted(*this) ||
+             std::any_of(adopted.begin(), adopted.end(),
+                         [&counted](const auto &versions) {
+                           return counted(*versions);
+                         });
+    }
+  };
+
+  /// Allocated by the first snapshot or replica
+  std::shared_ptr<Versions> m_versions;
+
+  /// See on_write(), only allocated when set
+  std::unique_ptr<write_callback> m_on_write;
+
+  static constexpr bool C_INDEXED = Traits::point_index::enabled;
+  using point_index_type =
+      typename Traits::point_index::template map_type<key_type, value_type,
+                                                      Allocator>;
+
+  /// Whether the index answers lookups of K, keys other than key_type need
+  /// a transparent Hash and KeyEqual
+  template <typename K>
+  static constexpr bool C_INDEXED_FOR =
+      C_INDEXED && requires(const point_index_type &index, const K &key) {
+        index.contains(key);
+      };
+
+  /// Value of every key, when Traits::point_index enables it
+  [[no_unique_address]] point_index_type m_index;
+
+  static constexpr bool C_STATS = Traits::collect_stats;
+  using counters_type =
+      std::conditional_t<C_STATS, OperationCounters, NoOperationCounters>;
+
+  /// Written by const lookups as well
+  [[no_unique_address]] mutable counters_type m_counters;
+
+  /// @brief Applies update to the operation counters
+  /// @details update is a generic lambda, it is not even instantiated unless
+  /// Traits::collect_stats is true.
+  template <typename Update> void record(Update &&update) const {
+    if constexpr (C_STATS) {
+      update(m_counters);
+    }
+  }
+
+  /// @brief Comparisons made by a node search returning index
+  static constexpr size_type scan_comparisons(size_type index,
+                                              size_type count) noexcept {
+    return Traits::node_search::comparisons(index, count);
+  }
+
   void fix_head_tail();
+
+  // Cloning
+
+  /// @brief Leaves of a clone linked so far, in key order
+  struct LeafChain {
+    LeafNode *head = nullptr;
+    LeafNode *tail = nullptr;
+
+    void append(LeafNode *leaf) noexcept;
+    void append(const LeafChain &chain) noexcept;
+  };
+
+  /// @brief Copies the shape of the subtree rooted at node
+  /// @details make builds each value from the source one. The cloned leaves
+  /// are appended to chain. If anything throws, every node and value cloned
+  /// by this call is freed before rethrowing.
+  template <typename Make>
+  NodeHandler_ clone_subtree(NodeHandler_ node, Make &make, LeafChain &chain);
+
+  /// @brief clone_subtree of an internal node whose children are cloned on
+  /// up to hardware_concurrency threads
+  template <typename Make>
+  NodeHandler_ clone_parallel(NodeHandler_ node, Make &make,
+                              LeafChain &chain);
+
+  /// @brief Makes this empty tree a clone of other, see clone_subtree
+  template <typename Make> void clone_from(const BPlusTree &other, Make make);
+  /// @brief Clears the tree and takes the nodes of other over
+  /// @pre The allocators compare equal unless propagate
+  void take_over(BPlusTree &other, bool propagate) noexcept;
+
+  // Node and value lifetime
+  LeafNode *create_leaf();
+  InternalNode *create_internal();
+  template <typename... Args> value_type *create_value(Args &&...args);
+  /// @brief create_value of a copy, a memcpy with C_TRIVIAL_COPY
+  value_type *copy_value(const value_type &source);
+  void destroy_value(value_type *value);
+  /// @brief Destroys every node and value below node
+  /// @return Number of values destroyed
+  size_type destroy_subtree(NodeHandler_ node) noexcept;
+  void destroy_node(NodeHandler_ node) noexcept;
+
+  // Copy on write, see snapshot()
+
+  static std::atomic<size_type> &refs(NodeHandler_ node);
+
+  /// @brief Replaces node by a copy owned by this tree alone, if shared
+  void unshare(NodeHandler_ &node);
+
+  /// @brief Copy of source sharing its children
+  InternalNode *copy_internal(const InternalNode &source);
+
+  /// @brief Copies the internal nodes below node, sharing the leaves
+  /// @details Shares instead the nodes of previous, the node at the same
+  /// position in an older replica, whose subtree still holds the same keys
+  /// and leaves.
+  /// With key, only the children along its path and their siblings are
+  /// compared, the others are those of previous with the same separators.
+  NodeHandler_ replicate_subtree(NodeHandler_ node, NodeHandler_ previous,
+                                 const key_type *key = nullptr);
+
+  /// @brief Position in older of the child of source at index
+  /// @details The child whose separators both match, or unless exact the
+  /// one whose lower or else upper separator does, older.m_count + 1 if
+  /// none matches.
+  size_type matching_child(const InternalNode &older,
+                           const InternalNode &source, size_type index,
+                           bool exact) const;
+
+  /// @brief Unshares the nodes along the path to key
+  /// @details With siblings, also the sibling that each of them would
+  /// rebalance with.
+  /// @return Leaf of key, nullptr if nothing was shared
+  template <typename K> LeafNode *unshare_path(const K &key, bool siblings);
+
+  friend iterator;
+  friend const_iterator;
+
+  /// @brief it, copying the leaf it reaches if a snapshot shares it
+  /// @details A copied leaf keeps the positions of its values, so it keeps
+  /// pointing at the same one. Each mutable iterator handed out goes through
+  /// here, and again whenever it steps on another leaf.
+  iterator owned(iterator it);
+
+  /// @brief leaf, holding key, copied if a snapshot shares it
+  /// @details Replicas alone do not copy it, see replica(). Neither are
+  /// they told about the copy: sharing it again would make the next lookup
+  /// copy it again, and drop the leaf of the iterators handed out before.
+  LeafNode *owned_leaf(const key_type &key, LeafNode *leaf);
+
+  /// @brief Whether a snapshot or replica may share nodes
+  /// @details Stays true until clear() or the destruction of the last
+  /// snapshot and replica, also of the trees adopted, which the writes
+  /// notice here.
+  bool shared() noexcept;
+
+  /// @brief Whether a snapshot, not only replicas, may share nodes
+  bool snapshotted() noexcept;
+
+  /// @brief Counts a new snapshot or replica, its version decrements the
+  /// count once it released its nodes
+  std::shared_ptr<const BPlusTree> track_version(BPlusTree *version,
+                                                 bool replica);
+
+  /// @brief Calls the write callback with the key of value, nullptr if any
+  /// leaf may have been written
+  void notify_write(const value_type *value) const;
+
+  /// @brief Counts the snapshots of other too, before taking over its nodes
+  /// @details split() and join() move the shared nodes between the trees,
+  /// which copy them on write until the snapshots of both are destroyed.
+  void adopt_versions(BPlusTree &other);
+
+  /// @brief Drops one reference to node, destroying it with the last one
+  void release(NodeHandler_ node) noexcept;
+
+  /// @brief Whether the budget of the allocator has room for bytes more
+  [[nodiscard]] bool within_budget(size_type bytes) const noexcept;
+
+  /// @brief Lets the allocator make room for an insertion of key, before it
+  /// starts
+  /// @details Charges value_bytes, and a leaf when the one of key is full,
+  /// only if key is absent. The budget callback may modify the tree.
+  template <typename K> void make_room(const K &key, size_type value_bytes);
+
+  /// @brief unshare for writes off the path of a key
+  /// @details Nodes are only shared when values can be copied.
+  void claim(NodeHandler_ &node);
+
+  // Point index, see Traits::point_index
+
+  /// @brief Value built by make for an insertion of the absent key
+  /// @details The index entry is added first, so an index that cannot grow
+  /// leaves the tree, and whatever make would consume, unchanged.
+  template <typename K, typename Make>
+  value_type *make_indexed(const K &key, Make &make);
+  /// @brief Indexes every value from scratch
+  void rebuild_index();
+  /// @brief Calls visit with every value below node
+  template <typename Visit>
+  static void visit_values(NodeHandler_ node, Visit &&visit);
+
+  [[nodiscard]] size_type height() const;
+  /// @brief Values of high, the upper part of this tree once split
+  /// @details Reads the aggregates of a SizedAugmentation, otherwise counts
+  /// the leaves of the smaller part, O(min(k, n - k) / M).
+  [[nodiscard]] size_type count_split(NodeHandler_ low,
+                                      NodeHandler_ high) const;
+  [[nodiscard]] bool shares_allocator(const BPlusTree &other) const;
+  static LeafNode *leftmost_leaf(NodeHandler_ node);
+  static LeafNode *rightmost_leaf(NodeHandler_ node);
+
+  /// @brief Creates a root with two children
+  InternalNode *make_root(NodeHandler_ left, Key separator,
+                          NodeHandler_ right);
+
+  /// @brief Inserts key at position and child after it, splitting if full
+  void attach_child(InternalNode *inner, size_type position, Key key,
+                    NodeHandler_ child, Split &split);
+
+  // Rebalancing
+  [[nodiscard]] bool underfull(NodeHandler_ node) const;
+  [[nodiscard]] bool can_lend(NodeHandler_ node) const;
+  [[nodiscard]] bool fits(NodeHandler_ left, NodeHandler_ right) const;
+
+  /// @brief Merges right into its left sibling and destroys it
+  void merge_nodes(NodeHandler_ left, Key separator, NodeHandler_ right);
+
+  /// @brief Evens out two siblings
+  /// @return The new separator between them
+  Key balance_nodes(NodeHandler_ left, Key separator, NodeHandler_ right);
+
+  /// @brief Borrows from or merges the underfull child index with a sibling
+  void rebalance_child(InternalNode *inner, size_type index);
+
+  /// @brief Replaces an emptied root by its only child
+  void shrink_root();
+
+  // Compaction
+
+  /// @brief Packs the leaves below node from the one holding key
+  /// @details Sets next to the key the following slice starts from.
+  /// @return Leaves visited
+  size_type compact_descend(NodeHandler_ node, const key_type &key,
+                            size_type budget, std::optional<key_type> &next,
+                            CompactionStats &stats);
+
+  /// @brief Packs the leaf children of inner from index on
+  size_type compact_leaves(InternalNode *inner, size_type index,
+                           size_type budget, std::optional<key_type> &next,
+                           CompactionStats &stats);
+
+  /// @brief Fills the last leaf of the child index - 1 of inner from the
+  /// first leaves of its child index, both parents of leaves
+  /// @return Leaves visited
+  size_type compact_seam(InternalNode *inner, size_type index,
+                         size_type budget, CompactionStats &stats);
+
+  /// @brief Merges child index with a sibling if both fit in one node, or
+  /// evens them out
+  /// @details Unlike rebalance_child, it restores children of any fill.
+  void pack_child(InternalNode *inner, size_type index);
+
+  /// @brief Unlinks the value with key from the subtree rooted at node
+  /// @return The value, which the caller owns, or nullptr when absent
+  template <typename K>
+  value_type *erase_descend(NodeHandler_ node, const K &key);
+
+  /// @brief Unlinks the value with key from the tree
+  /// @return The value, which the caller owns, or nullptr when absent
+  template <typename K> value_type *detach(const K &key);
+
+  // Split and join of detached subtrees, both run in O(M log n)
+
+  /// @brief Concatenates two pieces whose leaf chains are already linked
+  /// @details separator must lie in (max(left), min(right)].
+  Piece join_pieces(Piece left, Key separator, Piece right);
+  void join_right(NodeHandler_ node, size_type height, Piece right,
+                  Key separator, Split &split);
+  void join_left(NodeHandler_ node, size_type height, Piece left,
+                 Key separator, Split &split);
+
+  /// @brief Cuts a piece into the keys less than key and the rest
+  /// @details The leaf chain is cut at the seam.
+  std::pair<Piece, Piece> split_piece(Piece piece, const key_type &key);
+
+  enum class SetOperation { Union, Intersection, Difference };
+
+  template <SetOperation Operation>
+  void assign_merge(const BPlusTree &first, const BPlusTree &second);
+
+  /// @brief Moves it to the first value of tree not less than key
+  /// @pre it is not end()
+  const_iterator seek(const_iterator it, const key_type &key) const;
+
+  /// @brief Builds the tree bottom up from sorted and unique values
+  /// @details Every level is split into as few nodes as possible, spreading
+  /// the entries evenly so that each node respects the fill bounds. The
+  /// tree takes the values over, also when it throws: the partial levels
+  /// and the values not linked yet are destroyed before rethrowing.
+  /// @pre The tree is empty
+  void bulk_build(std::span<value_type *const> values);
+
+  /// @brief Validates the subtree of node, whose keys lie in [low, high)
+  /// @details nullptr bounds are unbounded. Leaves are appended to leaves in
+  /// key order.
+  /// @return Number of values in the subtree
+  size_type validate_node(NodeHandler_ node, size_type depth,
+                          const key_type *low, const key_type *high,
+                          std::vector<const LeafNode *> &leaves) const;
+
+  /// @brief Counts a lookup whose leaf scan stopped at position
+  void record_lookup(size_type position, size_type count) const {
+    record([&](auto &counters) {
+      ++counters.lookups;
+      counters.lookup_comparisons += scan_comparisons(position, count);
+    });
+  }
+
+  /// @brief Counts a LeafNode::find that made comparisons
+  void record_find(size_type comparisons) const {
+    record([&](auto &counters) {
+      ++counters.lookups;
+      counters.lookup_comparisons += comparisons;
+      if (LeafNode::fingerprinted && comparisons == 0) {
+        ++counters.fingerprint_rejections;
+      }
+    });
+  }
+
+  /// @brief Leaf whose range contains key
+  /// @pre The tree is not empty
+  template <typename K> LeafNode *find_leaf(const K &key) const;
+
+  /// @brief Shared implementation of the lookups for any comparable K
+  template <typename K> iterator lower_bound_of(const K &key) const;
+  template <typename K> iterator upper_bound_of(const K &key) const;
+  template <typename K> iterator find_of(const K &key) const;
+  template <typename K> size_type erase_of(const K &key);
+
+  /// @brief end() of the shared implementations
+  iterator end_of() const noexcept;
+
+  /// @brief Builds an iterator, moving past the end of a leaf to the next
+  iterator make_iterator(LeafNode *leaf, size_type index) const noexcept;
+
+  /// @brief Inserts the value built by make if key is not present
+  /// @details make allocates value_bytes, 0 when it hands over a value.
+  template <typename K, typename Make>
+  std::pair<iterator, bool> insert_unique(const K &key, Make &&make,
+                                          size_type value_bytes);
+
+  template <typename K, typename Make>
+  std::pair<iterator, bool> insert_descend(NodeHandler_ node, const K &key,
+                                           Make &make, Split &split);
+
+  /// @brief insert_unique that first tries to insert right before hint
+  template <typename K, typename Make>
+  iterator insert_hint(const_iterator hint, const K &key, Make &&make,
+                       size_type value_bytes);
+
+  /// @brief Inserts an already constructed value, destroying it if its key
+  /// is present
+  std::pair<iterator, bool> insert_created(value_type *value);
+  iterator insert_created(const_iterator hint, value_type *value);
+
+  /// @brief Aggregate of the whole subtree rooted at node
+  aggregate_type aggregate_of(NodeHandler_ node) const;
+
+  /// @brief Aggregate of the elements of node within [low, high)
+  /// @details nullptr bounds are unbounded.
+  aggregate_type fold_range(NodeHandler_ node, const key_type *low,
+                            const key_type *high) const;
+
+  LeafNode *select_leaf(size_type &index) const;
+
+  /// @brief Runs the interleaved descents of keys, calling
+  /// visit(index, leaf) with the leaf reached by keys[index]
+  /// @pre The tree is not empty
+  template <typename Visit>
+  void descend_batch(std::span<const key_type> keys, Visit &&visit) const;
 };
 
 /******************
@@ -377,97 +1161,306 @@ private:
 // *** Constructors *** //
 
 template <BPLUS_TEMPLATES>
-void BPlusTree<BPLUS_TEMPLATE_PARAMS>::fix_head_tail() {
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::LeafChain::append(
+    LeafNode *leaf) noexcept {
+  leaf->m_prev = tail;
+  if (tail != nullptr) {
+    tail->m_next = leaf;
+  } else {
+    head = leaf;
+  }
+  tail = leaf;
+}
 
-  auto left_it = m_root;
-  auto right_it = m_root;
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::LeafChain::append(
+    const LeafChain &chain) noexcept {
+  if (chain.head == nullptr) {
+    return;
+  }
+  chain.head->m_prev = tail;
+  if (tail != nullptr) {
+    tail->m_next = chain.head;
+  } else {
+    head = chain.head;
+  }
+  tail = chain.tail;
+}
 
-  while (!left_it.m_isLeaf) {
-    left_it = left_it.childs()[0];
-    right_it = right_it.childs()[right_it.keyCount()];
+template <BPLUS_TEMPLATES>
+template <typename Make>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::clone_subtree(NodeHandler_ node,
+                                                     Make &make,
+                                                     LeafChain &chain)
+    -> NodeHandler_ {
+  if (node.m_isLeaf) {
+    const auto *source = node.leaf();
+    auto *leaf = create_leaf();
+    try {
+      for (; leaf->m_count < source->m_count; ++leaf->m_count) {
+        leaf->m_values[leaf->m_count] = make(source->m_values[leaf->m_count]);
+      }
+    } catch (...) {
+      destroy_subtree(leaf);
+      throw;
+    }
+    leaf->m_fingerprints = source->m_fingerprints;
+    chain.append(leaf);
+    return leaf;
   }
-  m_head = left_it;
-  m_tail = right_it;
+
+  const auto *source = node.internal();
+  auto *inner = create_internal();
+  size_type cloned = 0;
+  try {
+    std::copy_n(source->m_keys.begin(), source->m_count,
+                inner->m_keys.begin());
+    for (; cloned <= source->m_count; ++cloned) {
+      inner->m_children[cloned] =
+          clone_subtree(source->m_children[cloned], make, chain);
+    }
+  } catch (...) {
+    for (size_type i = 0; i < cloned; ++i) {
+      destroy_subtree(inner->m_children[i]);
+    }
+    destroy_node(inner);
+    throw;
+  }
+  if constexpr (C_AUGMENTED) {
+    std::copy_n(source->m_aggregates.begin(), source->m_count + 1,
+                inner->m_aggregates.begin());
+  }
+  inner->m_count = source->m_count;
+  return inner;
 }
 
 template <BPLUS_TEMPLATES>
-BPlusTree<BPLUS_TEMPLATE_PARAMS>::BPlusTree(const BPlusTree &other)
-    : m_comp(other.m_comp),
-      m_leaf_allocator(
-          std::allocator_traits<allocator_type>::
-              select_on_container_copy_construction(other.m_leaf_allocator)) {
+template <typename Make>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::clone_parallel(NodeHandler_ node,
+                                                      Make &make,
+                                                      LeafChain &chain)
+    -> NodeHandler_ {
+  const auto *source = node.internal();
+  const size_type children = source->m_count + 1;
+  const size_type tasks = std::clamp<size_type>(
+      std::thread::hardware_concurrency(), 1, children);
+
+  auto *inner = create_internal();
+  try {
+    std::copy_n(source->m_keys.begin(), source->m_count,
+                inner->m_keys.begin());
+  } catch (...) {
+    destroy_node(inner);
+    throw;
+  }
 
-  if (other.m_root != nullptr) {
-    // InternalNode or LeafNode
-    m_root = new std::remove_pointer_t<decltype(other.m_root)>(*other.m_root);
-    fix_head_tail();
+  // Task t clones a contiguous range of children into its own chain, and
+  // frees what it cloned if it fails
+  std::vector<LeafChain> chains(tasks);
+  std::vector<std::future<void>> futures;
+  futures.reserve(tasks);
+  auto clone_range = [&](size_type task) {
+    const auto first = task * children / tasks;
+    const auto last = (task + 1) * children / tasks;
+    auto index = first;
+    try {
+      for (; index < last; ++index) {
+        inner->m_children[index] =
+            clone_subtree(source->m_children[index], make, chains[task]);
+      }
+    } catch (...) {
+      for (auto i = first; i < index; ++i) {
+        destroy_subtree(inner->m_children[i]);
+        inner->m_children[i] = nullptr;
+      }
+      throw;
+    }
+  };
+
+  std::exception_ptr failure;
+  for (size_type task = 0; task < tasks; ++task) {
+    try {
+      futures.push_back(std::async(std::launch::async, clone_range, task));
+    } catch (...) {
+      failure = std::current_exception();
+      break;
+    }
+  }
+  for (auto &future : futures) {
+    try {
+      future.get();
+    } catch (...) {
+      failure = std::current_exception();
+    }
+  }
+  if (failure) {
+    for (size_type i = 0; i < children; ++i) {
+      if (inner->m_children[i] != nullptr) {
+        destroy_subtree(inner->m_children[i]);
+      }
+    }
+    destroy_node(inner);
+    std::rethrow_exception(failure);
+  }
+
+  for (const auto &task_chain : chains) {
+    chain.append(task_chain);
+  }
+  if constexpr (C_AUGMENTED) {
+    std::copy_n(source->m_aggregates.begin(), children,
+                inner->m_aggregates.begin());
+  }
+  inner->m_count = source->m_count;
+  return inner;
+}
+
+template <BPLUS_TEMPLATES>
+template <typename Make>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::clone_from(const BPlusTree &other,
+                                                  Make make) {
+  if (other.m_root == nullptr) {
+    return;
+  }
 
+  constexpr auto threshold = Traits::parallel_copy_threshold;
+  LeafChain chain;
+  if (threshold > 0 && other.m_size >= threshold && !other.m_root.m_isLeaf) {
+    m_root = clone_parallel(other.m_root, make, chain);
   } else {
-    m_root = nullptr;
+    m_root = clone_subtree(other.m_root, make, chain);
   }
+  m_head = chain.head;
+  m_tail = chain.tail;
+  m_size = other.m_size;
+  rebuild_index();
 }
 
 template <BPLUS_TEMPLATES>
-BPlusTree<BPLUS_TEMPLATE_PARAMS>::BPlusTree(const BPlusTree &other,
-                                            const Allocator &alloc)
-    : m_comp(other.m_comp), m_leaf_allocator(alloc) {
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::fix_head_tail() {
 
-  if (alloc == other.m_leaf_allocator) {
-    if (other.m_root != nullptr) {
-      // InternalNode or LeafNode
-      m_root = new std::remove_pointer_t<decltype(other.m_root)>(*other.m_root);
-      fix_head_tail();
-    } else {
-      m_root = nullptr;
-    }
+  if (m_root == nullptr) {
+    m_head = nullptr;
+    m_tail = nullptr;
     return;
   }
 
-  throw std::runtime_error("Copy constructor with allocator not implemented if "
-                           "allocators are not equal");
+  auto left_it = m_root;
+  auto right_it = m_root;
+
+  while (!left_it.m_isLeaf) {
+    left_it = left_it.childs()[0];
+    right_it = right_it.childs()[right_it.keyCount()];
+  }
+  m_head = left_it.leaf();
+  m_tail = right_it.leaf();
+}
+
+template <BPLUS_TEMPLATES>
+BPlusTree<BPLUS_TEMPLATE_PARAMS>::BPlusTree(const BPlusTree &other)
+    : BPlusTree(other, allocator_traits::select_on_container_copy_construction(
+                           other.m_allocator)) {}
+
+template <BPLUS_TEMPLATES>
+BPlusTree<BPLUS_TEMPLATE_PARAMS>::BPlusTree(const BPlusTree &other,
+                                            const Allocator &alloc)
+    : BPlusTree(other.m_comp, alloc) {
+  clone_from(other,
+             [this](const value_type *value) { return copy_value(*value); });
 }
 
 template <BPLUS_TEMPLATES>
 BPlusTree<BPLUS_TEMPLATE_PARAMS>::BPlusTree(BPlusTree &&other) noexcept
     : m_root(std::exchange(other.m_root, nullptr)),
-      m_leaf_allocator(std::move(other.m_leaf_allocator)),
       m_comp(std::move(other.m_comp)),
+      m_allocator(std::move(other.m_allocator)),
+      m_leaf_allocator(std::move(other.m_leaf_allocator)),
+      m_internal_allocator(std::move(other.m_internal_allocator)),
       m_head(std::exchange(other.m_head, nullptr)),
-      m_tail(std::exchange(other.m_tail, nullptr)) {}
+      m_tail(std::exchange(other.m_tail, nullptr)),
+      m_size(std::exchange(other.m_size, 0)),
+      m_shared(std::exchange(other.m_shared, false)),
+      m_versions(std::move(other.m_versions)),
+      m_index(std::move(other.m_index)) {
+  if constexpr (C_INDEXED) {
+    other.m_index.clear();
+  }
+  other.notify_write(nullptr);
+}
 
 template <BPLUS_TEMPLATES>
 BPlusTree<BPLUS_TEMPLATE_PARAMS>::BPlusTree(BPlusTree &&other,
                                             const Allocator &alloc)
-    : m_comp(other.m_comp) {
+    : BPlusTree(other.m_comp, alloc) {
 
-  if (alloc == other.m_leaf_allocator) {
-    m_leaf_allocator = std::move(other.m_leaf_allocator);
+  if (alloc == other.m_allocator) {
     m_root = std::exchange(other.m_root, nullptr);
     m_head = std::exchange(other.m_head, nullptr);
     m_tail = std::exchange(other.m_tail, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    m_shared = std::exchange(other.m_shared, false);
+    m_versions = std::move(other.m_versions);
+    if constexpr (C_INDEXED) {
+      m_index.swap(other.m_index);
+    }
+    other.notify_write(nullptr);
     return;
   }
 
-  throw std::runtime_error("Move constructor with allocator not implemented if "
-                           "allocator is not equal to other allocator");
+  // Nodes of other cant be freed by alloc, move the values into a clone
+  clone_from(other, [this](value_type *value) {
+    return create_value(std::move(*value));
+  });
+  other.clear();
 }
 
 template <BPLUS_TEMPLATES>
 BPlusTree<BPLUS_TEMPLATE_PARAMS> &
-BPlusTree<BPLUS_TEMPLATE_PARAMS>::operator=(BPlusTree &&other) noexcept {
+BPlusTree<BPLUS_TEMPLATE_PARAMS>::operator=(BPlusTree &&other) noexcept(
+    std::allocator_traits<Allocator>::propagate_on_container_move_assignment::
+        value ||
+    std::allocator_traits<Allocator>::is_always_equal::value) {
+
+  if (this == &other) {
+    return *this;
+  }
 
-  if (this != &other) {
+  constexpr bool propagate =
+      allocator_traits::propagate_on_container_move_assignment::value;
+  if constexpr (!propagate && !allocator_traits::is_always_equal::value) {
+    if (!(m_allocator == other.m_allocator)) {
+      // Nodes of other cant be freed by our allocator, the values are moved
+      // into a clone built aside as the allocator-aware move constructor does
+      BPlusTree moved(std::move(other), m_allocator);
+      take_over(moved, false);
+      return *this;
+    }
+  }
+  take_over(other, propagate);
+  return *this;
+}
 
-    this->clear();
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::take_over(BPlusTree &other,
+                                                 bool propagate) noexcept {
+  clear();
 
-    m_root = std::exchange(other.m_root, nullptr);
+  m_root = std::exchange(other.m_root, nullptr);
+  if (propagate) {
+    m_allocator = std::move(other.m_allocator);
     m_leaf_allocator = std::move(other.m_leaf_allocator);
-    m_comp = std::move(other.m_comp);
-    m_head = std::exchange(other.m_head, nullptr);
-    m_tail = std::exchange(other.m_tail, nullptr);
+    m_internal_allocator = std::move(other.m_internal_allocator);
   }
-
-  return *this;
+  m_comp = std::move(other.m_comp);
+  m_head = std::exchange(other.m_head, nullptr);
+  m_tail = std::exchange(other.m_tail, nullptr);
+  m_size = std::exchange(other.m_size, 0);
+  m_shared = std::exchange(other.m_shared, false);
+  m_versions = std::move(other.m_versions);
+  if constexpr (C_INDEXED) {
+    m_index.swap(other.m_index);
+  }
+  notify_write(nullptr);
+  other.notify_write(nullptr);
 }
 
 template <BPLUS_TEMPLATES>
@@ -478,22 +1471,13 @@ BPlusTree<BPLUS_TEMPLATE_PARAMS>::operator=(const BPlusTree &other) {
     return *this;
   }
 
-  m_comp = other.m_comp;
-
-  if constexpr (allocator_traits::propagate_on_container_copy_assignment::
-                    value) {
-    m_leaf_allocator = other.m_leaf_allocator;
-  }
-
-  if (m_leaf_allocator != other.m_leaf_allocator) {
-    this->clear();
-    // m_root = new;
-  }
-
-  // copy
-
-  return *this;
-}
+  // The clone is built aside, so on exception *this is left unchanged
+  constexpr bool propagate =
+      allocator_traits::propagate_on_container_copy_assignment::value;
+  BPlusTree copy(other, propagate ? other.m_allocator : m_allocator);
+  take_over(copy, propagate);
+  return *this;
+}
 
 template <BPLUS_TEMPLATES>
 BPlusTree<BPLUS_TEMPLATE_PARAMS> &BPlusTree<BPLUS_TEMPLATE_PARAMS>::operator=(
@@ -510,7 +1494,7 @@ template <BPLUS_TEMPLATES>
 BPlusTree<BPLUS_TEMPLATE_PARAMS>::BPlusTree(
     std::initializer_list<value_type> init, const Compare &comp,
     const Allocator &alloc)
-    : m_comp(comp), m_leaf_allocator(alloc) {
+    : BPlusTree(comp, alloc) {
   insert(init);
 }
 
@@ -519,48 +1503,3029 @@ BPlusTree<BPLUS_TEMPLATE_PARAMS>::BPlusTree(
 template <BPLUS_TEMPLATES>
 auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert(const value_type &value)
     -> std::pair<iterator, bool> {
-
-  if (m_root == nullptr) {
-    m_root = new LeafNode(m_leaf_allocator, m_comp);
-  }
-  m_root.insert(value);
+  return insert_unique(
+      Indexor{}(value), [this, &value] { return create_value(value); },
+      sizeof(value_type));
 }
 
 template <BPLUS_TEMPLATES>
 auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert(value_type &&value)
     -> std::pair<iterator, bool> {
-  if (m_root == nullptr) {
-    m_root = new LeafNode(m_leaf_allocator, m_comp);
-  }
-  return m_root.insert(std::move(value));
+  return insert_unique(
+      Indexor{}(value),
+      [this, &value] { return create_value(std::move(value)); },
+      sizeof(value_type));
 }
 
 template <BPLUS_TEMPLATES>
 auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert(const_iterator position,
                                               const value_type &value)
     -> iterator {
-  if (m_root == nullptr) {
-    m_root = new LeafNode(m_leaf_allocator, m_comp);
-  }
-  return m_root.insert(position, value);
+  return insert_hint(
+      position, Indexor{}(value),
+      [this, &value] { return create_value(value); }, sizeof(value_type));
 }
 
 template <BPLUS_TEMPLATES>
 auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert(const_iterator position,
                                               value_type &&value) -> iterator {
-  if (m_root == nullptr) {
-    m_root = new LeafNode(m_leaf_allocator, m_comp);
+  return insert_hint(
+      position, Indexor{}(value),
+      [this, &value] { return create_value(std::move(value)); },
+      sizeof(value_type));
+}
+
+template <BPLUS_TEMPLATES>
+template <
+    ValueInputIterator<typename BPlusTree<BPLUS_TEMPLATE_PARAMS>::value_type>
+        InputIt>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert(InputIt first, InputIt last) {
+  for (; first != last; ++first) {
+    emplace(*first);
   }
-  m_root.insert(position, std::move(value));
 }
 
 template <BPLUS_TEMPLATES>
 void BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert(
     std::initializer_list<value_type> ilist) {
+  insert(ilist.begin(), ilist.end());
+}
+
+template <BPLUS_TEMPLATES>
+template <typename... Args>
+  requires std::constructible_from<
+      typename BPlusTree<BPLUS_TEMPLATE_PARAMS>::value_type, Args...>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::emplace(Args &&...args)
+    -> std::pair<iterator, bool> {
+  return insert_created(create_value(std::forward<Args>(args)...));
+}
+
+template <BPLUS_TEMPLATES>
+template <typename... Args>
+  requires std::constructible_from<
+      typename BPlusTree<BPLUS_TEMPLATE_PARAMS>::value_type, Args...>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::emplace_hint(const_iterator hint,
+                                                    Args &&...args)
+    -> iterator {
+  return insert_created(hint, create_value(std::forward<Args>(args)...));
+}
+
+template <BPLUS_TEMPLATES>
+template <typename... Args>
+  requires std::constructible_from<
+      typename BPlusTree<BPLUS_TEMPLATE_PARAMS>::data_type, Args...>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::try_emplace(const key_type &key,
+                                                   Args &&...args)
+    -> std::pair<iterator, bool> {
+  return insert_unique(
+      key,
+      [&] {
+        return create_value(
+            std::piecewise_construct, std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+      },
+      sizeof(value_type));
+}
+
+template <BPLUS_TEMPLATES>
+template <typename... Args>
+  requires std::constructible_from<
+      typename BPlusTree<BPLUS_TEMPLATE_PARAMS>::data_type, Args...>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::try_emplace(key_type &&key,
+                                                   Args &&...args)
+    -> std::pair<iterator, bool> {
+  // The key is only moved from once its position is found, the descent does
+  // not read it afterwards
+  return insert_unique(
+      key,
+      [&] {
+        return create_value(std::piecewise_construct,
+                            std::forward_as_tuple(std::move(key)),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+      },
+      sizeof(value_type));
+}
+
+template <BPLUS_TEMPLATES>
+template <typename... Args>
+  requires std::constructible_from<
+      typename BPlusTree<BPLUS_TEMPLATE_PARAMS>::data_type, Args...>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::try_emplace(const_iterator hint,
+                                                   const key_type &key,
+                                                   Args &&...args)
+    -> iterator {
+  return insert_hint(
+      hint, key,
+      [&] {
+        return create_value(
+            std::piecewise_construct, std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+      },
+      sizeof(value_type));
+}
+
+template <BPLUS_TEMPLATES>
+template <typename... Args>
+  requires std::constructible_from<
+      typename BPlusTree<BPLUS_TEMPLATE_PARAMS>::data_type, Args...>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::try_emplace(const_iterator hint,
+                                                   key_type &&key,
+                                                   Args &&...args)
+    -> iterator {
+  return insert_hint(
+      hint, key,
+      [&] {
+        return create_value(std::piecewise_construct,
+                            std::forward_as_tuple(std::move(key)),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+      },
+      sizeof(value_type));
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert_created(value_type *value)
+    -> std::pair<iterator, bool> {
+  std::pair<iterator, bool> result;
+  try {
+    result = insert_unique(
+        Indexor{}(*value), [value] { return value; }, 0);
+  } catch (...) {
+    destroy_value(value);
+    throw;
+  }
+  if (!result.second) {
+    destroy_value(value);
+  }
+  return result;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert_created(const_iterator hint,
+                                                      value_type *value)
+    -> iterator {
+  bool linked = false;
+  iterator result;
+  try {
+    result = insert_hint(
+        hint, Indexor{}(*value),
+        [value, &linked] {
+          linked = true;
+          return value;
+        },
+        0);
+  } catch (...) {
+    destroy_value(value);
+    throw;
+  }
+  if (!linked) {
+    destroy_value(value);
+  }
+  return result;
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K, typename Make>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert_hint(const_iterator hint,
+                                                   const K &key, Make &&make,
+                                                   size_type value_bytes)
+    -> iterator {
+  // Inserting inside a leaf, or after the last value, leaves every separator
+  // valid. Aggregates of the ancestors would need the descent anyway.
+  if constexpr (!C_AUGMENTED) {
+    const auto at_end = hint.m_leaf == nullptr;
+    auto *leaf = at_end ? m_tail : hint.m_leaf;
+    const auto index = at_end && leaf != nullptr ? leaf->m_count : hint.m_index;
+    if (!shared() && leaf != nullptr && !leaf->full() && index > 0 &&
+        within_budget(value_bytes) && m_comp(leaf->key(index - 1), key) &&
+        (at_end || m_comp(key, leaf->key(index)))) {
+      leaf->insert_at(index, make_indexed(key, make));
+      ++m_size;
+      record([](auto &counters) { ++counters.hint_hits; });
+      notify_write(leaf->m_values[index]);
+      return iterator(leaf, index, this);
+    }
+  }
+  record([](auto &counters) { ++counters.hint_misses; });
+  return insert_unique(key, make, value_bytes).first;
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K, typename Make>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert_unique(const K &key, Make &&make,
+                                                     size_type value_bytes)
+    -> std::pair<iterator, bool> {
+  make_room(key, value_bytes);
+
+  if (m_root == nullptr) {
+    m_head = m_tail = create_leaf();
+    m_root = m_head;
+  }
+  unshare_path(key, false);
+
+  record([](auto &counters) { ++counters.descents; });
+  Split split;
+  auto result = insert_descend(m_root, key, make, split);
+
+  if (split) {
+    // The root was split, grow the tree by one level
+    m_root = make_root(m_root, std::move(split->first), split->second);
+  }
+  // The leaf of key was unshared before the descent
+  result.first.m_tree = this;
+  notify_write(&*result.first);
+  return result;
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K, typename Make>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert_descend(NodeHandler_ node,
+                                                      const K &key, Make &make,
+                                                      Split &split)
+    -> std::pair<iterator, bool> {
+
+  if (node.m_isLeaf) {
+    auto *leaf = node.leaf();
+    auto position = leaf->lower_bound(key, m_comp);
+
+    // If the value is already in the leaf, return it
+    if (position < leaf->m_count && !m_comp(key, leaf->key(position))) {
+      return {iterator(leaf, position), false};
+    }
+
+    if (!leaf->full()) {
+      leaf->insert_at(position, make_indexed(key, make));
+      ++m_size;
+      return {iterator(leaf, position), true};
+    }
+
+    auto *right = create_leaf();
+    value_type *value = nullptr;
+    try {
+      value = make_indexed(key, make);
+    } catch (...) {
+      destroy_subtree(right);
+      throw;
+    }
+    auto [target, index] = leaf->split_insert(position, value, *right);
+    ++m_size;
+    record([](auto &counters) { ++counters.leaf_splits; });
+    if (m_tail == leaf) {
+      m_tail = right;
+    }
+    split.emplace(right->key(0), right);
+    return {iterator(target, index), true};
+  }
+
+  auto *inner = node.internal();
+  auto index = inner->child_index(key, m_comp);
+
+  Split child_split;
+  auto result =
+      insert_descend(inner->m_children[index], key, make, child_split);
+
+  if constexpr (C_AUGMENTED) {
+    if (result.second) {
+      inner->m_aggregates[index] = aggregate_of(inner->m_children[index]);
+    }
+  }
+
+  if (child_split) {
+    attach_child(inner, index, std::move(child_split->first),
+                 child_split->second, split);
+  }
+  return result;
+}
+
+// *** Erasure *** //
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::erase(const key_type &key)
+    -> size_type {
+  return erase_of(key);
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+  requires(!std::convertible_to<K, typename BPlusTree<
+                                       BPLUS_TEMPLATE_PARAMS>::iterator> &&
+           !std::convertible_to<
+               K, typename BPlusTree<BPLUS_TEMPLATE_PARAMS>::const_iterator>)
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::erase(const K &key) -> size_type {
+  return erase_of(key);
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::erase_of(const K &key) -> size_type {
+  auto *value = detach(key);
+  if (value == nullptr) {
+    return 0;
+  }
+  destroy_value(value);
+  return 1;
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::detach(const K &key) -> value_type * {
+  if (m_root == nullptr) {
+    return nullptr;
+  }
+  unshare_path(key, true);
+  record([](auto &counters) { ++counters.descents; });
+  auto *value = erase_descend(m_root, key);
+  if (value != nullptr) {
+    shrink_root();
+    if constexpr (C_INDEXED) {
+      m_index.erase(Indexor{}(*value));
+    }
+    notify_write(value);
+  }
+  return value;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::erase(iterator position) -> iterator {
+  return erase(const_iterator(position));
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::erase(const_iterator position)
+    -> iterator {
+  const key_type key(Indexor{}(*position));
+  erase(key);
+  return owned(lower_bound_of(key));
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::erase(const_iterator first,
+                                             const_iterator last)
+    -> iterator {
+  if (first == last) {
+    return owned(iterator(first.m_leaf, first.m_index));
+  }
+  if (first == cbegin() && last == cend()) {
+    clear();
+    return end();
+  }
+
+  std::optional<key_type> high;
+  if (last != cend()) {
+    high.emplace(Indexor{}(*last));
+  }
+
+  // Ranges inside a single leaf are cheaper to erase one by one
+  const auto *last_leaf = high ? last.m_leaf : m_tail;
+  const auto last_index = high ? last.m_index : m_tail->m_count;
+  if (first.m_leaf == last_leaf) {
+    const key_type low(Indexor{}(*first));
+    for (auto count = last_index - first.m_index; count > 0; --count) {
+      erase(key_type(Indexor{}(*lower_bound_of(low))));
+    }
+    return high ? owned(lower_bound_of(*high)) : end();
+  }
+
+  // Cut the range out of the tree and join what is left at both sides, only
+  // the nodes along both cut paths are touched besides the dropped ones.
+  // Those shared with a snapshot are copied, the dropped ones released.
+  const key_type low(Indexor{}(*first));
+  auto [before, removed] = split_piece({m_root, height()}, low);
+  Piece after;
+  if (high) {
+    std::tie(removed, after) = split_piece(removed, *high);
+  }
+  if constexpr (C_INDEXED) {
+    visit_values(removed.root, [this](const value_type *value) {
+      m_index.erase(Indexor{}(*value));
+    });
+  }
+  if (shared()) {
+    // The cut ends the leaf chain of the dropped piece
+    for (auto *leaf = leftmost_leaf(removed.root); leaf != nullptr;
+         leaf = leaf->m_next) {
+      m_size -= leaf->m_count;
+    }
+    release(removed.root);
+  } else {
+    m_size -= destroy_subtree(removed.root);
+  }
+
+  if (before.root == nullptr || after.root == nullptr) {
+    m_root = before.root == nullptr ? after.root : before.root;
+  } else {
+    auto *before_tail = rightmost_leaf(before.root);
+    auto *after_head = leftmost_leaf(after.root);
+    before_tail->m_next = after_head;
+    after_head->m_prev = before_tail;
+    m_root = join_pieces(before, key_type(after_head->key(0)), after).root;
+  }
+  fix_head_tail();
+  notify_write(nullptr);
+
+  return high ? owned(lower_bound_of(*high)) : end();
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::erase_descend(NodeHandler_ node,
+                                                     const K &key)
+    -> value_type * {
+  if (node.m_isLeaf) {
+    auto *leaf = node.leaf();
+    auto position = leaf->lower_bound(key, m_comp);
+    if (position == leaf->m_count || m_comp(key, leaf->key(position))) {
+      return nullptr;
+    }
+    --m_size;
+    return leaf->erase_at(position);
+  }
+
+  auto *inner = node.internal();
+  auto index = inner->child_index(key, m_comp);
+  auto *value = erase_descend(inner->m_children[index], key);
+  if (value == nullptr) {
+    return nullptr;
+  }
+
+  if (underfull(inner->m_children[index])) {
+    rebalance_child(inner, index);
+  } else if constexpr (C_AUGMENTED) {
+    inner->m_aggregates[index] = aggregate_of(inner->m_children[index]);
+  }
+  return value;
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::rebalance_child(InternalNode *inner,
+                                                       size_type index) {
+  // Pair the child with its left sibling, or the right one for the first
+  const auto left = index > 0 ? index - 1 : index;
+  const auto right = left + 1;
+  auto sibling = inner->m_children[left == index ? right : left];
+
+  if (can_lend(sibling)) {
+    inner->m_keys[left] =
+        balance_nodes(inner->m_children[left], std::move(inner->m_keys[left]),
+                      inner->m_children[right]);
+    if constexpr (C_AUGMENTED) {
+      inner->m_aggregates[left] = aggregate_of(inner->m_children[left]);
+      inner->m_aggregates[right] = aggregate_of(inner->m_children[right]);
+    }
+    return;
+  }
+
+  merge_nodes(inner->m_children[left], std::move(inner->m_keys[left]),
+              inner->m_children[right]);
+  inner->erase_at(left);
+  if constexpr (C_AUGMENTED) {
+    inner->m_aggregates[left] = aggregate_of(inner->m_children[left]);
+  }
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::shrink_root() {
+  if (m_root.m_isLeaf) {
+    if (m_root.leaf()->m_count == 0) {
+      destroy_node(m_root);
+      m_root = nullptr;
+      m_head = nullptr;
+      m_tail = nullptr;
+    }
+    return;
+  }
+
+  auto *root = m_root.internal();
+  if (root->m_count == 0) {
+    m_root = root->m_children[0];
+    destroy_node(root);
+  }
+}
+
+template <BPLUS_TEMPLATES>
+bool BPlusTree<BPLUS_TEMPLATE_PARAMS>::underfull(NodeHandler_ node) const {
+  return node.m_isLeaf ? node.leaf()->m_count < C_MIN_LEAF_KEYS
+                       : node.internal()->m_count < C_MIN_INTERNAL_KEYS;
+}
+
+template <BPLUS_TEMPLATES>
+bool BPlusTree<BPLUS_TEMPLATE_PARAMS>::can_lend(NodeHandler_ node) const {
+  return node.m_isLeaf ? node.leaf()->m_count > C_MIN_LEAF_KEYS
+                       : node.internal()->m_count > C_MIN_INTERNAL_KEYS;
+}
+
+template <BPLUS_TEMPLATES>
+bool BPlusTree<BPLUS_TEMPLATE_PARAMS>::fits(NodeHandler_ left,
+                                            NodeHandler_ right) const {
+  if (left.m_isLeaf) {
+    return left.leaf()->m_count + right.leaf()->m_count <= M - 1;
+  }
+  return left.internal()->m_count + right.internal()->m_count + 1 <= M - 1;
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::merge_nodes(NodeHandler_ left,
+                                                   Key separator,
+                                                   NodeHandler_ right) {
+  if (left.m_isLeaf) {
+    left.leaf()->merge_from(*right.leaf());
+    if (m_tail == right.leaf()) {
+      m_tail = left.leaf();
+    }
+    record([](auto &counters) { ++counters.leaf_merges; });
+  } else {
+    left.internal()->merge_from(std::move(separator), *right.internal());
+    record([](auto &counters) { ++counters.internal_merges; });
+  }
+  destroy_node(right);
+}
+
+template <BPLUS_TEMPLATES>
+Key BPlusTree<BPLUS_TEMPLATE_PARAMS>::balance_nodes(NodeHandler_ left,
+                                                    Key separator,
+                                                    NodeHandler_ right) {
+  record([](auto &counters) { ++counters.rebalances; });
+  if (left.m_isLeaf) {
+    left.leaf()->balance_with(*right.leaf());
+    return Key(right.leaf()->key(0));
+  }
+  return left.internal()->balance_with(std::move(separator), *right.internal());
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::join_pieces(Piece left, Key separator,
+                                                   Piece right) -> Piece {
+  if (left.root == nullptr) {
+    return right;
+  }
+  if (right.root == nullptr) {
+    return left;
+  }
+
+  // Nodes shared with a snapshot are copied before they are written, those
+  // off both spines stay shared
+  if (left.height == right.height) {
+    if (fits(left.root, right.root)) {
+      claim(left.root);
+      claim(right.root);
+      merge_nodes(left.root, std::move(separator), right.root);
+      return left;
+    }
+    if (underfull(left.root) || underfull(right.root)) {
+      claim(left.root);
+      claim(right.root);
+      separator = balance_nodes(left.root, std::move(separator), right.root);
+    }
+    return {make_root(left.root, std::move(separator), right.root),
+            left.height + 1};
+  }
+
+  Split split;
+  claim(left.height > right.height ? left.root : right.root);
+  Piece joined = left.height > right.height ? left : right;
+  if (left.height > right.height) {
+    join_right(left.root, left.height, right, std::move(separator), split);
+  } else {
+    join_left(right.root, right.height, left, std::move(separator), split);
+  }
+
+  if (split) {
+    return {make_root(joined.root, std::move(split->first), split->second),
+            joined.height + 1};
+  }
+  return joined;
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::join_right(NodeHandler_ node,
+                                                  size_type height,
+                                                  Piece right, Key separator,
+                                                  Split &split) {
+  auto *inner = node.internal();
+  const auto last = inner->m_count;
+
+  if (height > right.height + 1) {
+    Split child_split;
+    claim(inner->m_children[last]);
+    join_right(inner->m_children[last], height - 1, right,
+               std::move(separator), child_split);
+    if constexpr (C_AUGMENTED) {
+      inner->m_aggregates[last] = aggregate_of(inner->m_children[last]);
+    }
+    if (child_split) {
+      attach_child(inner, last, std::move(child_split->first),
+                   child_split->second, split);
+    }
+    return;
+  }
+
+  // right becomes the last child, its root may be below the fill bounds
+  auto &child = inner->m_children[last];
+  if (underfull(right.root)) {
+    claim(child);
+    claim(right.root);
+    if (fits(child, right.root)) {
+      merge_nodes(child, std::move(separator), right.root);
+      if constexpr (C_AUGMENTED) {
+        inner->m_aggregates[last] = aggregate_of(child);
+      }
+      return;
+    }
+    separator = balance_nodes(child, std::move(separator), right.root);
+    if constexpr (C_AUGMENTED) {
+      inner->m_aggregates[last] = aggregate_of(child);
+    }
+  }
+  attach_child(inner, last, std::move(separator), right.root, split);
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::join_left(NodeHandler_ node,
+                                                 size_type height, Piece left,
+                                                 Key separator, Split &split) {
+  auto *inner = node.internal();
+
+  if (height > left.height + 1) {
+    Split child_split;
+    claim(inner->m_children[0]);
+    join_left(inner->m_children[0], height - 1, left, std::move(separator),
+              child_split);
+    if constexpr (C_AUGMENTED) {
+      inner->m_aggregates[0] = aggregate_of(inner->m_children[0]);
+    }
+    if (child_split) {
+      attach_child(inner, 0, std::move(child_split->first),
+                   child_split->second, split);
+    }
+    return;
+  }
+
+  // left becomes the first child, its root may be below the fill bounds
+  auto &child = inner->m_children[0];
+  if (underfull(left.root)) {
+    claim(left.root);
+    claim(child);
+    if (fits(left.root, child)) {
+      merge_nodes(left.root, std::move(separator), child);
+      inner->m_children[0] = left.root;
+      if constexpr (C_AUGMENTED) {
+        inner->m_aggregates[0] = aggregate_of(left.root);
+      }
+      return;
+    }
+    separator = balance_nodes(left.root, std::move(separator), child);
+    if constexpr (C_AUGMENTED) {
+      inner->m_aggregates[0] = aggregate_of(child);
+    }
+  }
+  attach_child(inner, 0, std::move(separator), left.root, split);
+  inner->swap_front_children();
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::split_piece(Piece piece,
+                                                   const key_type &key)
+    -> std::pair<Piece, Piece> {
+  if (piece.root == nullptr) {
+    return {};
+  }
+
+  if (piece.root.m_isLeaf) {
+    auto *leaf = piece.root.leaf();
+    auto position = leaf->lower_bound(key, m_comp);
+
+    if (position == 0) {
+      if (leaf->m_prev != nullptr) {
+        leaf->m_prev->m_next = nullptr;
+      }
+      leaf->m_prev = nullptr;
+      return {{}, piece};
+    }
+    if (position == leaf->m_count) {
+      if (leaf->m_next != nullptr) {
+        leaf->m_next->m_prev = nullptr;
+      }
+      leaf->m_next = nullptr;
+      return {piece, {}};
+    }
+
+    claim(piece.root);
+    leaf = piece.root.leaf();
+    auto *right = create_leaf();
+    leaf->move_tail(position, *right);
+    right->m_next = leaf->m_next;
+    if (right->m_next != nullptr) {
+      right->m_next->m_prev = right;
+    }
+    leaf->m_next = nullptr;
+    return {piece, {right, 0}};
+  }
+
+  // The nodes along the cut are copied if shared, the subtrees off it stay
+  // shared
+  claim(piece.root);
+  auto *inner = piece.root.internal();
+  const auto index = inner->child_index(key, m_comp);
+  const auto count = inner->m_count;
+  const auto child_height = piece.height - 1;
+
+  auto [child_left, child_right] =
+      split_piece({inner->m_children[index], child_height}, key);
+
+  // The separators around the cut child bound the pieces at both sides
+  key_type left_separator{};
+  key_type right_separator{};
+  if (index > 0) {
+    left_separator = std::move(inner->m_keys[index - 1]);
+  }
+  if (index < count) {
+    right_separator = std::move(inner->m_keys[index]);
+  }
+
+  const auto before_count = index;
+  const auto after_count = count - index;
+  Piece before;
+  Piece after;
+  if (before_count == 1) {
+    before = {inner->m_children[0], child_height};
+  } else if (before_count > 1) {
+    before = piece;
+  }
+  InternalNode *right = nullptr;
+  if (after_count == 1) {
+    after = {inner->m_children[count], child_height};
+  } else if (after_count > 1) {
+    right = create_internal();
+    after = {right, piece.height};
+  }
+
+  inner->detach_child(index, right);
+  if (before_count <= 1) {
+    destroy_node(inner);
+  }
+
+  return {join_pieces(before, std::move(left_separator), child_left),
+          join_pieces(child_right, std::move(right_separator), after)};
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::split(const key_type &key,
+                                             BPlusTree &other) {
+  if (&other == this) {
+    return;
+  }
+  other.clear();
   if (m_root == nullptr) {
-    m_root = new LeafNode(m_leaf_allocator, m_comp);
+    return;
+  }
+
+  if (!shares_allocator(other)) {
+    auto first = lower_bound_of(key);
+    other.insert(const_iterator(first), cend());
+    erase(first, cend());
+    return;
+  }
+
+  // Only the nodes along the cut are copied, the right part keeps sharing
+  // the others with the snapshots of this tree
+  other.adopt_versions(*this);
+  auto [left, right] = split_piece({m_root, height()}, key);
+  const auto moved = count_split(left.root, right.root);
+
+  m_root = left.root;
+  m_size -= moved;
+  fix_head_tail();
+
+  other.m_root = right.root;
+  other.m_size = moved;
+  other.fix_head_tail();
+  if constexpr (C_INDEXED) {
+    // The entries of the smaller part move over without allocating new ones
+    if (moved <= m_size) {
+      visit_values(other.m_root, [this, &other](const value_type *value) {
+        other.m_index.insert(m_index.extract(Indexor{}(*value)));
+      });
+    } else {
+      m_index.swap(other.m_index);
+      visit_values(m_root, [this, &other](const value_type *value) {
+        m_index.insert(other.m_index.extract(Indexor{}(*value)));
+      });
+    }
+  }
+  notify_write(nullptr);
+  other.notify_write(nullptr);
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::join(BPlusTree &other) {
+  if (&other == this || other.m_root == nullptr) {
+    return;
+  }
+
+  bool other_first = false;
+  if (m_root != nullptr) {
+    if (m_comp(m_tail->key(m_tail->m_count - 1), other.m_head->key(0))) {
+      other_first = false;
+    } else if (m_comp(other.m_tail->key(other.m_tail->m_count - 1),
+                      m_head->key(0))) {
+      other_first = true;
+    } else {
+      throw std::runtime_error("Cant join trees with overlapping keys");
+    }
+  }
+
+  if (!shares_allocator(other)) {
+    insert(other.cbegin(), other.cend());
+    other.clear();
+    return;
+  }
+
+  // Only the nodes along the seam are copied, those of other keep being
+  // shared with its snapshots
+  adopt_versions(other);
+  if constexpr (C_INDEXED) {
+    // Copied leaves repoint the entries of their values
+    m_index.merge(other.m_index);
+  }
+  Piece left{m_root, height()};
+  Piece right{other.m_root, other.height()};
+  if (other_first) {
+    std::swap(left, right);
+  }
+  if (left.root != nullptr) {
+    auto *seam_tail = rightmost_leaf(left.root);
+    auto *seam_head = leftmost_leaf(right.root);
+    seam_tail->m_next = seam_head;
+    seam_head->m_prev = seam_tail;
+    m_root = join_pieces(left, key_type(seam_head->key(0)), right).root;
+  } else {
+    m_root = right.root;
+  }
+  m_size += other.m_size;
+  fix_head_tail();
+
+  other.m_root = nullptr;
+  other.m_size = 0;
+  other.fix_head_tail();
+  notify_write(nullptr);
+  other.notify_write(nullptr);
+}
+
+// *** Node handles *** //
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::extract(const_iterator position)
+    -> node_type {
+  return extract(Indexor{}(*position));
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::extract(const key_type &key)
+    -> node_type {
+  auto *value = detach(key);
+  return value == nullptr ? node_type() : node_type(value, m_allocator);
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+  requires(!std::convertible_to<K, typename BPlusTree<
+                                       BPLUS_TEMPLATE_PARAMS>::iterator> &&
+           !std::convertible_to<
+               K, typename BPlusTree<BPLUS_TEMPLATE_PARAMS>::const_iterator>)
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::extract(const K &key) -> node_type {
+  auto *value = detach(key);
+  return value == nullptr ? node_type() : node_type(value, m_allocator);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert(node_type &&node)
+    -> insert_return_type {
+  if (node.empty()) {
+    return {end_of(), false, node_type()};
+  }
+
+  const auto relinked = *node.m_allocator == m_allocator;
+  auto [position, inserted] = insert_unique(
+      Indexor{}(node.value()),
+      [this, &node, relinked] {
+        return relinked ? node.release()
+                        : create_value(std::move(node.value()));
+      },
+      relinked ? 0 : sizeof(value_type));
+  if (!inserted) {
+    return {position, false, std::move(node)};
+  }
+  node.reset();
+  return {position, true, node_type()};
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::insert(const_iterator hint,
+                                              node_type &&node) -> iterator {
+  if (node.empty()) {
+    return end_of();
+  }
+
+  const auto relinked = *node.m_allocator == m_allocator;
+  bool linked = false;
+  const auto position = insert_hint(
+      hint, Indexor{}(node.value()),
+      [this, &node, relinked, &linked] {
+        linked = true;
+        return relinked ? node.release()
+                        : create_value(std::move(node.value()));
+      },
+      relinked ? 0 : sizeof(value_type));
+  if (linked) {
+    node.reset();
+  }
+  return position;
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::merge(BPlusTree &source) {
+  if (this == &source || source.m_root == nullptr) {
+    return;
+  }
+
+  // Disjoint key ranges are concatenated without visiting the values
+  if (shares_allocator(source) &&
+      (m_root == nullptr ||
+       m_comp(m_tail->key(m_tail->m_count - 1), source.m_head->key(0)) ||
+       m_comp(source.m_tail->key(source.m_tail->m_count - 1),
+              m_head->key(0)))) {
+    join(source);
+    return;
+  }
+
+  for (auto it = source.cbegin(); it != source.cend();) {
+    if (contains(Indexor{}(*it))) {
+      ++it;
+      continue;
+    }
+    // The budget callback may modify both trees, so the next position is
+    // only looked up once the value is linked
+    auto result = insert(source.extract(it));
+    if (!result.inserted) {
+      source.insert(std::move(result.node));
+    }
+    it = std::as_const(source).upper_bound(Indexor{}(*result.position));
+  }
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::merge(BPlusTree &&source) {
+  merge(source);
+}
+
+// *** Set algebra *** //
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::assign_union(const BPlusTree &first,
+                                                    const BPlusTree &second) {
+  assign_merge<SetOperation::Union>(first, second);
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::assign_intersection(
+    const BPlusTree &first, const BPlusTree &second) {
+  assign_merge<SetOperation::Intersection>(first, second);
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::assign_difference(
+    const BPlusTree &first, const BPlusTree &second) {
+  assign_merge<SetOperation::Difference>(first, second);
+}
+
+template <BPLUS_TEMPLATES>
+template <typename BPlusTree<BPLUS_TEMPLATE_PARAMS>::SetOperation Operation>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::assign_merge(const BPlusTree &first,
+                                                    const BPlusTree &second) {
+  // The result is built aside, a failure leaves this tree untouched
+  BPlusTree built(m_comp, m_allocator);
+  std::vector<value_type *> values;
+  if constexpr (Operation == SetOperation::Intersection) {
+    values.reserve(std::min(first.size(), second.size()));
+  } else if constexpr (Operation == SetOperation::Union) {
+    values.reserve(first.size() + second.size());
+  } else {
+    values.reserve(first.size());
+  }
+
+  try {
+    auto emit = [this, &values](const value_type &value) {
+      values.push_back(create_value(value));
+    };
+    auto a = first.cbegin();
+    auto b = second.cbegin();
+    const auto a_end = first.cend();
+    const auto b_end = second.cend();
+
+    while (a != a_end && b != b_end) {
+      const auto &a_key = Indexor{}(*a);
+      const auto &b_key = Indexor{}(*b);
+      if (m_comp(a_key, b_key)) {
+        if constexpr (Operation == SetOperation::Intersection) {
+          a = first.seek(a, b_key);
+        } else {
+          emit(*a);
+          ++a;
+        }
+      } else if (m_comp(b_key, a_key)) {
+        if constexpr (Operation == SetOperation::Union) {
+          emit(*b);
+          ++b;
+        } else {
+          b = second.seek(b, a_key);
+        }
+      } else {
+        if constexpr (Operation != SetOperation::Difference) {
+          emit(*a);
+        }
+        ++a;
+        ++b;
+      }
+    }
+
+    if constexpr (Operation != SetOperation::Intersection) {
+      std::for_each(a, a_end, emit);
+    }
+    if constexpr (Operation == SetOperation::Union) {
+      std::for_each(b, b_end, emit);
+    }
+  } catch (...) {
+    std::for_each(values.begin(), values.end(),
+                  [this](value_type *value) { destroy_value(value); });
+    throw;
+  }
+
+  built.bulk_build(values);
+  // The old nodes are released along with built
+  swap(built);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::seek(const_iterator it,
+                                            const key_type &key) const
+    -> const_iterator {
+  auto *leaf = it.m_leaf;
+  if (m_comp(leaf->key(leaf->m_count - 1), key)) {
+    // key lies past this leaf, descend instead of walking the chain
+    return lower_bound(key);
+  }
+  auto index = it.m_index;
+  while (m_comp(leaf->key(index), key)) {
+    ++index;
+  }
+  return make_iterator(leaf, index);
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::bulk_build(
+    std::span<value_type *const> values) {
+  if (values.empty()) {
+    return;
+  }
+
+  // Spreads count entries over as few nodes of capacity as possible
+  auto spread = [](size_type count, size_type capacity, auto &&make_node) {
+    const auto nodes = (count + capacity - 1) / capacity;
+    size_type begin = 0;
+    for (size_type node = 0; node < nodes; ++node) {
+      const auto entries = count / nodes + (node < count % nodes ? 1 : 0);
+      make_node(begin, entries);
+      begin += entries;
+    }
+  };
+
+  std::vector<NodeHandler_> level;
+  std::vector<const value_type *> firsts;
+  // values[0, linked) belong to the leaves of level
+  size_type linked = 0;
+  try {
+    const auto leaves = (values.size() + M - 2) / (M - 1);
+    level.reserve(leaves);
+    firsts.reserve(leaves);
+    LeafNode *previous = nullptr;
+    spread(values.size(), M - 1, [&](size_type begin, size_type entries) {
+      auto *leaf = create_leaf();
+      std::copy_n(values.begin() + begin, entries, leaf->m_values.begin());
+      leaf->m_count = entries;
+      level.emplace_back(leaf);
+      firsts.push_back(values[begin]);
+      linked = begin + entries;
+      leaf->refresh_fingerprints();
+      leaf->m_prev = previous;
+      if (previous != nullptr) {
+        previous->m_next = leaf;
+      }
+      previous = leaf;
+    });
+  } catch (...) {
+    for (auto node : level) {
+      destroy_subtree(node);
+    }
+    for (auto *value : values.subspan(linked)) {
+      destroy_value(value);
+    }
+    throw;
+  }
+
+  while (level.size() > 1) {
+    std::vector<NodeHandler_> parents;
+    std::vector<const value_type *> parent_firsts;
+    // level[0, adopted) belongs to the nodes of parents
+    size_type adopted = 0;
+    try {
+      const auto count = (level.size() + M - 1) / M;
+      parents.reserve(count);
+      parent_firsts.reserve(count);
+      spread(level.size(), M, [&](size_type begin, size_type entries) {
+        auto *inner = create_internal();
+        inner->m_children[0] = level[begin];
+        inner->m_count = 0;
+        parents.emplace_back(inner);
+        parent_firsts.push_back(firsts[begin]);
+        adopted = begin + 1;
+        for (size_type i = 1; i < entries; ++i) {
+          inner->m_keys[i - 1] = Indexor{}(*firsts[begin + i]);
+          inner->m_children[i] = level[begin + i];
+          inner->m_count = i;
+          adopted = begin + i + 1;
+        }
+        if constexpr (C_AUGMENTED) {
+          for (size_type i = 0; i < entries; ++i) {
+            inner->m_aggregates[i] = aggregate_of(level[begin + i]);
+          }
+        }
+      });
+    } catch (...) {
+      for (auto node : parents) {
+        destroy_subtree(node);
+      }
+      for (size_type i = adopted; i < level.size(); ++i) {
+        destroy_subtree(level[i]);
+      }
+      throw;
+    }
+    level = std::move(parents);
+    firsts = std::move(parent_firsts);
+  }
+
+  // From here on the tree owns its nodes, also if the index throws
+  m_root = level.front();
+  m_size = values.size();
+  fix_head_tail();
+  rebuild_index();
+}
+
+// *** Snapshots *** //
+
+/**
+ * @class BPlusTree::Snapshot
+ * @brief Immutable view of a tree, see BPlusTree::snapshot()
+ * @details Copies are cheap and share the same nodes, which are freed along
+ * with the last tree or snapshot referencing them. A snapshot may outlive its
+ * tree, and its members may be called from several threads at once.
+ */
+template <BPLUS_TEMPLATES> class BPlusTree<BPLUS_TEMPLATE_PARAMS>::Snapshot {
+
+  friend class BPlusTree;
+
+public:
+  class const_iterator;
+
+  /// @brief Empty snapshot
+  Snapshot() = default;
+
+  [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+  [[nodiscard]] size_type size() const noexcept {
+    return m_version == nullptr ? 0 : m_version->m_size;
+  }
+
+  [[nodiscard]] const_iterator begin() const;
+  [[nodiscard]] const_iterator end() const noexcept { return {}; }
+
+  [[nodiscard]] const_iterator find(const key_type &key) const;
+  [[nodiscard]] bool contains(const key_type &key) const {
+    return find(key) != end();
+  }
+  [[nodiscard]] size_type count(const key_type &key) const {
+    return contains(key) ? 1 : 0;
+  }
+  [[nodiscard]] const_iterator lower_bound(const key_type &key) const {
+    return bound<false>(key);
+  }
+  [[nodiscard]] const_iterator upper_bound(const key_type &key) const {
+    return bound<true>(key);
+  }
+
+private:
+  explicit Snapshot(std::shared_ptr<const BPlusTree> version)
+      : m_version(std::move(version)) {}
+
+  template <bool Upper> const_iterator bound(const key_type &key) const;
+
+  /// Detached tree holding one reference to the shared root, its leaf chain
+  /// is neither used nor maintained
+  std::shared_ptr<const BPlusTree> m_version;
+};
+
+/**
+ * @class BPlusTree::Snapshot::const_iterator
+ * @brief Forward iterator over a snapshot
+ * @details The leaf chain belongs to the tree, which relinks it as it copies
+ * leaves, so the iterator keeps its path from the root instead and climbs it
+ * at the end of every leaf.
+ */
+template <BPLUS_TEMPLATES>
+class BPlusTree<BPLUS_TEMPLATE_PARAMS>::Snapshot::const_iterator {
+
+  friend class Snapshot;
+
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = BPlusTree::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const value_type *;
+  using reference = const value_type &;
+
+  const_iterator() = default;
+
+  reference operator*() const { return *m_leaf->m_values[m_index]; }
+  pointer operator->() const { return m_leaf->m_values[m_index]; }
+
+  const_iterator &operator++() {
+    if (++m_index == m_leaf->m_count) {
+      next_leaf();
+    }
+    return *this;
+  }
+
+  const_iterator operator++(int) {
+    auto copy = *this;
+    ++*this;
+    return copy;
+  }
+
+  bool operator==(const const_iterator &other) const noexcept {
+    return m_leaf == other.m_leaf && m_index == other.m_index;
+  }
+
+private:
+  /// @brief Moves to the first value of the leftmost leaf below node
+  void descend(NodeHandler_ node) {
+    while (!node.m_isLeaf) {
+      const auto *inner = node.internal();
+      m_path.emplace_back(inner, 0);
+      node = inner->m_children[0];
+    }
+    m_leaf = node.leaf();
+    m_index = 0;
+    if (m_leaf->m_count == 0) {
+      next_leaf();
+    }
+  }
+
+  /// @brief Moves to the first value of the next leaf, or to the end
+  void next_leaf() {
+    while (!m_path.empty() &&
+           m_path.back().second == m_path.back().first->m_count) {
+      m_path.pop_back();
+    }
+    if (m_path.empty()) {
+      m_leaf = nullptr;
+      m_index = 0;
+      return;
+    }
+    auto &[inner, child] = m_path.back();
+    descend(inner->m_children[++child]);
+  }
+
+  std::vector<std::pair<const InternalNode *, size_type>> m_path;
+  const LeafNode *m_leaf = nullptr;
+  size_type m_index = 0;
+};
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::Snapshot::begin() const
+    -> const_iterator {
+  const_iterator it;
+  if (m_version != nullptr && m_version->m_root != nullptr) {
+    it.descend(m_version->m_root);
+  }
+  return it;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::Snapshot::find(
+    const key_type &key) const -> const_iterator {
+  auto it = lower_bound(key);
+  if (it == end() || m_version->m_comp(key, Indexor{}(*it))) {
+    return end();
+  }
+  return it;
+}
+
+template <BPLUS_TEMPLATES>
+template <bool Upper>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::Snapshot::bound(
+    const key_type &key) const -> const_iterator {
+  const_iterator it;
+  if (m_version == nullptr || m_version->m_root == nullptr) {
+    return it;
+  }
+
+  const auto &comp = m_version->m_comp;
+  auto node = m_version->m_root;
+  while (!node.m_isLeaf) {
+    const auto *inner = node.internal();
+    const auto index = inner->child_index(key, comp);
+    it.m_path.emplace_back(inner, index);
+    node = inner->m_children[index];
+  }
+  it.m_leaf = node.leaf();
+  it.m_index = Upper ? it.m_leaf->upper_bound(key, comp)
+                     : it.m_leaf->lower_bound(key, comp);
+  if (it.m_index == it.m_leaf->m_count) {
+    it.next_leaf();
+  }
+  return it;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::snapshot() -> Snapshot
+  requires std::copy_constructible<value_type>
+{
+  if (m_versions == nullptr) {
+    m_versions = std::make_shared<Versions>();
+  }
+  auto *version = new BPlusTree(m_comp, m_allocator);
+  if (m_root != nullptr) {
+    refs(m_root).fetch_add(1, std::memory_order_relaxed);
+  }
+  version->m_root = m_root;
+  version->m_size = m_size;
+  return Snapshot(track_version(version, false));
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::replica(const allocator_type &alloc,
+                                               const Snapshot &previous,
+                                               const key_type *key)
+    -> Snapshot
+  requires std::copy_constructible<value_type>
+{
+  if (!(alloc == m_allocator)) {
+    throw std::runtime_error("Replica allocator cant free the tree nodes");
+  }
+  if (m_versions == nullptr) {
+    m_versions = std::make_shared<Versions>();
+  }
+  auto owner = track_version(new BPlusTree(m_comp, alloc), true);
+  auto *version = const_cast<BPlusTree *>(owner.get());
+  const auto *older = previous.m_version.get();
+  if (m_root != nullptr) {
+    // A root split or dropped since shifts the levels, compare all of them
+    version->m_root = version->replicate_subtree(
+        m_root, older == nullptr ? NodeHandler_(nullptr) : older->m_root,
+        older != nullptr && older->height() == height() ? key : nullptr);
+  }
+  version->m_size = m_size;
+  return Snapshot(std::move(owner));
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::on_write(write_callback callback) {
+  m_on_write = callback ? std::make_unique<write_callback>(std::move(callback))
+                        : nullptr;
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::notify_write(
+    const value_type *value) const {
+  if (m_on_write == nullptr) {
+    return;
+  }
+  if (value == nullptr) {
+    (*m_on_write)(nullptr);
+    return;
+  }
+  const key_type &key = Indexor{}(*value);
+  (*m_on_write)(&key);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::track_version(BPlusTree *version,
+                                                     bool replica)
+    -> std::shared_ptr<const BPlusTree> {
+  version->m_shared = true;
+  m_shared = true;
+  auto &count = replica ? m_versions->replicas : m_versions->snapshots;
+  count.fetch_add(1, std::memory_order_relaxed);
+  // The deleter releases the nodes and the count, also if the control block
+  // cant be allocated. Release pairs with the acquire of shared(), so the
+  // reads of the snapshot happen before the writes that stop copying.
+  return std::shared_ptr<const BPlusTree>(
+      version, [versions = m_versions, replica](const BPlusTree *tree) {
+        delete tree;
+        auto &count = replica ? versions->replicas : versions->snapshots;
+        count.fetch_sub(1, std::memory_order_release);
+      });
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::refs(NodeHandler_ node)
+    -> std::atomic<size_type> & {
+  return node.m_isLeaf ? node.leaf()->m_refs : node.internal()->m_refs;
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::unshare(NodeHandler_ &node) {
+  // Acquire pairs with the release of the snapshots that dropped the node,
+  // so their reads happen before the writes that follow
+  if (refs(node).load(std::memory_order_acquire) == 1) {
+    return;
+  }
+
+  if (node.m_isLeaf) {
+    const auto *source = node.leaf();
+    auto *leaf = create_leaf();
+    try {
+      for (; leaf->m_count < source->m_count; ++leaf->m_count) {
+        leaf->m_values[leaf->m_count] =
+            copy_value(*source->m_values[leaf->m_count]);
+      }
+    } catch (...) {
+      destroy_subtree(leaf);
+      throw;
+    }
+    leaf->m_fingerprints = source->m_fingerprints;
+    if constexpr (C_INDEXED) {
+      for (size_type i = 0; i < leaf->m_count; ++i) {
+        m_index.find(leaf->key(i))->second = leaf->m_values[i];
+      }
+    }
+    // Only this tree walks the leaf chain, the copy takes the place of
+    // source in it
+    leaf->m_prev = source->m_prev;
+    leaf->m_next = source->m_next;
+    if (leaf->m_prev != nullptr) {
+      leaf->m_prev->m_next = leaf;
+    } else {
+      m_head = leaf;
+    }
+    if (leaf->m_next != nullptr) {
+      leaf->m_next->m_prev = leaf;
+    } else {
+      m_tail = leaf;
+    }
+    release(node);
+    node = leaf;
+    return;
+  }
+
+  auto *inner = copy_internal(*node.internal());
+  release(node);
+  node = inner;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::copy_internal(
+    const InternalNode &source) -> InternalNode * {
+  auto *inner = create_internal();
+  try {
+    std::copy_n(source.m_keys.begin(), source.m_count, inner->m_keys.begin());
+  } catch (...) {
+    destroy_node(inner);
+    throw;
+  }
+  for (size_type i = 0; i <= source.m_count; ++i) {
+    inner->m_children[i] = source.m_children[i];
+    refs(inner->m_children[i]).fetch_add(1, std::memory_order_relaxed);
+  }
+  if constexpr (C_AUGMENTED) {
+    std::copy_n(source.m_aggregates.begin(), source.m_count + 1,
+                inner->m_aggregates.begin());
+  }
+  inner->m_count = source.m_count;
+  return inner;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::replicate_subtree(
+    NodeHandler_ node, NodeHandler_ previous, const key_type *key)
+    -> NodeHandler_ {
+  if (node.m_isLeaf) {
+    refs(node).fetch_add(1, std::memory_order_relaxed);
+    return node;
+  }
+  const auto &source = *node.internal();
+  const auto *older = previous.address() == nullptr || previous.m_isLeaf
+                          ? nullptr
+                          : previous.internal();
+  auto reusable = older != nullptr && older->m_count == source.m_count;
+  for (size_type i = 0; reusable && i < source.m_count; ++i) {
+    reusable = !m_comp(source.m_keys[i], older->m_keys[i]) &&
+               !m_comp(older->m_keys[i], source.m_keys[i]);
+  }
+
+  // Each replicated child holds one reference, released on failure and when
+  // the older node is shared instead. Structural writes copy the leaves a
+  // replica holds, so the same leaf means the same keys.
+  std::array<NodeHandler_, M> children;
+  const auto path = key == nullptr || older == nullptr
+                        ? size_type(0)
+                        : source.child_index(*key, m_comp);
+  size_type replicated = 0;
+  try {
+    for (; replicated <= source.m_count; ++replicated) {
+      const auto child = source.m_children[replicated];
+      auto candidate = older != nullptr && replicated <= older->m_count
+                           ? older->m_children[replicated]
+                           : NodeHandler_(nullptr);
+      const auto near = replicated + 1 >= path && replicated <= path + 1;
+      if (key != nullptr && older != nullptr) {
+        // A write changes the nodes along its path and the siblings they
+        // split off or rebalance with, the others only move over
+        auto match = matching_child(*older, source, replicated, !near);
+        if (match <= older->m_count) {
+          candidate = older->m_children[match];
+        }
+        if (!near && match <= older->m_count) {
+          refs(candidate).fetch_add(1, std::memory_order_relaxed);
+          children[replicated] = candidate;
+        } else {
+          children[replicated] = replicate_subtree(
+              child, candidate, near ? key : nullptr);
+        }
+      } else {
+        children[replicated] = replicate_subtree(child, candidate);
+      }
+      reusable = reusable &&
+                 children[replicated] == older->m_children[replicated];
+    }
+  } catch (...) {
+    std::for_each_n(children.begin(), replicated,
+                    [this](NodeHandler_ child) { release(child); });
+    throw;
+  }
+  const auto release_children = [this, &children, &source] {
+    std::for_each_n(children.begin(), source.m_count + 1,
+                    [this](NodeHandler_ child) { release(child); });
+  };
+  if (reusable) {
+    release_children();
+    refs(previous).fetch_add(1, std::memory_order_relaxed);
+    return previous;
+  }
+
+  InternalNode *inner = nullptr;
+  try {
+    inner = create_internal();
+    std::copy_n(source.m_keys.begin(), source.m_count, inner->m_keys.begin());
+  } catch (...) {
+    if (inner != nullptr) {
+      destroy_node(inner);
+    }
+    release_children();
+    throw;
+  }
+  std::copy_n(children.begin(), source.m_count + 1, inner->m_children.begin());
+  if constexpr (C_AUGMENTED) {
+    std::copy_n(source.m_aggregates.begin(), source.m_count + 1,
+                inner->m_aggregates.begin());
+  }
+  inner->m_count = source.m_count;
+  return inner;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::matching_child(
+    const InternalNode &older, const InternalNode &source, size_type index,
+    bool exact) const -> size_type {
+  const auto none = older.m_count + 1;
+  // Separators are distinct keys, the first and last child match by their
+  // single one
+  const auto position = [this, &older, none](const key_type &separator) {
+    const auto *keys = older.m_keys.data();
+    const auto *found = std::lower_bound(keys, keys + older.m_count,
+                                         separator, m_comp);
+    return found == keys + older.m_count || m_comp(separator, *found)
+               ? none
+               : static_cast<size_type>(found - keys);
+  };
+  auto lower = index == 0 ? 0 : position(source.m_keys[index - 1]);
+  if (index > 0 && lower != none) {
+    ++lower;
+  }
+  const auto upper =
+      index == source.m_count ? older.m_count : position(source.m_keys[index]);
+  if (lower == upper) {
+    return lower;
+  }
+  if (exact) {
+    return none;
+  }
+  return lower != none ? lower : upper;
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::unshare_path(const K &key,
+                                                    bool siblings)
+    -> LeafNode * {
+  // Only reachable through snapshot(), which needs copyable values
+  if constexpr (std::copy_constructible<value_type>) {
+    if (!shared() || m_root == nullptr) {
+      return nullptr;
+    }
+    // key may live in the leaf, which is only replaced on the last step
+    unshare(m_root);
+    auto node = m_root;
+    while (!node.m_isLeaf) {
+      auto *inner = node.internal();
+      const auto index = inner->child_index(key, m_comp);
+      if (siblings) {
+        unshare(inner->m_children[index > 0 ? index - 1 : index + 1]);
+      }
+      unshare(inner->m_children[index]);
+      node = inner->m_children[index];
+    }
+    return node.leaf();
+  }
+  return nullptr;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::owned(iterator it) -> iterator {
+  it.m_tree = this;
+  if (it.m_leaf != nullptr) {
+    it.m_leaf = owned_leaf(it.m_leaf->key(it.m_index), it.m_leaf);
+  }
+  return it;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::owned_leaf(const key_type &key,
+                                                  LeafNode *leaf)
+    -> LeafNode * {
+  return snapshotted() ? unshare_path(key, false) : leaf;
+}
+
+template <BPLUS_TEMPLATES>
+bool BPlusTree<BPLUS_TEMPLATE_PARAMS>::shared() noexcept {
+  // Only the trees add versions, so every count reads 0 at once
+  if (m_shared && m_versions != nullptr && !m_versions->alive(false)) {
+    m_shared = false;
+    m_versions->adopted.clear();
+  }
+  return m_shared;
+}
+
+template <BPLUS_TEMPLATES>
+bool BPlusTree<BPLUS_TEMPLATE_PARAMS>::snapshotted() noexcept {
+  if (!shared()) {
+    return false;
+  }
+  // A snapshot shares the nodes of the versions themselves
+  return m_versions == nullptr || m_versions->alive(true);
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::adopt_versions(BPlusTree &other) {
+  if (!other.shared() || other.m_versions == nullptr) {
+    return;
+  }
+  if (m_versions == nullptr) {
+    m_versions = std::make_shared<Versions>();
+  }
+  // Kept flat, the trees may adopt each other back and forth
+  auto &adopted = m_versions->adopted;
+  const auto adopt = [this, &adopted](const auto &versions) {
+    if (versions != m_versions &&
+        std::find(adopted.begin(), adopted.end(), versions) == adopted.end()) {
+      adopted.push_back(versions);
+    }
+  };
+  adopt(other.m_versions);
+  std::for_each(other.m_versions->adopted.begin(),
+                other.m_versions->adopted.end(), adopt);
+  m_shared = true;
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::claim(NodeHandler_ &node) {
+  if constexpr (std::copy_constructible<value_type>) {
+    if (shared()) {
+      unshare(node);
+    }
+  }
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::release(NodeHandler_ node) noexcept {
+  if (refs(node).fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  if (node.m_isLeaf) {
+    destroy_subtree(node);
+    return;
+  }
+  auto *inner = node.internal();
+  for (size_type i = 0; i <= inner->m_count; ++i) {
+    release(inner->m_children[i]);
+  }
+  destroy_node(node);
+}
+
+// *** Statistics *** //
+
+template <BPLUS_TEMPLATES>
+TreeStats BPlusTree<BPLUS_TEMPLATE_PARAMS>::stats() const {
+  TreeStats result;
+  if constexpr (C_STATS) {
+    static_cast<OperationCounters &>(result) = m_counters;
+  }
+  result.size = m_size;
+  result.value_bytes = m_size * sizeof(value_type);
+  if (m_root == nullptr) {
+    return result;
+  }
+
+  std::vector<NodeHandler_> level{m_root};
+  while (!level.empty()) {
+    result.nodes_per_level.push_back(level.size());
+    std::vector<NodeHandler_> next;
+    for (auto node : level) {
+      if (node.m_isLeaf) {
+        const auto bucket =
+            node.leaf()->m_count * TreeStats::fill_buckets / (M - 1);
+        ++result.leaf_fill[std::min(bucket, TreeStats::fill_buckets - 1)];
+        result.leaf_bytes += sizeof(LeafNode);
+        continue;
+      }
+      auto *inner = node.internal();
+      next.insert(next.end(), inner->m_children.begin(),
+                  inner->m_children.begin() + inner->m_count + 1);
+      result.internal_bytes += sizeof(InternalNode);
+    }
+    level = std::move(next);
+  }
+  result.height = result.nodes_per_level.size();
+  return result;
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::reset_stats() noexcept {
+  if constexpr (C_STATS) {
+    m_counters = {};
+  }
+}
+
+template <BPLUS_TEMPLATES>
+MemoryUsage BPlusTree<BPLUS_TEMPLATE_PARAMS>::memory_usage() const {
+  MemoryUsage result;
+  result.value_bytes = m_size * sizeof(value_type);
+  if (m_root == nullptr) {
+    return result;
+  }
+
+  std::vector<NodeHandler_> nodes{m_root};
+  while (!nodes.empty()) {
+    const auto node = nodes.back();
+    nodes.pop_back();
+    if (node.m_isLeaf) {
+      result.leaf_bytes += sizeof(LeafNode);
+      result.slack_bytes +=
+          (M - 1 - node.leaf()->m_count) * sizeof(value_type *);
+      continue;
+    }
+    const auto *inner = node.internal();
+    nodes.insert(nodes.end(), inner->m_children.begin(),
+                 inner->m_children.begin() + inner->m_count + 1);
+    result.internal_bytes += sizeof(InternalNode);
+    result.slack_bytes +=
+        (M - 1 - inner->m_count) * (sizeof(key_type) + sizeof(NodeHandler_));
+  }
+  return result;
+}
+
+template <BPLUS_TEMPLATES>
+bool BPlusTree<BPLUS_TEMPLATE_PARAMS>::within_budget(
+    size_type bytes) const noexcept {
+  if constexpr (C_BUDGETED) {
+    return !m_allocator.over_budget(bytes);
+  }
+  return true;
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::make_room(const K &key,
+                                                 size_type value_bytes) {
+  if constexpr (C_BUDGETED) {
+    // Most insertions fit even with a leaf split, and skip the lookup
+    if (within_budget(value_bytes + sizeof(LeafNode))) {
+      return;
+    }
+    auto bytes = value_bytes;
+    if (m_root == nullptr) {
+      bytes += sizeof(LeafNode);
+    } else {
+      const auto *leaf = find_leaf(key);
+      const auto position = leaf->lower_bound(key, m_comp);
+      if (position < leaf->m_count && !m_comp(key, leaf->key(position))) {
+        return;
+      }
+      bytes += leaf->full() ? sizeof(LeafNode) : 0;
+    }
+    if (bytes > 0) {
+      m_allocator.make_room(bytes);
+    }
+  }
+}
+
+// *** Compaction *** //
+
+template <BPLUS_TEMPLATES>
+CompactionStats BPlusTree<BPLUS_TEMPLATE_PARAMS>::compact() {
+  Compaction compaction;
+  while (!compact(compaction, std::numeric_limits<size_type>::max())) {
+  }
+  return compaction.stats();
+}
+
+template <BPLUS_TEMPLATES>
+bool BPlusTree<BPLUS_TEMPLATE_PARAMS>::compact(Compaction &compaction,
+                                               size_type max_leaves) {
+  auto &stats = compaction.m_stats;
+  const auto leaves_freed = stats.leaves_freed;
+  const auto internals_freed = stats.internals_freed;
+
+  size_type visited = 0;
+  while (!compaction.m_done && visited < max_leaves) {
+    if (m_root == nullptr || m_root.m_isLeaf) {
+      compaction.m_done = true;
+      break;
+    }
+    const key_type key =
+        compaction.m_next ? *compaction.m_next : key_type(m_head->key(0));
+    claim(m_root);
+    record([](auto &counters) { ++counters.descents; });
+    visited += compact_descend(m_root, key, max_leaves - visited,
+                               compaction.m_next, stats);
+    while (!m_root.m_isLeaf && m_root.internal()->m_count == 0) {
+      shrink_root();
+      ++stats.internals_freed;
+    }
+    compaction.m_done = !compaction.m_next;
+  }
+
+  stats.leaves_visited += visited;
+  stats.bytes_reclaimed +=
+      (stats.leaves_freed - leaves_freed) * sizeof(LeafNode) +
+      (stats.internals_freed - internals_freed) * sizeof(InternalNode);
+  if (visited > 0) {
+    notify_write(nullptr);
+  }
+  return compaction.m_done;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::compact_descend(
+    NodeHandler_ node, const key_type &key, size_type budget,
+    std::optional<key_type> &next, CompactionStats &stats) -> size_type {
+  auto *inner = node.internal();
+  const auto index = inner->child_index(key, m_comp);
+  if (inner->m_children[index].m_isLeaf) {
+    return compact_leaves(inner, index, budget, next, stats);
+  }
+
+  // Packing stops at the last leaf of each parent, which the first leaves
+  // of the next parent fill up
+  size_type visited = 0;
+  const auto count = inner->m_count;
+  if (index > 0 &&
+      inner->m_children[index].internal()->m_children[0].m_isLeaf) {
+    visited = compact_seam(inner, index, budget, stats);
+  }
+  claim(inner->m_children[index]);
+  visited += compact_descend(inner->m_children[index], key, budget - visited,
+                             next, stats);
+
+  // The packed child may now be underfull, or fit next to its left sibling
+  const auto child = inner->m_children[index];
+  if (underfull(child) ||
+      (index > 0 && fits(inner->m_children[index - 1], child))) {
+    pack_child(inner, index);
+  } else if constexpr (C_AUGMENTED) {
+    inner->m_aggregates[index] = aggregate_of(child);
+  }
+  stats.internals_freed += count - inner->m_count;
+  return visited;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::compact_leaves(
+    InternalNode *inner, size_type index, size_type budget,
+    std::optional<key_type> &next, CompactionStats &stats) -> size_type {
+  const auto count = inner->m_count;
+  size_type visited = 0;
+  auto position = index;
+  while (position < inner->m_count && visited < budget) {
+    ++visited;
+    claim(inner->m_children[position]);
+    auto *left = inner->m_children[position].leaf();
+    if (left->m_count == M - 1) {
+      ++position;
+      continue;
+    }
+
+    claim(inner->m_children[position + 1]);
+    auto *right = inner->m_children[position + 1].leaf();
+    if (left->m_count + right->m_count <= M - 1) {
+      merge_nodes(left, std::move(inner->m_keys[position]), right);
+      inner->erase_at(position);
+      if constexpr (C_AUGMENTED) {
+        inner->m_aggregates[position] = aggregate_of(left);
+      }
+    } else {
+      left->take_front(*right, M - 1 - left->m_count);
+      inner->m_keys[position] = key_type(right->key(0));
+      if constexpr (C_AUGMENTED) {
+        inner->m_aggregates[position] = aggregate_of(left);
+        inner->m_aggregates[position + 1] = aggregate_of(right);
+      }
+      ++position;
+    }
+  }
+
+  // Only the leaf packing stopped at may have been drained below the bound
+  position = std::min(position, inner->m_count);
+  if (inner->m_count > 0 && underfull(inner->m_children[position])) {
+    pack_child(inner, position);
+    position = std::min(position, inner->m_count);
+  }
+  stats.leaves_freed += count - inner->m_count;
+
+  // A partly filled last leaf is revisited, in case its parent absorbed the
+  // next one
+  const auto *last = inner->m_children[position].leaf();
+  if (position < inner->m_count || (visited > 0 && last->m_count < M - 1)) {
+    next.emplace(last->key(0));
+  } else if (last->m_next != nullptr) {
+    next.emplace(last->m_next->key(0));
+  } else {
+    next.reset();
+  }
+  return visited;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::compact_seam(InternalNode *inner,
+                                                    size_type index,
+                                                    size_type budget,
+                                                    CompactionStats &stats)
+    -> size_type {
+  claim(inner->m_children[index - 1]);
+  claim(inner->m_children[index]);
+  auto *before = inner->m_children[index - 1].internal();
+  auto *after = inner->m_children[index].internal();
+  claim(before->m_children[before->m_count]);
+  auto *left = before->m_children[before->m_count].leaf();
+
+  size_type visited = 0;
+  while (visited < budget && left->m_count < M - 1 && after->m_count > 0) {
+    ++visited;
+    claim(after->m_children[0]);
+    auto *right = after->m_children[0].leaf();
+    if (left->m_count + right->m_count <= M - 1) {
+      // The first child goes with the first key, as if it were the second
+      merge_nodes(left, std::move(after->m_keys[0]), right);
+      after->swap_front_children();
+      after->erase_at(0);
+      ++stats.leaves_freed;
+    } else {
+      // right keeps its minimum, packing it may stop before it is reached
+      const auto count =
+          std::min(M - 1 - left->m_count, right->m_count - C_MIN_LEAF_KEYS);
+      if (count > 0) {
+        left->take_front(*right, count);
+      }
+      break;
+    }
+  }
+
+  inner->m_keys[index - 1] = key_type(after->m_children[0].leaf()->key(0));
+  if constexpr (C_AUGMENTED) {
+    before->m_aggregates[before->m_count] = aggregate_of(left);
+    after->m_aggregates[0] = aggregate_of(after->m_children[0]);
+    inner->m_aggregates[index - 1] = aggregate_of(before);
+    inner->m_aggregates[index] = aggregate_of(after);
+  }
+  return visited;
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::pack_child(InternalNode *inner,
+                                                  size_type index) {
+  const auto left = index > 0 ? index - 1 : index;
+  const auto right = left + 1;
+  claim(inner->m_children[left]);
+  claim(inner->m_children[right]);
+
+  if (fits(inner->m_children[left], inner->m_children[right])) {
+    merge_nodes(inner->m_children[left], std::move(inner->m_keys[left]),
+                inner->m_children[right]);
+    inner->erase_at(left);
+  } else {
+    inner->m_keys[left] =
+        balance_nodes(inner->m_children[left], std::move(inner->m_keys[left]),
+                      inner->m_children[right]);
+    if constexpr (C_AUGMENTED) {
+      inner->m_aggregates[right] = aggregate_of(inner->m_children[right]);
+    }
+  }
+  if constexpr (C_AUGMENTED) {
+    inner->m_aggregates[left] = aggregate_of(inner->m_children[left]);
+  }
+}
+
+// *** Validation *** //
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::validate() const {
+  auto check = [](bool holds, const char *invariant) {
+    if (!holds) {
+      throw std::runtime_error(std::string("Invalid tree: ") + invariant);
+    }
+  };
+
+  if constexpr (C_INDEXED) {
+    check(m_index.size() == m_size, "index size does not match the size");
+    for (auto it = begin(); it != end(); ++it) {
+      const auto found = m_index.find(Indexor{}(*it));
+      check(found != m_index.end() && found->second == &*it,
+            "value missing from the index");
+    }
+  }
+
+  if (m_root == nullptr) {
+    check(m_head == nullptr && m_tail == nullptr,
+          "empty tree with leaves linked");
+    check(m_size == 0, "empty tree with non zero size");
+    return;
+  }
+
+  std::vector<const LeafNode *> leaves;
+  const auto values = validate_node(m_root, 0, nullptr, nullptr, leaves);
+  check(values == m_size, "size does not match the values stored");
+
+  check(m_head == leaves.front(), "head is not the leftmost leaf");
+  check(m_tail == leaves.back(), "tail is not the rightmost leaf");
+  check(m_head->m_prev == nullptr, "head has a previous leaf");
+  check(m_tail->m_next == nullptr, "tail has a next leaf");
+  for (size_type i = 1; i < leaves.size(); ++i) {
+    check(leaves[i - 1]->m_next == leaves[i], "broken next link");
+    check(leaves[i]->m_prev == leaves[i - 1], "broken prev link");
+  }
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::validate_node(
+    NodeHandler_ node, size_type depth, const key_type *low,
+    const key_type *high, std::vector<const LeafNode *> &leaves) const
+    -> size_type {
+  auto check = [](bool holds, const char *invariant) {
+    if (!holds) {
+      throw std::runtime_error(std::string("Invalid tree: ") + invariant);
+    }
+  };
+  const bool is_root = depth == 0;
+  check(node != nullptr, "missing child");
+
+  if (node.m_isLeaf) {
+    const auto *leaf = node.leaf();
+    check(leaf->m_count >= 1 && leaf->m_count <= M - 1,
+          "leaf count out of bounds");
+    check(is_root || leaf->m_count >= C_MIN_LEAF_KEYS, "underfull leaf");
+    check(depth == height(), "leaves at different depths");
+    for (size_type i = 0; i < leaf->m_count; ++i) {
+      check(leaf->m_values[i] != nullptr, "missing value");
+      check(i == 0 || m_comp(leaf->key(i - 1), leaf->key(i)),
+            "leaf keys out of order");
+    }
+    check(leaf->fingerprints_match(), "stale fingerprint");
+    check(low == nullptr || !m_comp(leaf->key(0), *low),
+          "leaf key below its separator");
+    check(high == nullptr || m_comp(leaf->key(leaf->m_count - 1), *high),
+          "leaf key not below its separator");
+    leaves.push_back(leaf);
+    return leaf->m_count;
+  }
+
+  const auto *inner = node.internal();
+  check(inner->m_count >= 1 && inner->m_count <= M - 1,
+        "internal count out of bounds");
+  check(is_root || inner->m_count >= C_MIN_INTERNAL_KEYS,
+        "underfull internal node");
+  for (size_type i = 0; i < inner->m_count; ++i) {
+    check(i == 0 || m_comp(inner->m_keys[i - 1], inner->m_keys[i]),
+          "separators out of order");
+    check(low == nullptr || !m_comp(inner->m_keys[i], *low),
+          "separator below the parent bound");
+    check(high == nullptr || m_comp(inner->m_keys[i], *high),
+          "separator not below the parent bound");
+  }
+
+  size_type values = 0;
+  for (size_type i = 0; i <= inner->m_count; ++i) {
+    const auto *child_low = i == 0 ? low : &inner->m_keys[i - 1];
+    const auto *child_high = i == inner->m_count ? high : &inner->m_keys[i];
+    const auto child = inner->m_children[i];
+    values += validate_node(child, depth + 1, child_low, child_high, leaves);
+
+    if constexpr (C_AUGMENTED && std::equality_comparable<aggregate_type>) {
+      check(inner->m_aggregates[i] == aggregate_of(child),
+            "stale cached aggregate");
+    } else if constexpr (SizedAugmentation<augmentation>) {
+      check(augmentation::size(inner->m_aggregates[i]) ==
+                augmentation::size(aggregate_of(child)),
+            "stale cached aggregate");
+    }
+  }
+  return values;
+}
+
+// *** Capacity *** //
+
+template <BPLUS_TEMPLATES>
+bool BPlusTree<BPLUS_TEMPLATE_PARAMS>::empty() const noexcept {
+  return m_size == 0;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::size() const noexcept -> size_type {
+  return m_size;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::max_size() const noexcept
+    -> size_type {
+  return value_traits::max_size(value_allocator_type(m_allocator));
+}
+
+// *** Modifiers *** //
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::clear() noexcept {
+  if (m_root != nullptr) {
+    if (shared()) {
+      release(m_root);
+    } else {
+      destroy_subtree(m_root);
+    }
+  }
+  m_root = nullptr;
+  m_head = nullptr;
+  m_tail = nullptr;
+  m_size = 0;
+  m_shared = false;
+  if (m_versions != nullptr) {
+    m_versions->adopted.clear();
+  }
+  if constexpr (C_INDEXED) {
+    m_index.clear();
+  }
+  notify_write(nullptr);
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::swap(BPlusTree &other) noexcept(
+    std::allocator_traits<Allocator>::propagate_on_container_swap::value ||
+    std::allocator_traits<Allocator>::is_always_equal::value) {
+  using std::swap;
+  swap(m_root, other.m_root);
+  swap(m_comp, other.m_comp);
+  if constexpr (allocator_traits::propagate_on_container_swap::value) {
+    swap(m_allocator, other.m_allocator);
+    swap(m_leaf_allocator, other.m_leaf_allocator);
+    swap(m_internal_allocator, other.m_internal_allocator);
+  }
+  swap(m_head, other.m_head);
+  swap(m_tail, other.m_tail);
+  swap(m_size, other.m_size);
+  swap(m_shared, other.m_shared);
+  swap(m_versions, other.m_versions);
+  if constexpr (C_INDEXED) {
+    m_index.swap(other.m_index);
+  }
+  notify_write(nullptr);
+  other.notify_write(nullptr);
+}
+
+// *** Iterators *** //
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::begin() -> iterator {
+  return owned(iterator(m_head, 0));
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::begin() const noexcept
+    -> const_iterator {
+  return const_iterator(m_head, 0, this);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::cbegin() const noexcept
+    -> const_iterator {
+  return begin();
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::end() noexcept -> iterator {
+  return end_of();
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::end() const noexcept -> const_iterator {
+  return const_iterator(nullptr, 0, this);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::cend() const noexcept -> const_iterator {
+  return end();
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::rbegin() noexcept
+    -> reverse_iterator {
+  return reverse_iterator(end());
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::rbegin() const noexcept
+    -> const_reverse_iterator {
+  return const_reverse_iterator(end());
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::crbegin() const noexcept
+    -> const_reverse_iterator {
+  return rbegin();
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::rend() -> reverse_iterator {
+  return reverse_iterator(begin());
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::rend() const noexcept
+    -> const_reverse_iterator {
+  return const_reverse_iterator(begin());
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::crend() const noexcept
+    -> const_reverse_iterator {
+  return rend();
+}
+
+// *** Lookup *** //
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::count(const Key &key) const
+    -> size_type {
+  return contains(key) ? 1 : 0;
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::count(const K &key) const
+    -> size_type {
+  return contains(key) ? 1 : 0;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::find(const Key &key) -> iterator {
+  return owned(find_of(key));
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::find(const Key &key) const
+    -> const_iterator {
+  return find_of(key);
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::find(const K &key) -> iterator {
+  return owned(find_of(key));
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::find(const K &key) const
+    -> const_iterator {
+  return find_of(key);
+}
+
+template <BPLUS_TEMPLATES>
+bool BPlusTree<BPLUS_TEMPLATE_PARAMS>::contains(const Key &key) const {
+  if constexpr (C_INDEXED) {
+    return m_index.contains(key);
+  } else {
+    return find_of(key) != end();
+  }
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::find_value(const key_type &key)
+    -> value_type * {
+  // The point index does not know the leaf to copy
+  if (snapshotted()) {
+    const auto it = find(key);
+    return it == end() ? nullptr : &*it;
+  }
+  return const_cast<value_type *>(std::as_const(*this).find_value(key));
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::find_value(const key_type &key) const
+    -> const value_type * {
+  if constexpr (C_INDEXED) {
+    const auto found = m_index.find(key);
+    return found == m_index.end() ? nullptr : found->second;
+  } else {
+    const auto it = find_of(key);
+    return it == end() ? nullptr : &*it;
+  }
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+bool BPlusTree<BPLUS_TEMPLATE_PARAMS>::contains(const K &key) const {
+  if constexpr (C_INDEXED_FOR<K>) {
+    return m_index.contains(key);
+  } else {
+    return find_of(key) != end();
+  }
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::equal_range(const Key &key)
+    -> std::pair<iterator, iterator> {
+  return {owned(lower_bound_of(key)), owned(upper_bound_of(key))};
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::equal_range(const Key &key) const
+    -> std::pair<const_iterator, const_iterator> {
+  return {lower_bound_of(key), upper_bound_of(key)};
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::equal_range(const K &key)
+    -> std::pair<iterator, iterator> {
+  return {owned(lower_bound_of(key)), owned(upper_bound_of(key))};
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::equal_range(const K &key) const
+    -> std::pair<const_iterator, const_iterator> {
+  return {lower_bound_of(key), upper_bound_of(key)};
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::lower_bound(const Key &key)
+    -> iterator {
+  return owned(lower_bound_of(key));
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::lower_bound(const Key &key) const
+    -> const_iterator {
+  return lower_bound_of(key);
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::lower_bound(const K &key) -> iterator {
+  return owned(lower_bound_of(key));
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::lower_bound(const K &key) const
+    -> const_iterator {
+  return lower_bound_of(key);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::upper_bound(const Key &key)
+    -> iterator {
+  return owned(upper_bound_of(key));
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::upper_bound(const Key &key) const
+    -> const_iterator {
+  return upper_bound_of(key);
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::upper_bound(const K &key) -> iterator {
+  return owned(upper_bound_of(key));
+}
+
+template <BPLUS_TEMPLATES>
+template <TransparentKey<Key, Compare> K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::upper_bound(const K &key) const
+    -> const_iterator {
+  return upper_bound_of(key);
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::lower_bound_of(const K &key) const
+    -> iterator {
+  if (m_root == nullptr) {
+    return end_of();
+  }
+  auto *leaf = find_leaf(key);
+  auto position = leaf->lower_bound(key, m_comp);
+  record_lookup(position, leaf->m_count);
+  return make_iterator(leaf, position);
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::upper_bound_of(const K &key) const
+    -> iterator {
+  if (m_root == nullptr) {
+    return end_of();
+  }
+  auto *leaf = find_leaf(key);
+  auto position = leaf->upper_bound(key, m_comp);
+  record_lookup(position, leaf->m_count);
+  return make_iterator(leaf, position);
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::find_of(const K &key) const
+    -> iterator {
+  if (m_root == nullptr) {
+    return end_of();
+  }
+  if constexpr (C_INDEXED_FOR<K>) {
+    if (!m_index.contains(key)) {
+      return end_of();
+    }
+  }
+  // Keys past the leaf are greater than the separator after it, so a miss
+  // never has to look at the next leaf
+  auto *leaf = find_leaf(key);
+  size_type comparisons = 0;
+  auto position = leaf->find(key, m_comp, comparisons);
+  record_find(comparisons);
+  if (position == leaf->m_count) {
+    return end_of();
+  }
+  return make_iterator(leaf, position);
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::find_batch(
+    std::span<const key_type> keys, std::span<iterator> results) {
+  if (results.size() < keys.size()) {
+    throw std::runtime_error("find_batch results are smaller than keys");
+  }
+  if (m_root == nullptr) {
+    std::fill_n(results.begin(), keys.size(), end());
+    return;
+  }
+  descend_batch(keys, [&](size_type index, LeafNode *leaf) {
+    size_type comparisons = 0;
+    auto position = leaf->find(keys[index], m_comp, comparisons);
+    record_find(comparisons);
+    results[index] =
+        position < leaf->m_count ? iterator(leaf, position, this) : end();
+  });
+  // A copied leaf moves every result found in it, so each one follows its
+  // key instead of going through owned()
+  if (snapshotted()) {
+    for (size_type i = 0; i < keys.size(); ++i) {
+      if (results[i] != end()) {
+        results[i].m_leaf = owned_leaf(keys[i], results[i].m_leaf);
+      }
+    }
+  }
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::find_batch(
+    std::span<const key_type> keys, std::span<const_iterator> results) const {
+  if (results.size() < keys.size()) {
+    throw std::runtime_error("find_batch results are smaller than keys");
+  }
+  if (m_root == nullptr) {
+    std::fill_n(results.begin(), keys.size(), end());
+    return;
+  }
+  descend_batch(keys, [&](size_type index, LeafNode *leaf) {
+    size_type comparisons = 0;
+    auto position = leaf->find(keys[index], m_comp, comparisons);
+    record_find(comparisons);
+    results[index] =
+        position < leaf->m_count ? const_iterator(leaf, position, this)
+                                 : end();
+  });
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::contains_batch(
+    std::span<const key_type> keys, std::span<bool> results) const {
+  if (results.size() < keys.size()) {
+    throw std::runtime_error("contains_batch results are smaller than keys");
+  }
+  if (m_root == nullptr) {
+    std::fill_n(results.begin(), keys.size(), false);
+    return;
+  }
+  descend_batch(keys, [&](size_type index, LeafNode *leaf) {
+    size_type comparisons = 0;
+    results[index] =
+        leaf->find(keys[index], m_comp, comparisons) < leaf->m_count;
+    record_find(comparisons);
+  });
+}
+
+// *** Augmented queries *** //
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::range_aggregate(
+    const key_type &low, const key_type &high) const -> aggregate_type
+  requires is_augmented_v<augmentation>
+{
+  if (m_root == nullptr || !m_comp(low, high)) {
+    return augmentation::identity();
+  }
+  return fold_range(m_root, &low, &high);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::count(const key_type &low,
+                                             const key_type &high) const
+    -> size_type
+  requires SizedAugmentation<augmentation>
+{
+  if (!m_comp(low, high)) {
+    return 0;
+  }
+  return rank(high) - rank(low);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::rank(const key_type &key) const
+    -> size_type
+  requires SizedAugmentation<augmentation>
+{
+  if (m_root == nullptr) {
+    return 0;
+  }
+
+  size_type rank = 0;
+  auto node = m_root;
+  while (!node.m_isLeaf) {
+    auto *inner = node.internal();
+    auto index = inner->child_index(key, m_comp);
+    for (size_type i = 0; i < index; ++i) {
+      rank += augmentation::size(inner->m_aggregates[i]);
+    }
+    node = inner->m_children[index];
+  }
+  return rank + node.leaf()->lower_bound(key, m_comp);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::select(size_type index) -> iterator
+  requires SizedAugmentation<augmentation>
+{
+  if (index >= m_size) {
+    return end();
+  }
+  auto *leaf = select_leaf(index);
+  return owned(iterator(leaf, index));
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::select(size_type index) const
+    -> const_iterator
+  requires SizedAugmentation<augmentation>
+{
+  if (index >= m_size) {
+    return end();
+  }
+  auto *leaf = select_leaf(index);
+  return const_iterator(leaf, index, this);
+}
+
+// *** Private helpers *** //
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::create_leaf() -> LeafNode * {
+  auto *leaf = leaf_traits::allocate(m_leaf_allocator, 1);
+  leaf_traits::construct(m_leaf_allocator, leaf);
+  return leaf;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::create_internal() -> InternalNode * {
+  auto *inner = internal_traits::allocate(m_internal_allocator, 1);
+  try {
+    internal_traits::construct(m_internal_allocator, inner);
+  } catch (...) {
+    internal_traits::deallocate(m_internal_allocator, inner, 1);
+    throw;
+  }
+  return inner;
+}
+
+template <BPLUS_TEMPLATES>
+template <typename... Args>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::create_value(Args &&...args)
+    -> value_type * {
+  value_allocator_type allocator(m_allocator);
+  auto *value = value_traits::allocate(allocator, 1);
+  try {
+    value_traits::construct(allocator, value, std::forward<Args>(args)...);
+  } catch (...) {
+    value_traits::deallocate(allocator, value, 1);
+    throw;
+  }
+  return value;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::copy_value(const value_type &source)
+    -> value_type * {
+  if constexpr (C_TRIVIAL_COPY) {
+    // The bytes of the source start the lifetime of the copy, nothing can
+    // throw once the value is allocated
+    value_allocator_type allocator(m_allocator);
+    auto *value = value_traits::allocate(allocator, 1);
+    std::memcpy(static_cast<void *>(value), &source, sizeof(value_type));
+    return value;
+  } else {
+    return create_value(source);
+  }
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::destroy_value(value_type *value) {
+  value_allocator_type allocator(m_allocator);
+  if constexpr (!C_TRIVIAL_DESTROY) {
+    value_traits::destroy(allocator, value);
+  }
+  value_traits::deallocate(allocator, value, 1);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::destroy_subtree(
+    NodeHandler_ node) noexcept -> size_type {
+  size_type destroyed = 0;
+  if (node.m_isLeaf) {
+    auto *leaf = node.leaf();
+    for (size_type i = 0; i < leaf->m_count; ++i) {
+      destroy_value(leaf->m_values[i]);
+    }
+    destroyed = leaf->m_count;
+  } else {
+    auto *inner = node.internal();
+    for (size_type i = 0; i <= inner->m_count; ++i) {
+      destroyed += destroy_subtree(inner->m_children[i]);
+    }
+  }
+  destroy_node(node);
+  return destroyed;
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::destroy_node(
+    NodeHandler_ node) noexcept {
+  if (node.m_isLeaf) {
+    auto *leaf = node.leaf();
+    leaf_traits::destroy(m_leaf_allocator, leaf);
+    leaf_traits::deallocate(m_leaf_allocator, leaf, 1);
+    return;
+  }
+  auto *inner = node.internal();
+  internal_traits::destroy(m_internal_allocator, inner);
+  internal_traits::deallocate(m_internal_allocator, inner, 1);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::height() const -> size_type {
+  if (m_root == nullptr) {
+    return 0;
+  }
+  size_type height = 0;
+  for (auto node = m_root; !node.m_isLeaf; node = node.childs()[0]) {
+    ++height;
+  }
+  return height;
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K, typename Make>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::make_indexed(const K &key, Make &make)
+    -> value_type * {
+  if constexpr (C_INDEXED) {
+    const auto entry = m_index.emplace(key_type(key), nullptr).first;
+    try {
+      entry->second = make();
+    } catch (...) {
+      m_index.erase(entry);
+      throw;
+    }
+    return entry->second;
+  } else {
+    return make();
+  }
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::rebuild_index() {
+  if constexpr (C_INDEXED) {
+    m_index.clear();
+    m_index.reserve(m_size);
+    for (auto it = iterator(m_head, 0); it != end_of(); ++it) {
+      m_index.emplace(Indexor{}(*it), &*it);
+    }
+  }
+}
+
+template <BPLUS_TEMPLATES>
+template <typename Visit>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::visit_values(NodeHandler_ node,
+                                                    Visit &&visit) {
+  if (node == nullptr) {
+    return;
+  }
+  if (node.m_isLeaf) {
+    const auto *leaf = node.leaf();
+    std::for_each(leaf->m_values.begin(),
+                  leaf->m_values.begin() + leaf->m_count, visit);
+    return;
+  }
+  const auto *inner = node.internal();
+  for (size_type i = 0; i <= inner->m_count; ++i) {
+    visit_values(inner->m_children[i], visit);
+  }
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::count_split(NodeHandler_ low,
+                                                   NodeHandler_ high) const
+    -> size_type {
+  if (high == nullptr || low == nullptr) {
+    return high == nullptr ? 0 : m_size;
+  }
+  if constexpr (SizedAugmentation<augmentation>) {
+    return augmentation::size(aggregate_of(high));
+  } else {
+    // Both parts are walked in lockstep until the smaller one ends
+    const auto *low_leaf = leftmost_leaf(low);
+    const auto *high_leaf = leftmost_leaf(high);
+    const auto *low_last = rightmost_leaf(low);
+    const auto *high_last = rightmost_leaf(high);
+    size_type low_count = 0;
+    size_type high_count = 0;
+    for (;; low_leaf = low_leaf->m_next, high_leaf = high_leaf->m_next) {
+      low_count += low_leaf->m_count;
+      if (low_leaf == low_last) {
+        return m_size - low_count;
+      }
+      high_count += high_leaf->m_count;
+      if (high_leaf == high_last) {
+        return high_count;
+      }
+    }
+  }
+}
+
+template <BPLUS_TEMPLATES>
+bool BPlusTree<BPLUS_TEMPLATE_PARAMS>::shares_allocator(
+    const BPlusTree &other) const {
+  return allocator_traits::is_always_equal::value ||
+         m_allocator == other.m_allocator;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::leftmost_leaf(NodeHandler_ node)
+    -> LeafNode * {
+  while (!node.m_isLeaf) {
+    node = node.childs()[0];
+  }
+  return node.leaf();
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::rightmost_leaf(NodeHandler_ node)
+    -> LeafNode * {
+  while (!node.m_isLeaf) {
+    node = node.childs()[node.keyCount()];
+  }
+  return node.leaf();
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::make_root(NodeHandler_ left,
+                                                 Key separator,
+                                                 NodeHandler_ right)
+    -> InternalNode * {
+  auto *root = create_internal();
+  root->m_keys[0] = std::move(separator);
+  root->m_children[0] = left;
+  root->m_children[1] = right;
+  root->m_count = 1;
+  if constexpr (C_AUGMENTED) {
+    root->m_aggregates[0] = aggregate_of(left);
+    root->m_aggregates[1] = aggregate_of(right);
+  }
+  return root;
+}
+
+template <BPLUS_TEMPLATES>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::attach_child(InternalNode *inner,
+                                                    size_type position,
+                                                    Key key, NodeHandler_ child,
+                                                    Split &split) {
+  aggregate_type aggregate{};
+  if constexpr (C_AUGMENTED) {
+    aggregate = aggregate_of(child);
+  }
+
+  if (!inner->full()) {
+    inner->insert_at(position, std::move(key), child, aggregate);
+    return;
+  }
+
+  auto *right = create_internal();
+  auto separator =
+      inner->split_insert(position, std::move(key), child, aggregate, *right);
+  split.emplace(std::move(separator), right);
+  record([](auto &counters) { ++counters.internal_splits; });
+}
+
+template <BPLUS_TEMPLATES>
+template <typename K>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::find_leaf(const K &key) const
+    -> LeafNode * {
+  record([](auto &counters) { ++counters.descents; });
+  auto node = m_root;
+  while (!node.m_isLeaf) {
+    auto *inner = node.internal();
+    auto index = inner->child_index(key, m_comp);
+    record([&](auto &counters) {
+      counters.lookup_comparisons += scan_comparisons(index, inner->m_count);
+    });
+    node = inner->m_children[index];
+  }
+  return node.leaf();
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::end_of() const noexcept -> iterator {
+  return make_iterator(nullptr, 0);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::make_iterator(
+    LeafNode *leaf, size_type index) const noexcept -> iterator {
+  // Only the non const overloads hand out iterators that write, through
+  // owned()
+  auto *tree = const_cast<BPlusTree *>(this);
+  if (leaf != nullptr && index == leaf->m_count) {
+    return iterator(leaf->m_next, 0, tree);
+  }
+  return iterator(leaf, index, tree);
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::aggregate_of(NodeHandler_ node) const
+    -> aggregate_type {
+  auto aggregate = augmentation::identity();
+  if (node.m_isLeaf) {
+    auto *leaf = node.leaf();
+    for (size_type i = 0; i < leaf->m_count; ++i) {
+      aggregate = augmentation::combine(
+          aggregate, augmentation::lift(*leaf->m_values[i]));
+    }
+    return aggregate;
+  }
+
+  auto *inner = node.internal();
+  for (size_type i = 0; i <= inner->m_count; ++i) {
+    aggregate = augmentation::combine(aggregate, inner->m_aggregates[i]);
+  }
+  return aggregate;
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::fold_range(NodeHandler_ node,
+                                                  const key_type *low,
+                                                  const key_type *high) const
+    -> aggregate_type {
+  auto aggregate = augmentation::identity();
+
+  if (node.m_isLeaf) {
+    auto *leaf = node.leaf();
+    auto first = low == nullptr ? 0 : leaf->lower_bound(*low, m_comp);
+    auto last =
+        high == nullptr ? leaf->m_count : leaf->lower_bound(*high, m_comp);
+    for (auto i = first; i < last; ++i) {
+      aggregate = augmentation::combine(
+          aggregate, augmentation::lift(*leaf->m_values[i]));
+    }
+    return aggregate;
+  }
+
+  auto *inner = node.internal();
+  auto first = low == nullptr ? 0 : inner->child_index(*low, m_comp);
+  auto last =
+      high == nullptr ? inner->m_count : inner->child_index(*high, m_comp);
+
+  for (auto i = first; i <= last; ++i) {
+    // Children strictly between the two boundary children are fully covered
+    const bool covered =
+        (low == nullptr || i > first) && (high == nullptr || i < last);
+    aggregate = augmentation::combine(
+        aggregate,
+        covered ? inner->m_aggregates[i]
+                : fold_range(inner->m_children[i], i > first ? nullptr : low,
+                             i < last ? nullptr : high));
+  }
+  return aggregate;
+}
+
+template <BPLUS_TEMPLATES>
+template <typename Visit>
+void BPlusTree<BPLUS_TEMPLATE_PARAMS>::descend_batch(
+    std::span<const key_type> keys, Visit &&visit) const {
+  constexpr size_type width = Traits::batch_width;
+  std::array<NodeHandler_, width> nodes;
+
+  for (size_type first = 0; first < keys.size(); first += width) {
+    const auto group = std::min(width, keys.size() - first);
+    std::fill_n(nodes.begin(), group, m_root);
+    record([group](auto &counters) { counters.descents += group; });
+
+    // Every leaf is at the same depth, so the group moves down level by level
+    // and each step only touches nodes prefetched in the previous one.
+    while (!nodes[0].m_isLeaf) {
+      for (size_type i = 0; i < group; ++i) {
+        auto *inner = nodes[i].internal();
+        auto index = inner->child_index(keys[first + i], m_comp);
+        record([&](auto &counters) {
+          counters.lookup_comparisons +=
+              scan_comparisons(index, inner->m_count);
+        });
+        nodes[i] = inner->m_children[index];
+        utils::prefetch(nodes[i].address());
+      }
+    }
+
+    for (size_type i = 0; i < group; ++i) {
+      visit(first + i, nodes[i].leaf());
+    }
+  }
+}
+
+template <BPLUS_TEMPLATES>
+auto BPlusTree<BPLUS_TEMPLATE_PARAMS>::select_leaf(size_type &index) const
+    -> LeafNode * {
+  auto node = m_root;
+  while (!node.m_isLeaf) {
+    auto *inner = node.internal();
+    size_type child = 0;
+    for (; child < inner->m_count; ++child) {
+      auto child_size = augmentation::size(inner->m_aggregates[child]);
+      if (index < child_size) {
+        break;
+      }
+      index -= child_size;
+    }
+    node = inner->m_children[child];
   }
-  m_root.insert(ilist);
+  return node.leaf();
 }
 
 #endif // !BPlusTree_HPP
@@ -1,7 +1,12 @@
 #ifndef CONCEPTS_B_PLUS_TREE_HPP
 #define CONCEPTS_B_PLUS_TREE_HPP
 
+#include "Augmentation.hpp"
 #include "BPlusTemplate.hpp"
+#include "Fingerprint.hpp"
+#include "PointIndex.hpp"
+#include "Search.hpp"
+#include <concepts>
 #include <iterator>
 #include <utility>
 
@@ -19,6 +24,14 @@
 template <typename Key>
 concept properKeyValue = std::copy_constructible<Key>;
 
+/**
+ * @brief Concept for a proper mapped value
+ * @details Mapped values are constructed in place and never relocated, so
+ * move only types qualify. Copying the tree requires copyable ones.
+ * */
+template <typename T>
+concept properMappedValue = std::move_constructible<T> && std::destructible<T>;
+
 template <typename T>
 concept IsAllocator =
     requires(T alloc, std::size_t n) {
@@ -27,13 +40,44 @@ concept IsAllocator =
       { alloc.deallocate(std::declval<typename T::value_type *>(), n) };
     };
 
-template <typename C, typename Key>
-concept ComparableKey = std::equality_comparable_with<Key, C>;
+/**
+ * @brief Concept for an allocator enforcing a memory budget
+ * @details Trees whose allocator, e.g. BudgetAllocator, models it ask it to
+ * make room for the insertion of an absent key before they start it
+ * */
+template <typename A>
+concept BudgetedAllocator = requires(const A &alloc, std::size_t bytes) {
+  { alloc.over_budget(bytes) } -> std::convertible_to<bool>;
+  { alloc.make_room(bytes) } -> std::convertible_to<bool>;
+};
+
+/**
+ * @brief Concept for a key looked up without being converted to Key
+ * @details Only comparators declaring is_transparent, like std::less<>, opt
+ * in, and they must order K against Key both ways
+ * */
+template <typename K, typename Key, typename Compare>
+concept TransparentKey =
+    requires { typename Compare::is_transparent; } &&
+    std::predicate<const Compare &, const K &, const Key &> &&
+    std::predicate<const Compare &, const Key &, const K &>;
 
 template <typename F, typename Key, typename T>
 concept Indexor = std::regular_invocable<F, T> &&
                   std::convertible_to<std::invoke_result_t<F, T>, Key>;
 
+/**
+ * @brief Concept for the compile time configuration of the tree
+ * @details See @ref DefaultTraits "DefaultTraits" for the members
+ * */
+template <typename Tr, typename value_type>
+concept TreeTraits = Augmentation<typename Tr::augmentation, value_type> &&
+                     NodeSearch<typename Tr::node_search> &&
+                     LeafFingerprint<typename Tr::leaf_fingerprint,
+                                     typename value_type::first_type> &&
+                     PointIndex<typename Tr::point_index> &&
+                     (Tr::batch_width > 0);
+
 template <typename P, typename value_type>
 concept rvalue_constructible_from =
     std::destructible<value_type> && std::is_constructible_v<value_type, P &&>;
@@ -47,9 +91,6 @@ concept ValueInputIterator =
     std::constructible_from<value_type,
                             typename std::iterator_traits<InputIt>::value_type>;
 
-template <typename T, typename... Args>
-concept InverseConstructibleFrom = (std::constructible_from<Args, T> && ...);
-
 struct InsertResult {
   bool inserted;
   bool alreadyExists;
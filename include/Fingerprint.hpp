@@ -0,0 +1,59 @@
+#ifndef FINGERPRINT_HPP
+#define FINGERPRINT_HPP
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+
+/// @defgroup Fingerprint Leaf fingerprint policies
+/// @name Fingerprint
+/// @brief Filters that let leaves reject absent keys
+/// @details
+/// With a fingerprint policy, every leaf stores one byte per value derived
+/// from the hash of its key, next to the value pointers. find, contains and
+/// count compare the byte of the key looked up against that array, and only
+/// read the values whose byte matches. A miss usually reads no value at all,
+/// instead of the ones a search of the leaf dereferences. The policy is chosen
+/// through Traits::leaf_fingerprint.
+/// @{
+
+/**
+ * @brief Default policy: leaves store no fingerprints
+ * */
+struct NoFingerprint {
+  static constexpr bool enabled = false;
+
+  template <typename K>
+  static constexpr std::uint8_t of(const K & /*key*/) noexcept {
+    return 0;
+  }
+};
+
+/**
+ * @brief Fingerprints made of the top byte of the mixed key hash
+ * @details Hash must hash the keys like std::hash. Lookups by a key of
+ * another type than the stored ones, through transparent comparators, skip
+ * the fingerprints. About one in 256 values of a leaf is read on a miss.
+ * */
+template <typename Hash> struct HashFingerprint {
+  static constexpr bool enabled = true;
+
+  template <typename K> static std::uint8_t of(const K &key) {
+    // Identity hashes, like std::hash of integers, only vary the low bits
+    const auto hash = static_cast<std::uint64_t>(Hash{}(key));
+    return static_cast<std::uint8_t>((hash * 0x9E3779B97F4A7C15ULL) >> 56);
+  }
+};
+
+/**
+ * @brief Concept for a leaf fingerprint policy
+ * */
+template <typename F, typename Key>
+concept LeafFingerprint = requires(const Key &key) {
+  { F::enabled } -> std::convertible_to<bool>;
+  { F::of(key) } -> std::same_as<std::uint8_t>;
+};
+
+/// @}
+
+#endif // !FINGERPRINT_HPP
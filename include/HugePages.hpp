@@ -0,0 +1,223 @@
+#ifndef HUGE_PAGES_HPP
+#define HUGE_PAGES_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+/// @defgroup HugePages Huge page slabs
+/// @name HugePages
+/// @brief Node and value storage carved out of 2 MiB slabs
+/// @details
+/// Trees allocate every node and value one by one, which scatters them over
+/// as many 4 KiB pages and makes deep lookups in large trees pay a page walk
+/// per level. HugePageAllocator carves them out of 2 MiB slabs instead, so
+/// one TLB entry covers thousands of nodes.
+///
+/// On Linux a slab is first mapped with MAP_HUGETLB, which needs huge pages
+/// reserved through vm.nr_hugepages. When none are left, it is mapped 2 MiB
+/// aligned and marked with madvise(MADV_HUGEPAGE) for transparent huge
+/// pages. Elsewhere slabs come from the aligned operator new.
+/// @{
+
+/**
+ * @brief Pool of 2 MiB slabs shared by the allocators bound to it
+ * @details Blocks are bump allocated in the current slab and freed blocks go
+ * to a free list of their size, so slabs are only returned to the system when
+ * the arena is destroyed. Blocks larger than max_block or aligned beyond
+ * max_align_t bypass the slabs. The arena is thread safe, snapshots may free
+ * nodes from any thread. It must outlive the trees allocating from it.
+ * */
+class HugePageArena {
+public:
+  static constexpr std::size_t slab_size = std::size_t{2} << 20U;
+  static constexpr std::size_t max_block = std::size_t{64} << 10U;
+  static constexpr std::size_t granule = alignof(std::max_align_t);
+
+  /// @brief Memory held by an arena
+  struct Usage {
+    std::size_t slabs = 0;        ///< Slabs mapped
+    std::size_t huge_slabs = 0;   ///< Slabs backed by reserved huge pages
+    std::size_t bytes_in_use = 0; ///< Bytes of the blocks not yet freed
+  };
+
+  HugePageArena() = default;
+  HugePageArena(const HugePageArena &) = delete;
+  HugePageArena &operator=(const HugePageArena &) = delete;
+
+  ~HugePageArena() {
+    for (const auto &slab : m_slabs) {
+      unmap(slab);
+    }
+  }
+
+  /// @brief Arena of the default constructed allocators, never destroyed
+  static HugePageArena &global() {
+    static auto *arena = new HugePageArena();
+    return *arena;
+  }
+
+  [[nodiscard]] void *allocate(std::size_t bytes, std::size_t alignment) {
+    if (!slabbed(bytes, alignment)) {
+      return ::operator new(bytes, std::align_val_t(alignment));
+    }
+    const auto size = round(bytes);
+    const std::lock_guard lock(m_mutex);
+    auto *&head = m_free[size / granule];
+    void *block = head;
+    if (block != nullptr) {
+      head = *static_cast<void **>(block);
+    } else {
+      if (static_cast<std::size_t>(m_end - m_cursor) < size) {
+        grow();
+      }
+      block = m_cursor;
+      m_cursor += size;
+    }
+    m_usage.bytes_in_use += size;
+    return block;
+  }
+
+  void deallocate(void *pointer, std::size_t bytes,
+                  std::size_t alignment) noexcept {
+    if (!slabbed(bytes, alignment)) {
+      ::operator delete(pointer, std::align_val_t(alignment));
+      return;
+    }
+    const auto size = round(bytes);
+    const std::lock_guard lock(m_mutex);
+    auto *&head = m_free[size / granule];
+    *static_cast<void **>(pointer) = head;
+    head = pointer;
+    m_usage.bytes_in_use -= size;
+  }
+
+  [[nodiscard]] Usage usage() const {
+    const std::lock_guard lock(m_mutex);
+    return m_usage;
+  }
+
+private:
+  struct Slab {
+    void *memory;
+    bool huge;
+  };
+
+  static constexpr bool slabbed(std::size_t bytes,
+                                std::size_t alignment) noexcept {
+    return bytes <= max_block && alignment <= granule;
+  }
+
+  static constexpr std::size_t round(std::size_t bytes) noexcept {
+    return bytes == 0 ? granule : (bytes + granule - 1) / granule * granule;
+  }
+
+  /// @brief Starts a new slab, the rest of the current one is dropped
+  void grow() {
+    m_slabs.reserve(m_slabs.size() + 1);
+    const auto slab = map();
+    m_slabs.push_back(slab);
+    m_cursor = static_cast<char *>(slab.memory);
+    m_end = m_cursor + slab_size;
+    ++m_usage.slabs;
+    m_usage.huge_slabs += slab.huge ? 1 : 0;
+  }
+
+  static Slab map() {
+#if defined(__linux__)
+    constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_HUGETLB)
+    auto *huge = mmap(nullptr, slab_size, PROT_READ | PROT_WRITE,
+                      flags | MAP_HUGETLB, -1, 0);
+    if (huge != MAP_FAILED) {
+      return {huge, true};
+    }
+#endif
+    // Transparent huge pages only back 2 MiB aligned ranges
+    auto *raw = static_cast<char *>(mmap(nullptr, 2 * slab_size,
+                                         PROT_READ | PROT_WRITE, flags, -1, 0));
+    if (raw == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    const auto address = reinterpret_cast<std::uintptr_t>(raw);
+    auto *aligned = raw + (slab_size - address % slab_size) % slab_size;
+    if (aligned != raw) {
+      munmap(raw, static_cast<std::size_t>(aligned - raw));
+    }
+    munmap(aligned + slab_size,
+           static_cast<std::size_t>(raw + 2 * slab_size - aligned - slab_size));
+#if defined(MADV_HUGEPAGE)
+    madvise(aligned, slab_size, MADV_HUGEPAGE);
+#endif
+    return {aligned, false};
+#else
+    return {::operator new(slab_size, std::align_val_t(slab_size)), false};
+#endif
+  }
+
+  static void unmap(const Slab &slab) noexcept {
+#if defined(__linux__)
+    munmap(slab.memory, slab_size);
+#else
+    ::operator delete(slab.memory, std::align_val_t(slab_size));
+#endif
+  }
+
+  mutable std::mutex m_mutex;
+  char *m_cursor = nullptr;
+  char *m_end = nullptr;
+  std::array<void *, max_block / granule + 1> m_free{};
+  std::vector<Slab> m_slabs;
+  Usage m_usage;
+};
+
+/**
+ * @brief Allocator carving its memory out of the slabs of a HugePageArena
+ * @details Default constructed allocators share HugePageArena::global().
+ * Allocators compare equal when they share their arena, so trees of one
+ * arena split, join and exchange node handles in O(1).
+ * */
+template <typename T> class HugePageAllocator {
+public:
+  using value_type = T;
+
+  HugePageAllocator() noexcept : m_arena(&HugePageArena::global()) {}
+  explicit HugePageAllocator(HugePageArena &arena) noexcept
+      : m_arena(&arena) {}
+  template <typename U>
+  HugePageAllocator(const HugePageAllocator<U> &other) noexcept
+      : m_arena(&other.arena()) {}
+
+  T *allocate(std::size_t count) {
+    if (count > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T *>(m_arena->allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *pointer, std::size_t count) noexcept {
+    m_arena->deallocate(pointer, count * sizeof(T), alignof(T));
+  }
+
+  [[nodiscard]] HugePageArena &arena() const noexcept { return *m_arena; }
+
+  template <typename U>
+  bool operator==(const HugePageAllocator<U> &other) const noexcept {
+    return m_arena == &other.arena();
+  }
+
+private:
+  HugePageArena *m_arena;
+};
+
+/// @}
+
+#endif // !HUGE_PAGES_HPP
@@ -2,6 +2,10 @@
 #define INTERNAL_NODE_HPP
 
 #include "Concepts.hpp"
+#include "Relocate.hpp"
+#include <array>
+#include <atomic>
+#include <type_traits>
 
 template <BPLUS_TEMPLATES, size_t MAX_CHILDS, size_t MAX_KEYS>
 class NodeHandler;
@@ -9,19 +13,287 @@ class NodeHandler;
 /**
  * @class InternalNode
  * @brief Internal node for B+ tree.
- * @details The InternalNode class inherits from @ref Node "Node" and adds an
- * array of pointers to child nodes.
+ * @details The InternalNode class holds an array of separator keys and an
+ * array of child nodes. Child i holds the keys in [m_keys[i-1], m_keys[i]).
+ * When the tree is augmented it also caches the aggregate of every child.
  * */
 template <BPLUS_TEMPLATES, size_t MAX_CHILDS = M, size_t MAX_KEYS = M - 1>
 class InternalNode {
 
   friend class BPlusTree<BPLUS_TEMPLATE_PARAMS>;
+  friend class NodeHandler<BPLUS_TEMPLATE_PARAMS, MAX_CHILDS, MAX_KEYS>;
+
+public:
+  InternalNode() = default;
 
 private:
   using NodeHandler_ = NodeHandler<BPLUS_TEMPLATE_PARAMS, MAX_CHILDS, MAX_KEYS>;
+  using size_type = size_t;
+  using augmentation = typename Traits::augmentation;
+  using aggregate_type = typename augmentation::aggregate_type;
+
+  static constexpr bool C_AUGMENTED = is_augmented_v<augmentation>;
+
+  using aggregates_type =
+      std::conditional_t<C_AUGMENTED, std::array<aggregate_type, MAX_CHILDS>,
+                         NoAugmentation::aggregate_type>;
+
+  [[nodiscard]] bool full() const noexcept { return m_count == MAX_KEYS; }
+
+  std::array<Key, MAX_KEYS> &keys() noexcept { return m_keys; }
+
+  /// @brief Index of the child whose range contains key
+  template <typename K>
+  [[nodiscard]] size_type child_index(const K &key,
+                                      const Compare &comparator) const;
+
+  /// @brief Inserts key at position and child right after it
+  /// @pre The node is not full
+  void insert_at(size_type position, Key key, NodeHandler_ child,
+                 const aggregate_type &aggregate);
+
+  /// @brief Splits a full node while inserting key and child at position
+  /// @details The upper half of the keys and children is moved into right.
+  /// @return The separator that has to be pushed into the parent.
+  Key split_insert(size_type position, Key key, NodeHandler_ child,
+                   const aggregate_type &aggregate, InternalNode &right);
+
+  /// @brief Removes the key at position and the child after it
+  void erase_at(size_type position);
 
-  std::array<Key, MAX_KEYS> m_keys;                  ///< Array of (M-1) keys
-  std::array<NodeHandler_ *, MAX_CHILDS> m_children; ///< Array of M children
+  /// @brief Appends separator and every key and child of right
+  /// @pre Both nodes and the separator fit in one
+  void merge_from(Key separator, InternalNode &right);
+
+  /// @brief Evens out the number of children with the right sibling,
+  /// rotating keys through separator
+  /// @return The new separator between both nodes
+  Key balance_with(Key separator, InternalNode &right);
+
+  /// @brief Detaches child index, moving the children after it into right
+  /// @details The keys next to the detached child are dropped and this node
+  /// keeps the children before index. right may be nullptr when at most one
+  /// child follows index. Used when cutting the tree along a root to leaf
+  /// path.
+  void detach_child(size_type index, InternalNode *right);
+
+  /// @brief Swaps the first two children, used to prepend a child
+  void swap_front_children() noexcept;
+
+  std::array<Key, MAX_KEYS> m_keys;                 ///< Array of (M-1) keys
+  std::array<NodeHandler_, MAX_CHILDS> m_children; ///< Array of M children
+  [[no_unique_address]] aggregates_type
+      m_aggregates;       ///< Cached aggregate of every child
+  size_type m_count = 0; ///< Number of keys in use, children are m_count + 1
+  std::atomic<size_type> m_refs{1}; ///< Trees and snapshots sharing the node
 };
 
+template <NODE_TEMPLATES>
+template <typename K>
+auto InternalNode<NODE_TEMPLATE_PARAMS>::child_index(
+    const K &key, const Compare &comparator) const -> size_type {
+  return Traits::node_search::partition_point(
+      m_count, [&](size_type index) { return !comparator(key, m_keys[index]); },
+      [&](size_type index) -> const Key & { return m_keys[index]; }, key);
+}
+
+template <NODE_TEMPLATES>
+void InternalNode<NODE_TEMPLATE_PARAMS>::insert_at(
+    size_type position, Key key, NodeHandler_ child,
+    const aggregate_type &aggregate) {
+
+  relocate_backward(m_keys.begin() + position, m_keys.begin() + m_count,
+                    m_keys.begin() + m_count + 1);
+  relocate_backward(m_children.begin() + position + 1,
+                    m_children.begin() + m_count + 1,
+                    m_children.begin() + m_count + 2);
+  if constexpr (C_AUGMENTED) {
+    std::move_backward(m_aggregates.begin() + position + 1,
+                       m_aggregates.begin() + m_count + 1,
+                       m_aggregates.begin() + m_count + 2);
+    m_aggregates[position + 1] = aggregate;
+  }
+
+  m_keys[position] = std::move(key);
+  m_children[position + 1] = child;
+  ++m_count;
+}
+
+template <NODE_TEMPLATES>
+Key InternalNode<NODE_TEMPLATE_PARAMS>::split_insert(
+    size_type position, Key key, NodeHandler_ child,
+    const aggregate_type &aggregate, InternalNode &right) {
+
+  constexpr size_type total = MAX_KEYS + 1;
+  constexpr size_type left_count = total / 2;
+
+  std::array<Key, total> keys;
+  std::array<NodeHandler_, total + 1> children;
+  relocate(m_keys.begin(), m_keys.begin() + position, keys.begin());
+  keys[position] = std::move(key);
+  relocate(m_keys.begin() + position, m_keys.end(),
+           keys.begin() + position + 1);
+  relocate(m_children.begin(), m_children.begin() + position + 1,
+           children.begin());
+  children[position + 1] = child;
+  relocate(m_children.begin() + position + 1, m_children.end(),
+           children.begin() + position + 2);
+
+  relocate(keys.begin(), keys.begin() + left_count, m_keys.begin());
+  relocate(children.begin(), children.begin() + left_count + 1,
+           m_children.begin());
+  std::fill(m_children.begin() + left_count + 1, m_children.end(), nullptr);
+  m_count = left_count;
+
+  relocate(keys.begin() + left_count + 1, keys.end(), right.m_keys.begin());
+  relocate(children.begin() + left_count + 1, children.end(),
+           right.m_children.begin());
+  right.m_count = total - left_count - 1;
+
+  if constexpr (C_AUGMENTED) {
+    std::array<aggregate_type, total + 1> aggregates;
+    std::copy(m_aggregates.begin(), m_aggregates.begin() + position + 1,
+              aggregates.begin());
+    aggregates[position + 1] = aggregate;
+    std::copy(m_aggregates.begin() + position + 1, m_aggregates.end(),
+              aggregates.begin() + position + 2);
+    std::copy(aggregates.begin(), aggregates.begin() + left_count + 1,
+              m_aggregates.begin());
+    std::copy(aggregates.begin() + left_count + 1, aggregates.end(),
+              right.m_aggregates.begin());
+  }
+
+  return std::move(keys[left_count]);
+}
+
+template <NODE_TEMPLATES>
+void InternalNode<NODE_TEMPLATE_PARAMS>::erase_at(size_type position) {
+  relocate(m_keys.begin() + position + 1, m_keys.begin() + m_count,
+           m_keys.begin() + position);
+  relocate(m_children.begin() + position + 2,
+           m_children.begin() + m_count + 1,
+           m_children.begin() + position + 1);
+  if constexpr (C_AUGMENTED) {
+    std::move(m_aggregates.begin() + position + 2,
+              m_aggregates.begin() + m_count + 1,
+              m_aggregates.begin() + position + 1);
+  }
+  m_children[m_count] = nullptr;
+  --m_count;
+}
+
+template <NODE_TEMPLATES>
+void InternalNode<NODE_TEMPLATE_PARAMS>::merge_from(Key separator,
+                                                    InternalNode &right) {
+  m_keys[m_count] = std::move(separator);
+  relocate(right.m_keys.begin(), right.m_keys.begin() + right.m_count,
+           m_keys.begin() + m_count + 1);
+  relocate(right.m_children.begin(),
+           right.m_children.begin() + right.m_count + 1,
+           m_children.begin() + m_count + 1);
+  if constexpr (C_AUGMENTED) {
+    std::copy(right.m_aggregates.begin(),
+              right.m_aggregates.begin() + right.m_count + 1,
+              m_aggregates.begin() + m_count + 1);
+  }
+  m_count += right.m_count + 1;
+
+  std::fill(right.m_children.begin(), right.m_children.end(), nullptr);
+  right.m_count = 0;
+}
+
+template <NODE_TEMPLATES>
+Key InternalNode<NODE_TEMPLATE_PARAMS>::balance_with(Key separator,
+                                                     InternalNode &right) {
+  const size_type total = m_count + right.m_count + 2;
+  const size_type left_children = (total + 1) / 2;
+  const size_type right_children = total - left_children;
+
+  if (m_count + 1 > left_children) {
+    // Rotate the tail of this node into the front of right
+    const size_type moved = m_count + 1 - left_children;
+    relocate_backward(right.m_keys.begin(),
+                      right.m_keys.begin() + right.m_count,
+                      right.m_keys.begin() + right.m_count + moved);
+    relocate_backward(right.m_children.begin(),
+                      right.m_children.begin() + right.m_count + 1,
+                      right.m_children.begin() + right.m_count + 1 + moved);
+    right.m_keys[moved - 1] = std::move(separator);
+    relocate(m_keys.begin() + left_children, m_keys.begin() + m_count,
+             right.m_keys.begin());
+    relocate(m_children.begin() + left_children,
+             m_children.begin() + m_count + 1, right.m_children.begin());
+    if constexpr (C_AUGMENTED) {
+      std::move_backward(right.m_aggregates.begin(),
+                         right.m_aggregates.begin() + right.m_count + 1,
+                         right.m_aggregates.begin() + right.m_count + 1 +
+                             moved);
+      std::copy(m_aggregates.begin() + left_children,
+                m_aggregates.begin() + m_count + 1,
+                right.m_aggregates.begin());
+    }
+    separator = std::move(m_keys[left_children - 1]);
+    std::fill(m_children.begin() + left_children,
+              m_children.begin() + m_count + 1, nullptr);
+  } else if (m_count + 1 < left_children) {
+    // Rotate the front of right into the tail of this node
+    const size_type moved = left_children - m_count - 1;
+    m_keys[m_count] = std::move(separator);
+    relocate(right.m_keys.begin(), right.m_keys.begin() + moved - 1,
+             m_keys.begin() + m_count + 1);
+    relocate(right.m_children.begin(), right.m_children.begin() + moved,
+             m_children.begin() + m_count + 1);
+    if constexpr (C_AUGMENTED) {
+      std::copy(right.m_aggregates.begin(),
+                right.m_aggregates.begin() + moved,
+                m_aggregates.begin() + m_count + 1);
+      std::move(right.m_aggregates.begin() + moved,
+                right.m_aggregates.begin() + right.m_count + 1,
+                right.m_aggregates.begin());
+    }
+    separator = std::move(right.m_keys[moved - 1]);
+    relocate(right.m_keys.begin() + moved,
+             right.m_keys.begin() + right.m_count, right.m_keys.begin());
+    relocate(right.m_children.begin() + moved,
+             right.m_children.begin() + right.m_count + 1,
+             right.m_children.begin());
+    std::fill(right.m_children.begin() + right_children,
+              right.m_children.begin() + right.m_count + 1, nullptr);
+  }
+
+  m_count = left_children - 1;
+  right.m_count = right_children - 1;
+  return separator;
+}
+
+template <NODE_TEMPLATES>
+void InternalNode<NODE_TEMPLATE_PARAMS>::detach_child(size_type index,
+                                                      InternalNode *right) {
+  const size_type right_children = m_count - index;
+  if (right != nullptr && right_children > 0) {
+    relocate(m_keys.begin() + index + 1, m_keys.begin() + m_count,
+             right->m_keys.begin());
+    relocate(m_children.begin() + index + 1,
+             m_children.begin() + m_count + 1, right->m_children.begin());
+    if constexpr (C_AUGMENTED) {
+      std::copy(m_aggregates.begin() + index + 1,
+                m_aggregates.begin() + m_count + 1,
+                right->m_aggregates.begin());
+    }
+    right->m_count = right_children - 1;
+  }
+
+  std::fill(m_children.begin() + index, m_children.begin() + m_count + 1,
+            nullptr);
+  m_count = index > 0 ? index - 1 : 0;
+}
+
+template <NODE_TEMPLATES>
+void InternalNode<NODE_TEMPLATE_PARAMS>::swap_front_children() noexcept {
+  std::swap(m_children[0], m_children[1]);
+  if constexpr (C_AUGMENTED) {
+    std::swap(m_aggregates[0], m_aggregates[1]);
+  }
+}
+
 #endif // !INTERNAL_NODE_HPP
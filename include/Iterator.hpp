@@ -2,17 +2,104 @@
 #define ITERATOR_HPP
 
 #include "Concepts.hpp"
+#include <cstddef>
+#include <iterator>
+
+template <BPLUS_TEMPLATES, size_t MAX_CHILDS, size_t MAX_KEYS> class LeafNode;
 
 /**
  * @class BPlusTreeIterator
  * @brief Iterator for B+ tree.
  * @details The BPlusTreeIterator class is a bidirectional iterator which
- * follows the standard
+ * follows the standard. It walks the leaf chain, end() has no leaf and
+ * finds the tail through the tree it came from. A mutable iterator returned
+ * by the tree has each leaf it steps on copied while a snapshot shares it.
  * */
 template <BPLUS_TEMPLATES, bool isConst> class BPlusTreeIterator {
 
+  friend class BPlusTree<BPLUS_TEMPLATE_PARAMS>;
+  friend class BPlusTreeIterator<BPLUS_TEMPLATE_PARAMS, !isConst>;
+
+  using LeafNode_ = LeafNode<BPLUS_TEMPLATE_PARAMS, M, M - 1>;
+  using Tree_ =
+      std::conditional_t<isConst, const BPlusTree<BPLUS_TEMPLATE_PARAMS>,
+                         BPlusTree<BPLUS_TEMPLATE_PARAMS>>;
+
 public:
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = std::pair<const Key, T>;
+  using difference_type = std::ptrdiff_t;
+  using pointer = std::conditional_t<isConst, const value_type *, value_type *>;
+  using reference =
+      std::conditional_t<isConst, const value_type &, value_type &>;
+
   BPlusTreeIterator() = default;
+
+  /// @brief Conversion from iterator to const_iterator
+  template <bool wasConst>
+    requires(isConst && !wasConst)
+  BPlusTreeIterator(
+      const BPlusTreeIterator<BPLUS_TEMPLATE_PARAMS, wasConst> &other) noexcept
+      : m_leaf(other.m_leaf), m_index(other.m_index),
+        m_tree(other.m_tree) {}
+
+  reference operator*() const { return *m_leaf->m_values[m_index]; }
+  pointer operator->() const { return m_leaf->m_values[m_index]; }
+
+  BPlusTreeIterator &operator++() {
+    ++m_index;
+    if (m_index == m_leaf->m_count) {
+      m_leaf = m_leaf->m_next;
+      m_index = 0;
+      own();
+    }
+    return *this;
+  }
+
+  BPlusTreeIterator operator++(int) {
+    auto copy = *this;
+    ++*this;
+    return copy;
+  }
+
+  BPlusTreeIterator &operator--() {
+    if (m_leaf != nullptr && m_index > 0) {
+      --m_index;
+      return *this;
+    }
+    m_leaf = m_leaf == nullptr ? m_tree->m_tail : m_leaf->m_prev;
+    m_index = m_leaf->m_count - 1;
+    own();
+    return *this;
+  }
+
+  BPlusTreeIterator operator--(int) {
+    auto copy = *this;
+    --*this;
+    return copy;
+  }
+
+  [[nodiscard]] bool operator==(const BPlusTreeIterator &other) const {
+    return m_leaf == other.m_leaf && m_index == other.m_index;
+  }
+
+private:
+  BPlusTreeIterator(LeafNode_ *leaf, size_t index,
+                    Tree_ *tree = nullptr) noexcept
+      : m_leaf(leaf), m_index(index), m_tree(tree) {}
+
+  /// @brief Lets the tree copy the leaf reached, if a snapshot shares it
+  void own() {
+    if constexpr (!isConst) {
+      if (m_tree != nullptr) {
+        *this = m_tree->owned(*this);
+      }
+    }
+  }
+
+  LeafNode_ *m_leaf = nullptr; ///< Leaf holding the current value, or none
+  size_t m_index = 0;          ///< Index of the value inside m_leaf
+  Tree_ *m_tree = nullptr;     ///< Tree the iterator came from
 };
 
 #endif // !ITERATOR_HPP
@@ -3,10 +3,13 @@
 
 #include "Concepts.hpp"
 #include "Iterator.hpp"
+#include "Relocate.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
-
-// Debug
-#include "iostream"
+#include <type_traits>
 
 template <BPLUS_TEMPLATES, size_t MAX_CHILDS, size_t MAX_KEYS>
 class NodeHandler;
@@ -14,88 +17,344 @@ class NodeHandler;
 /**
  * @class LeafNode
  * @brief Leaf node for B+ tree.
- * @details The LeafNode class inherits from @ref Node "Node" and adds an
- * array of values and pointers to the next and previous leaf nodes.
+ * @details The LeafNode class holds a sorted array of pointers to the stored
+ * values and pointers to the next and previous leaf nodes. With a
+ * Traits::leaf_fingerprint policy, it also holds the fingerprint of every
+ * key, kept in step with the values by each operation.
  * */
 template <BPLUS_TEMPLATES, size_t MAX_CHILDS, size_t MAX_KEYS> class LeafNode {
 
   friend class BPlusTree<BPLUS_TEMPLATE_PARAMS>;
   friend class NodeHandler<BPLUS_TEMPLATE_PARAMS, MAX_CHILDS, MAX_KEYS>;
+  friend class BPlusTreeIterator<BPLUS_TEMPLATE_PARAMS, false>;
+  friend class BPlusTreeIterator<BPLUS_TEMPLATE_PARAMS, true>;
+
+public:
+  LeafNode() { std::fill(m_values.begin(), m_values.end(), nullptr); }
 
 private:
-  using value_type = T;
-  using iterator = BPlusTreeIterator<BPLUS_TEMPLATE_PARAMS, false>;
-  using const_iterator = BPlusTreeIterator<BPLUS_TEMPLATE_PARAMS, true>;
+  using value_type = std::pair<const Key, T>;
+  using size_type = size_t;
+  using fingerprint = typename Traits::leaf_fingerprint;
 
-  explicit LeafNode(Allocator &allocator, Compare &comparator)
-      : m_allocator(allocator), m_comparator(comparator) {
-    std::fill(m_values.begin(), m_values.end(), nullptr);
-  }
+  static constexpr bool fingerprinted = fingerprint::enabled;
 
-  // Insert
+  /// @brief Placeholder stored instead of the fingerprints when disabled
+  struct NoFingerprints {};
 
-  std::pair<iterator, InsertResult> insert(const value_type &value);
+  using Fingerprints =
+      std::conditional_t<fingerprinted, std::array<std::uint8_t, MAX_KEYS>,
+                         NoFingerprints>;
 
-  template <rvalue_constructible_from<value_type> P>
-  std::pair<iterator, bool> insert(P &&value) {
-    emplace(std::forward<P>(value));
+  /// @brief Key of the value stored at index
+  [[nodiscard]] decltype(auto) key(size_type index) const {
+    return Indexor{}(*m_values[index]);
   }
 
-  std::pair<iterator, bool> insert(value_type &&value);
+  [[nodiscard]] bool full() const noexcept { return m_count == MAX_KEYS; }
 
-  iterator insert(const_iterator position, const value_type &value);
+  std::array<value_type *, MAX_KEYS> &values() noexcept { return m_values; }
 
-  template <rvalue_constructible_from<value_type> P>
-  iterator insert(const_iterator position, P &&value) {
-    emplace_hint(position, std::forward<P>(value));
-  }
+  /// @brief Index of the first value whose key is not less than key
+  template <typename K>
+  [[nodiscard]] size_type lower_bound(const K &key,
+                                      const Compare &comparator) const;
+
+  /// @brief Index of the first value whose key is greater than key
+  template <typename K>
+  [[nodiscard]] size_type upper_bound(const K &key,
+                                      const Compare &comparator) const;
+
+  /// @brief Index of the value whose key is equivalent to key, or m_count
+  /// @details With fingerprints, only the values whose fingerprint matches
+  /// the one of key are compared, comparisons counts them.
+  template <typename K>
+  [[nodiscard]] size_type find(const K &key, const Compare &comparator,
+                               size_type &comparisons) const;
+
+  /// @brief Recomputes the fingerprints of every value
+  /// @details For the operations that fill m_values directly.
+  void refresh_fingerprints();
+
+  /// @brief Whether every fingerprint matches the key of its value
+  [[nodiscard]] bool fingerprints_match() const;
 
-  iterator insert(const_iterator position, value_type &&value);
+  /// @brief Inserts value at position, shifting the tail to the right
+  /// @pre The node is not full
+  void insert_at(size_type position, value_type *value);
 
-  template <ValueInputIterator<value_type> InputIt>
-  void insert(InputIt first, InputIt last);
+  /// @brief Splits a full node while inserting value at position
+  /// @details The upper half of the values is moved into right, which is
+  /// linked after this node.
+  /// @return Node and index where value ended up.
+  std::pair<LeafNode *, size_type> split_insert(size_type position,
+                                                value_type *value,
+                                                LeafNode &right);
 
-  void insert(std::initializer_list<value_type> ilist);
+  /// @brief Removes the value at position and returns it
+  value_type *erase_at(size_type position);
+
+  /// @brief Moves the values from position on into the empty node right
+  void move_tail(size_type position, LeafNode &right);
+
+  /// @brief Appends every value of right, which is unlinked from the chain
+  /// @pre Both nodes fit in one
+  void merge_from(LeafNode &right);
+
+  /// @brief Evens out the number of values with the right sibling
+  void balance_with(LeafNode &right);
+
+  /// @brief Moves the first count values of the right sibling to the tail
+  /// @pre They fit in this node
+  void take_front(LeafNode &right, size_type count);
 
   std::array<value_type *, MAX_KEYS>
       m_values;               ///< Array of (M-1) values_types (key-value pairs)
-  LeafNode *m_next = nullptr; ///< Pointer to next leaf node
-  LeafNode *m_prev = nullptr; ///< Pointer to previous leaf node
-  Allocator &m_allocator;     ///< Allocator for the node
-  Compare &m_comparator;
+  size_type m_count = 0;            ///< Number of values in use
+  LeafNode *m_next = nullptr;       ///< Pointer to next leaf node
+  LeafNode *m_prev = nullptr;       ///< Pointer to previous leaf node
+  std::atomic<size_type> m_refs{1}; ///< Trees and snapshots sharing the node
+  [[no_unique_address]] Fingerprints
+      m_fingerprints{}; ///< Fingerprint of the key of each value
 };
 
 template <NODE_TEMPLATES>
-auto LeafNode<NODE_TEMPLATE_PARAMS>::insert(const value_type &value)
-    -> std::pair<iterator, InsertResult> {
+template <typename K>
+auto LeafNode<NODE_TEMPLATE_PARAMS>::lower_bound(
+    const K &key, const Compare &comparator) const -> size_type {
+  return Traits::node_search::partition_point(
+      m_count,
+      [&](size_type index) { return comparator(this->key(index), key); },
+      [&](size_type index) -> decltype(auto) { return this->key(index); },
+      key);
+}
 
-  // Find the position of the value in the sorted array
-  auto position = m_values.begin();
+template <NODE_TEMPLATES>
+template <typename K>
+auto LeafNode<NODE_TEMPLATE_PARAMS>::upper_bound(
+    const K &key, const Compare &comparator) const -> size_type {
+  return Traits::node_search::partition_point(
+      m_count,
+      [&](size_type index) { return !comparator(key, this->key(index)); },
+      [&](size_type index) -> decltype(auto) { return this->key(index); },
+      key);
+}
 
-  for (; position != m_values.end(); ++position) {
-    if (*position == nullptr || m_comparator(value.first, (*position)->first)) {
-      break;
+template <NODE_TEMPLATES>
+template <typename K>
+auto LeafNode<NODE_TEMPLATE_PARAMS>::find(const K &key,
+                                          const Compare &comparator,
+                                          size_type &comparisons) const
+    -> size_type {
+  if constexpr (fingerprinted && std::is_same_v<K, Key>) {
+    const auto wanted = fingerprint::of(key);
+    comparisons = 0;
+    for (size_type index = 0; index < m_count; ++index) {
+      if (m_fingerprints[index] == wanted) {
+        ++comparisons;
+        const auto &candidate = this->key(index);
+        if (!comparator(candidate, key) && !comparator(key, candidate)) {
+          return index;
+        }
+      }
     }
+    return m_count;
+  } else {
+    const auto position = lower_bound(key, comparator);
+    comparisons = Traits::node_search::comparisons(position, m_count);
+    if (position == m_count || comparator(key, this->key(position))) {
+      return m_count;
+    }
+    return position;
   }
+}
 
-  // If the value is already in the array, return false
-  if (position != m_values.end() && (*position != nullptr) &&
-      (*position)->first == (value.first)) {
-    return {{}, INSERTION::ALREADY_EXISTS};
+template <NODE_TEMPLATES>
+void LeafNode<NODE_TEMPLATE_PARAMS>::refresh_fingerprints() {
+  if constexpr (fingerprinted) {
+    for (size_type index = 0; index < m_count; ++index) {
+      m_fingerprints[index] = fingerprint::of(this->key(index));
+    }
   }
+}
 
-  // If the array is full, return false
-  if (m_values.back() != nullptr) {
-    return {{}, INSERTION::WAS_FULL};
+template <NODE_TEMPLATES>
+bool LeafNode<NODE_TEMPLATE_PARAMS>::fingerprints_match() const {
+  if constexpr (fingerprinted) {
+    for (size_type index = 0; index < m_count; ++index) {
+      if (m_fingerprints[index] != fingerprint::of(this->key(index))) {
+        return false;
+      }
+    }
   }
+  return true;
+}
+
+template <NODE_TEMPLATES>
+void LeafNode<NODE_TEMPLATE_PARAMS>::insert_at(size_type position,
+                                               value_type *value) {
 
   // Shift the values to the right to make room for the new value
-  std::move_backward(position, m_values.end() - 1, m_values.end());
+  relocate_backward(m_values.begin() + position, m_values.begin() + m_count,
+                    m_values.begin() + m_count + 1);
+  m_values[position] = value;
+  if constexpr (fingerprinted) {
+    relocate_backward(m_fingerprints.begin() + position,
+                      m_fingerprints.begin() + m_count,
+                      m_fingerprints.begin() + m_count + 1);
+    m_fingerprints[position] = fingerprint::of(this->key(position));
+  }
+  ++m_count;
+}
+
+template <NODE_TEMPLATES>
+auto LeafNode<NODE_TEMPLATE_PARAMS>::split_insert(size_type position,
+                                                  value_type *value,
+                                                  LeafNode &right)
+    -> std::pair<LeafNode *, size_type> {
+
+  constexpr size_type total = MAX_KEYS + 1;
+  constexpr size_type left_count = (total + 1) / 2;
+
+  std::array<value_type *, total> merged;
+  relocate(m_values.begin(), m_values.begin() + position, merged.begin());
+  merged[position] = value;
+  relocate(m_values.begin() + position, m_values.end(),
+           merged.begin() + position + 1);
 
-  // Insert the new value
-  *position = m_allocator.allocate(1);
-  std::allocator_traits<Allocator>::construct(m_allocator, *position, value);
-  return {{}, INSERTION::SUCCESS};
+  relocate(merged.begin(), merged.begin() + left_count, m_values.begin());
+  std::fill(m_values.begin() + left_count, m_values.end(), nullptr);
+  m_count = left_count;
+
+  relocate(merged.begin() + left_count, merged.end(), right.m_values.begin());
+  right.m_count = total - left_count;
+
+  if constexpr (fingerprinted) {
+    std::array<std::uint8_t, total> prints;
+    relocate(m_fingerprints.begin(), m_fingerprints.begin() + position,
+             prints.begin());
+    prints[position] = fingerprint::of(Indexor{}(*value));
+    relocate(m_fingerprints.begin() + position, m_fingerprints.end(),
+             prints.begin() + position + 1);
+    relocate(prints.begin(), prints.begin() + left_count,
+             m_fingerprints.begin());
+    relocate(prints.begin() + left_count, prints.end(),
+             right.m_fingerprints.begin());
+  }
+
+  // Link right after this node
+  right.m_next = m_next;
+  right.m_prev = this;
+  if (m_next != nullptr) {
+    m_next->m_prev = &right;
+  }
+  m_next = &right;
+
+  if (position < left_count) {
+    return {this, position};
+  }
+  return {&right, position - left_count};
+}
+
+template <NODE_TEMPLATES>
+auto LeafNode<NODE_TEMPLATE_PARAMS>::erase_at(size_type position)
+    -> value_type * {
+  auto *value = m_values[position];
+  relocate(m_values.begin() + position + 1, m_values.begin() + m_count,
+           m_values.begin() + position);
+  if constexpr (fingerprinted) {
+    relocate(m_fingerprints.begin() + position + 1,
+             m_fingerprints.begin() + m_count,
+             m_fingerprints.begin() + position);
+  }
+  m_values[--m_count] = nullptr;
+  return value;
+}
+
+template <NODE_TEMPLATES>
+void LeafNode<NODE_TEMPLATE_PARAMS>::move_tail(size_type position,
+                                               LeafNode &right) {
+  relocate(m_values.begin() + position, m_values.begin() + m_count,
+           right.m_values.begin());
+  if constexpr (fingerprinted) {
+    relocate(m_fingerprints.begin() + position,
+             m_fingerprints.begin() + m_count, right.m_fingerprints.begin());
+  }
+  std::fill(m_values.begin() + position, m_values.begin() + m_count, nullptr);
+  right.m_count = m_count - position;
+  m_count = position;
+}
+
+template <NODE_TEMPLATES>
+void LeafNode<NODE_TEMPLATE_PARAMS>::merge_from(LeafNode &right) {
+  relocate(right.m_values.begin(), right.m_values.begin() + right.m_count,
+           m_values.begin() + m_count);
+  if constexpr (fingerprinted) {
+    relocate(right.m_fingerprints.begin(),
+             right.m_fingerprints.begin() + right.m_count,
+             m_fingerprints.begin() + m_count);
+  }
+  m_count += right.m_count;
+  std::fill(right.m_values.begin(), right.m_values.end(), nullptr);
+  right.m_count = 0;
+
+  m_next = right.m_next;
+  if (m_next != nullptr) {
+    m_next->m_prev = this;
+  }
+  right.m_next = nullptr;
+  right.m_prev = nullptr;
+}
+
+template <NODE_TEMPLATES>
+void LeafNode<NODE_TEMPLATE_PARAMS>::balance_with(LeafNode &right) {
+  const size_type total = m_count + right.m_count;
+  const size_type left_count = (total + 1) / 2;
+
+  if (m_count > left_count) {
+    // Move the tail of this node to the front of right
+    const size_type moved = m_count - left_count;
+    relocate_backward(right.m_values.begin(),
+                      right.m_values.begin() + right.m_count,
+                      right.m_values.begin() + right.m_count + moved);
+    relocate(m_values.begin() + left_count, m_values.begin() + m_count,
+             right.m_values.begin());
+    std::fill(m_values.begin() + left_count, m_values.begin() + m_count,
+              nullptr);
+    if constexpr (fingerprinted) {
+      relocate_backward(right.m_fingerprints.begin(),
+                        right.m_fingerprints.begin() + right.m_count,
+                        right.m_fingerprints.begin() + right.m_count + moved);
+      relocate(m_fingerprints.begin() + left_count,
+               m_fingerprints.begin() + m_count, right.m_fingerprints.begin());
+    }
+  } else if (m_count < left_count) {
+    take_front(right, left_count - m_count);
+    return;
+  }
+  m_count = left_count;
+  right.m_count = total - left_count;
+}
+
+template <NODE_TEMPLATES>
+void LeafNode<NODE_TEMPLATE_PARAMS>::take_front(LeafNode &right,
+                                                size_type count) {
+  relocate(right.m_values.begin(), right.m_values.begin() + count,
+           m_values.begin() + m_count);
+  relocate(right.m_values.begin() + count,
+           right.m_values.begin() + right.m_count, right.m_values.begin());
+  std::fill(right.m_values.begin() + right.m_count - count,
+            right.m_values.begin() + right.m_count, nullptr);
+  if constexpr (fingerprinted) {
+    relocate(right.m_fingerprints.begin(),
+             right.m_fingerprints.begin() + count,
+             m_fingerprints.begin() + m_count);
+    relocate(right.m_fingerprints.begin() + count,
+             right.m_fingerprints.begin() + right.m_count,
+             right.m_fingerprints.begin());
+  }
+  m_count += count;
+  right.m_count -= count;
 }
 
 #endif // !LEAF_NODE_HPP
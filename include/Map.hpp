@@ -3,61 +3,125 @@
 
 #include "BPlusTree.hpp"
 
-template <size_t M, properKeyValue Key, properKeyValue T,
+#include <stdexcept>
+
+template <typename Key, typename value_type> struct MapIndexor {
+  const Key &operator()(const value_type &pair) { return pair.first; }
+};
+
+template <size_t M, properKeyValue Key, properMappedValue T,
           std::predicate<Key, Key> Compare = std::less<Key>,
-          IsAllocator Allocator = std::allocator<std::pair<const Key, T>>>
-struct Map : public BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1> {
+          IsAllocator Allocator = std::allocator<std::pair<const Key, T>>,
+          TreeTraits<std::pair<const Key, T>> Traits = DefaultTraits>
+struct Map
+    : public BPlusTree<M, Key, T, MapIndexor<Key, std::pair<const Key, T>>,
+                       Compare, Allocator, Traits> {
+
+  using indexor = MapIndexor<Key, std::pair<const Key, T>>;
+  using tree = BPlusTree<M, Key, T, indexor, Compare, Allocator, Traits>;
 
   // operator= is not inherited by default
-  using BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1>::operator=;
+  using tree::operator=;
   using value_type = std::pair<const Key, T>;
+  using mapped_type = T;
+
+  [[nodiscard]] static constexpr bool is_map() noexcept { return true; }
+
+  /// @brief Mapped value of key, throws std::out_of_range like std::map
+  /// @details O(1) with a Traits::point_index.
+  [[nodiscard]] T &at(const Key &key) {
+    auto *value = this->find_value(key);
+    if (value == nullptr) {
+      throw std::out_of_range("Map::at key not found");
+    }
+    return value->second;
+  }
+
+  [[nodiscard]] const T &at(const Key &key) const {
+    const auto *value = this->find_value(key);
+    if (value == nullptr) {
+      throw std::out_of_range("Map::at key not found");
+    }
+    return value->second;
+  }
+
+  /// @brief Mapped value of key, value initialized first if key is absent
+  /// @details Present keys take O(1) with a Traits::point_index.
+  T &operator[](const Key &key)
+    requires std::default_initializable<T>
+  {
+    if (auto *value = this->find_value(key)) {
+      return value->second;
+    }
+    return this->try_emplace(key).first->second;
+  }
+
+  T &operator[](Key &&key)
+    requires std::default_initializable<T>
+  {
+    if (auto *value = this->find_value(key)) {
+      return value->second;
+    }
+    return this->try_emplace(std::move(key)).first->second;
+  }
+
+  /// @brief Keys present in either map, values of *this win on ties
+  [[nodiscard]] Map merge_union(const Map &other) const {
+    Map result(this->key_comp(), this->get_allocator());
+    result.assign_union(*this, other);
+    return result;
+  }
+
+  /// @brief Keys present in both maps, with the values of *this
+  [[nodiscard]] Map intersect(const Map &other) const {
+    Map result(this->key_comp(), this->get_allocator());
+    result.assign_intersection(*this, other);
+    return result;
+  }
+
+  /// @brief Keys of *this that are not present in other
+  [[nodiscard]] Map difference(const Map &other) const {
+    Map result(this->key_comp(), this->get_allocator());
+    result.assign_difference(*this, other);
+    return result;
+  }
 
   // Forwarding all constructors
 
   Map() : Map(Compare()) {}
 
   explicit Map(const Compare &comp, const Allocator &alloc = Allocator())
-      : BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1>(comp, alloc) {
-  }
+      : tree(comp, alloc) {}
 
-  explicit Map(const Allocator &alloc)
-      : BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1>(alloc) {}
+  explicit Map(const Allocator &alloc) : tree(alloc) {}
 
   template <ValueInputIterator<value_type> InputIt>
   Map(InputIt first, InputIt last, const Compare &comp,
       const Allocator &alloc = Allocator())
-      : BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1>(first, last,
-                                                                  comp, alloc) {
-  }
+      : tree(first, last, comp, alloc) {}
 
   template <ValueInputIterator<value_type> InputIt>
   Map(InputIt first, InputIt last, const Allocator &alloc)
-      : BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1>(first, last,
-                                                                  alloc) {}
+      : tree(first, last, alloc) {}
+
+  Map(const Map &other) : tree(other) {}
 
-  Map(const Map &other)
-      : BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1>(other) {}
+  Map(const Map &other, const Allocator &alloc) : tree(other, alloc) {}
 
-  Map(const Map &other, const Allocator &alloc)
-      : BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1>(other,
-                                                                  alloc) {}
+  Map(Map &&other) noexcept : tree(std::move(other)) {}
 
-  Map(Map &&other) noexcept
-      : BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1>(
-            std::move(other)) {}
+  Map(Map &&other, const Allocator &alloc) : tree(std::move(other), alloc) {}
 
-  Map(Map &&other, const Allocator &alloc)
-      : BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1>(
-            std::move(other), alloc) {}
+  Map &operator=(const Map &other) = default;
+
+  Map &operator=(Map &&other) = default;
 
   Map(std::initializer_list<value_type> init, const Compare &comp,
       const Allocator &alloc = Allocator())
-      : BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1>(init, comp,
-                                                                  alloc) {}
+      : tree(init, comp, alloc) {}
 
   Map(std::initializer_list<value_type> init, const Allocator &alloc)
-      : BPlusTree<M, Key, T, Compare, Allocator, false, M, M - 1>(init, alloc) {
-  }
+      : tree(init, alloc) {}
 };
 
 #endif // !MAP_HPP
@@ -0,0 +1,159 @@
+#ifndef MEMORY_BUDGET_HPP
+#define MEMORY_BUDGET_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+
+/// @defgroup MemoryBudget Memory budget
+/// @name MemoryBudget
+/// @brief Soft limit on the bytes allocated by a group of trees
+/// @details
+/// BudgetAllocator counts every node, value and point index allocation of
+/// the trees using it, with the size of the type its tree rebound it to, so
+/// the count is exact. Before inserting a key it does not hold, such a tree
+/// asks the budget to make room for the value and the leaf it allocates:
+/// when they would take it over its limit, the budget calls its callback
+/// first, which can evict values, spill them to disk or raise the limit.
+/// Insertions of present keys, and of node handles of the same budget,
+/// allocate no value and never evict for one. The insertion then proceeds
+/// whatever the callback did, allocations never fail because of the budget.
+/// @{
+
+/**
+ * @brief Byte count and limit shared by the allocators bound to it
+ * @details The count is atomic and the callback runs on one thread at a
+ * time: while it runs, the insertions of other threads, and those of the
+ * callback itself, go on without calling it again. The callback may erase
+ * from any tree of the budget, including the one inserting, and insert into
+ * the others. The budget must outlive the trees allocating from it.
+ * */
+class MemoryBudget {
+public:
+  /// @brief Called with the bytes by which an insertion could exceed the limit
+  using callback_type = std::function<void(std::size_t excess)>;
+
+  explicit MemoryBudget(
+      std::size_t limit = std::numeric_limits<std::size_t>::max(),
+      callback_type on_exceeded = {})
+      : m_limit(limit), m_on_exceeded(std::move(on_exceeded)) {}
+  MemoryBudget(const MemoryBudget &) = delete;
+  MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+  /// @brief Bytes allocated and not yet freed
+  [[nodiscard]] std::size_t used() const noexcept {
+    return m_used.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] std::size_t limit() const noexcept {
+    return m_limit.load(std::memory_order_relaxed);
+  }
+
+  void set_limit(std::size_t limit) noexcept {
+    m_limit.store(limit, std::memory_order_relaxed);
+  }
+
+  /// @brief Number of times the callback was called
+  [[nodiscard]] std::size_t exceeded() const noexcept {
+    return m_exceeded.load(std::memory_order_relaxed);
+  }
+
+  /// @brief Whether allocating bytes more would exceed the limit
+  [[nodiscard]] bool over_budget(std::size_t bytes) const noexcept {
+    const auto used = this->used();
+    const auto limit = this->limit();
+    return used > limit || limit - used < bytes;
+  }
+
+  /// @brief Calls the callback if allocating bytes more would exceed the
+  /// limit
+  /// @return Whether the callback was called
+  bool make_room(std::size_t bytes) {
+    if (!over_budget(bytes) || !m_on_exceeded ||
+        m_running.exchange(true, std::memory_order_acquire)) {
+      return false;
+    }
+    struct Running {
+      std::atomic<bool> &running;
+      ~Running() { running.store(false, std::memory_order_release); }
+    } running{m_running};
+
+    m_exceeded.fetch_add(1, std::memory_order_relaxed);
+    const auto used = this->used() + bytes;
+    const auto limit = this->limit();
+    m_on_exceeded(used > limit ? used - limit : 0);
+    return true;
+  }
+
+  void allocated(std::size_t bytes) noexcept {
+    m_used.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  void deallocated(std::size_t bytes) noexcept {
+    m_used.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<std::size_t> m_used{0};
+  std::atomic<std::size_t> m_limit;
+  std::atomic<std::size_t> m_exceeded{0};
+  std::atomic<bool> m_running{false};
+  callback_type m_on_exceeded;
+};
+
+/**
+ * @brief Allocator counting its memory against a MemoryBudget
+ * @details Allocates through std::allocator. Allocators compare equal when
+ * they share their budget, so only trees of one budget split, join and
+ * exchange node handles in O(1), and bytes are always freed from the budget
+ * they were counted in.
+ * */
+template <typename T> class BudgetAllocator {
+public:
+  using value_type = T;
+
+  explicit BudgetAllocator(MemoryBudget &budget) noexcept
+      : m_budget(&budget) {}
+  template <typename U>
+  BudgetAllocator(const BudgetAllocator<U> &other) noexcept
+      : m_budget(&other.budget()) {}
+
+  T *allocate(std::size_t count) {
+    auto *pointer = std::allocator<T>().allocate(count);
+    m_budget->allocated(count * sizeof(T));
+    return pointer;
+  }
+
+  void deallocate(T *pointer, std::size_t count) noexcept {
+    m_budget->deallocated(count * sizeof(T));
+    std::allocator<T>().deallocate(pointer, count);
+  }
+
+  [[nodiscard]] MemoryBudget &budget() const noexcept { return *m_budget; }
+
+  /// @brief See MemoryBudget::over_budget, read by the trees
+  [[nodiscard]] bool over_budget(std::size_t bytes) const noexcept {
+    return m_budget->over_budget(bytes);
+  }
+
+  /// @brief See MemoryBudget::make_room, called by the trees
+  bool make_room(std::size_t bytes) const {
+    return m_budget->make_room(bytes);
+  }
+
+  template <typename U>
+  bool operator==(const BudgetAllocator<U> &other) const noexcept {
+    return m_budget == &other.budget();
+  }
+
+private:
+  MemoryBudget *m_budget;
+};
+
+/// @}
+
+#endif // !MEMORY_BUDGET_HPP
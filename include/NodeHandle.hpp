@@ -0,0 +1,113 @@
+#ifndef NODE_HANDLE_HPP
+#define NODE_HANDLE_HPP
+
+#include "Concepts.hpp"
+
+#include <memory>
+#include <optional>
+#include <utility>
+
+/**
+ * @class NodeHandle
+ * @brief Owns a value extracted from a BPlusTree, like std::map::node_type
+ * @details The value keeps the address it had in the tree, so extracting it
+ * and inserting it into another tree with an equal allocator neither copies
+ * nor reallocates it. An empty handle owns nothing. For a Set, key() and
+ * mapped() are the same element. The template parameters are named apart
+ * from the ones of BPlusTree, which the friend declaration redeclares.
+ * */
+template <typename KeyType, typename MappedType, typename AllocatorType>
+class NodeHandle {
+public:
+  using key_type = KeyType;
+  using mapped_type = MappedType;
+  using value_type = std::pair<const KeyType, MappedType>;
+  using allocator_type = AllocatorType;
+
+  constexpr NodeHandle() noexcept = default;
+
+  NodeHandle(NodeHandle &&other) noexcept
+      : m_value(std::exchange(other.m_value, nullptr)),
+        m_allocator(std::move(other.m_allocator)) {
+    other.m_allocator.reset();
+  }
+
+  NodeHandle &operator=(NodeHandle &&other) noexcept {
+    if (this != &other) {
+      reset();
+      m_value = std::exchange(other.m_value, nullptr);
+      m_allocator = std::move(other.m_allocator);
+      other.m_allocator.reset();
+    }
+    return *this;
+  }
+
+  NodeHandle(const NodeHandle &) = delete;
+  NodeHandle &operator=(const NodeHandle &) = delete;
+
+  ~NodeHandle() { reset(); }
+
+  [[nodiscard]] bool empty() const noexcept { return m_value == nullptr; }
+  explicit operator bool() const noexcept { return !empty(); }
+
+  /// @pre The handle is not empty
+  [[nodiscard]] allocator_type get_allocator() const { return *m_allocator; }
+
+  /// @pre The handle is not empty
+  [[nodiscard]] const key_type &key() const { return m_value->first; }
+
+  /// @pre The handle is not empty
+  [[nodiscard]] mapped_type &mapped() const { return m_value->second; }
+
+  /// @pre The handle is not empty
+  [[nodiscard]] value_type &value() const { return *m_value; }
+
+  void swap(NodeHandle &other) noexcept {
+    std::swap(m_value, other.m_value);
+    std::swap(m_allocator, other.m_allocator);
+  }
+
+  friend void swap(NodeHandle &lhs, NodeHandle &rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+private:
+  template <BPLUS_TEMPLATES> friend class BPlusTree;
+
+  using value_allocator_type = typename std::allocator_traits<
+      AllocatorType>::template rebind_alloc<value_type>;
+  using value_traits = std::allocator_traits<value_allocator_type>;
+
+  NodeHandle(value_type *value, const AllocatorType &alloc)
+      : m_value(value), m_allocator(alloc) {}
+
+  /// @brief Hands the value over to a tree, leaving the handle empty
+  value_type *release() noexcept {
+    m_allocator.reset();
+    return std::exchange(m_value, nullptr);
+  }
+
+  void reset() noexcept {
+    if (m_value != nullptr) {
+      value_allocator_type allocator(*m_allocator);
+      value_traits::destroy(allocator, m_value);
+      value_traits::deallocate(allocator, m_value, 1);
+      m_value = nullptr;
+    }
+    m_allocator.reset();
+  }
+
+  value_type *m_value = nullptr;
+  std::optional<AllocatorType> m_allocator;
+};
+
+/// @brief Result of inserting a NodeHandle, like std::map::insert_return_type
+/// @details When the key was already present, position points to the
+/// element that blocked the insertion and node still owns the value.
+template <typename Iterator, typename NodeType> struct InsertReturnType {
+  Iterator position;
+  bool inserted;
+  NodeType node;
+};
+
+#endif // !NODE_HANDLE_HPP
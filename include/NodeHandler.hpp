@@ -2,6 +2,7 @@
 #define NODE_HANDLER_HPP
 
 #include "array"
+#include <stdexcept>
 #include <variant>
 
 #include "Concepts.hpp"
@@ -17,7 +18,7 @@ template <typename T, typename U> struct erase_parenthesis<T(U)> {
 #define ONLY_INTERNAL(RETURN_TYPE, NAME, ARGUMENTS, CALLER_ARGS)               \
   typename erase_parenthesis<void RETURN_TYPE>::type NAME ARGUMENTS {          \
     if (auto *node_ptr = std::get_if<InternalNode_ *>(&m_node)) {              \
-      return node_ptr->NAME CALLER_ARGS;                                       \
+      return (*node_ptr)->NAME CALLER_ARGS;                                    \
     }                                                                          \
     throw std::runtime_error("Cant " #NAME " in non inner node");              \
   }
@@ -25,88 +26,95 @@ template <typename T, typename U> struct erase_parenthesis<T(U)> {
 #define ONLY_LEAF(RETURN_TYPE, NAME, ARGUMENTS, CALLER_ARGS)                   \
   typename erase_parenthesis<void RETURN_TYPE>::type NAME ARGUMENTS {          \
     if (auto *node_ptr = std::get_if<LeafNode_ *>(&m_node)) {                  \
-      return node_ptr->NAME CALLER_ARGS;                                       \
+      return (*node_ptr)->NAME CALLER_ARGS;                                    \
     }                                                                          \
-    throw std::runtime_error("Cant " #NAME " in non inner node");              \
+    throw std::runtime_error("Cant " #NAME " in non leaf node");               \
   }
 
 /**
  * @class NodeHandler
  * @brief Base Node structure for B+ tree.
- * @details The Node structure consists of an array of keys and a flag for
- * whether the node is a leaf. It is the base class for both @ref LeafNode
- * "LeafNode" and @ref InternalNode "InternalNode".
+ * @details The NodeHandler refers to either a @ref LeafNode "LeafNode" or an
+ * @ref InternalNode "InternalNode" and a flag for whether the node is a leaf.
  */
 template <BPLUS_TEMPLATES, size_t MAX_CHILDS, size_t MAX_KEYS>
 class NodeHandler {
 
   friend class BPlusTree<BPLUS_TEMPLATE_PARAMS>;
 
-  using value_type = T;
+  using value_type = std::pair<const Key, T>;
 
   using LeafNode_ = LeafNode<NODE_TEMPLATE_PARAMS>;
   using InternalNode_ = InternalNode<NODE_TEMPLATE_PARAMS>;
 
-  using iterator = BPlusTreeIterator<BPLUS_TEMPLATE_PARAMS, false>;
-  using const_iterator = BPlusTreeIterator<BPLUS_TEMPLATE_PARAMS, true>;
-
+public:
+  NodeHandler() = default;
   NodeHandler(LeafNode_ *leaf_node) : m_node(leaf_node), m_isLeaf(true) {}
   NodeHandler(InternalNode_ *internal_node)
       : m_node(internal_node), m_isLeaf(false) {}
   NodeHandler(std::nullptr_t) : m_node(nullptr), m_isLeaf(false) {}
 
-  NodeHandler &operator=(const LeafNode_ *&leaf_node) {
+  NodeHandler &operator=(LeafNode_ *leaf_node) {
     m_node = leaf_node;
     m_isLeaf = true;
+    return *this;
   }
-  NodeHandler &operator=(const InternalNode_ *&internal_node) {
+  NodeHandler &operator=(InternalNode_ *internal_node) {
     m_node = internal_node;
     m_isLeaf = false;
+    return *this;
   }
   NodeHandler &operator=(std::nullptr_t) {
     m_node = nullptr;
     m_isLeaf = false;
+    return *this;
   }
 
-  // spaceship
-  [[nodiscard]] constexpr auto operator<=>(const NodeHandler &) const = default;
+  [[nodiscard]] bool operator==(const NodeHandler &) const = default;
 
+private:
   ONLY_LEAF((std::array<value_type *, MAX_KEYS> &), values, (), ())
   ONLY_INTERNAL((std::array<Key, MAX_KEYS> &), keys, (), ())
 
-  std::array<NodeHandler *, MAX_CHILDS> &childs() {
-    if (auto *node_ptr = std::get_if<InternalNode_ *>(&m_node)) {
-      return node_ptr->m_childs;
+  [[nodiscard]] LeafNode_ *leaf() const {
+    if (const auto *node_ptr = std::get_if<LeafNode_ *>(&m_node)) {
+      return *node_ptr;
     }
-    throw std::runtime_error("Cant get childs from non internal node");
+    throw std::runtime_error("Cant get leaf from non leaf node");
   }
 
-  LeafNode_ *&next() {
-    if (auto *node_ptr = std::get_if<LeafNode_ *>(&m_node)) {
-      return node_ptr->m_next;
+  [[nodiscard]] InternalNode_ *internal() const {
+    if (const auto *node_ptr = std::get_if<InternalNode_ *>(&m_node)) {
+      return *node_ptr;
     }
-    throw std::runtime_error("Cant get next from non leaf node");
+    throw std::runtime_error("Cant get internal from non internal node");
   }
-  LeafNode_ *&prev() {
-    if (auto *node_ptr = std::get_if<LeafNode_ *>(&m_node)) {
-      return node_ptr->m_prev;
-    }
-    throw std::runtime_error("Cant get prev from non leaf node");
+
+  /// @brief Address of the referenced node, nullptr if there is none
+  [[nodiscard]] const void *address() const noexcept {
+    return std::visit(
+        [](auto node_ptr) { return static_cast<const void *>(node_ptr); },
+        m_node);
   }
-  std::pair<iterator, InsertResult> insert(const value_type &value) {
-    if (auto *node_ptr = std::get_if<LeafNode_ *>(&m_node)) {
-      return (*node_ptr)->insert(value);
-    }
-    throw std::runtime_error("Cant insert in non leaf node");
+
+  [[nodiscard]] size_t keyCount() const {
+    return m_isLeaf ? leaf()->m_count : internal()->m_count;
+  }
+
+  std::array<NodeHandler, MAX_CHILDS> &childs() {
+    return internal()->m_children;
   }
 
-  std::variant<std::nullptr_t, LeafNode_ *, InternalNode_ *> m_node;
+  LeafNode_ *&next() { return leaf()->m_next; }
+  LeafNode_ *&prev() { return leaf()->m_prev; }
+
+  std::variant<std::nullptr_t, LeafNode_ *, InternalNode_ *> m_node = nullptr;
   /**
    * @brief Boolean flag to know whether the node is a leaf.
    * Used to maintain:
    * https://en.wikipedia.org/wiki/Liskov_substitution_principle
    */
-  bool m_isLeaf;
+  bool m_isLeaf = false;
 };
 
 #endif // !NODE_HANDLER_HPP
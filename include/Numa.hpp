@@ -0,0 +1,301 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#if defined(BPLUS_HAVE_LIBNUMA)
+#include <numa.h>
+#include <numaif.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+/// @defgroup Numa NUMA placement
+/// @name Numa
+/// @brief Node local allocation and per node replicas of the upper levels
+/// @details
+/// NumaAllocator places the nodes and values of a tree on one NUMA node.
+/// NumaReplicas gives the readers of every NUMA node a snapshot whose
+/// internal nodes live on their node, while the leaves stay shared.
+///
+/// With BPLUS_HAVE_LIBNUMA, which the build defines when it finds libnuma,
+/// allocations of a page or more are bound with numa_alloc_onnode, and the
+/// smaller ones follow the first touch policy of the kernel. Without it, or
+/// once numa::emulate is called, nodes are emulated: every block records the
+/// node it was requested on, which makes the placement testable on any
+/// machine.
+/// @{
+
+namespace numa {
+
+namespace detail {
+inline std::atomic<std::size_t> emulated_nodes{0};
+inline thread_local std::size_t thread_node = 0;
+
+/// @brief Header of the emulated blocks, keeps the payload aligned
+struct alignas(std::max_align_t) Header {
+  std::size_t node;
+};
+
+inline bool emulated() noexcept {
+#if defined(BPLUS_HAVE_LIBNUMA)
+  return emulated_nodes.load(std::memory_order_relaxed) > 0 ||
+         numa_available() < 0;
+#else
+  return true;
+#endif
+}
+
+#if defined(BPLUS_HAVE_LIBNUMA)
+inline std::size_t page_size() noexcept {
+  static const auto size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+#endif
+} // namespace detail
+
+/// @brief Emulates nodes NUMA nodes, 0 goes back to the real ones
+/// @details Only blocks allocated while emulating may be freed while
+/// emulating, so switch before building any tree.
+inline void emulate(std::size_t nodes) noexcept {
+  detail::emulated_nodes.store(nodes, std::memory_order_relaxed);
+}
+
+/// @brief Number of NUMA nodes, at least 1
+inline std::size_t node_count() noexcept {
+  const auto emulated = detail::emulated_nodes.load(std::memory_order_relaxed);
+  if (emulated > 0) {
+    return emulated;
+  }
+#if defined(BPLUS_HAVE_LIBNUMA)
+  if (numa_available() >= 0) {
+    return static_cast<std::size_t>(numa_num_configured_nodes());
+  }
+#endif
+  return 1;
+}
+
+/// @brief Sets the emulated node of the calling thread
+inline void set_thread_node(std::size_t node) noexcept {
+  detail::thread_node = node;
+}
+
+/// @brief NUMA node of the cpu running the calling thread
+inline std::size_t current_node() noexcept {
+  if (detail::emulated_nodes.load(std::memory_order_relaxed) > 0) {
+    return detail::thread_node % node_count();
+  }
+#if defined(BPLUS_HAVE_LIBNUMA)
+  if (numa_available() >= 0) {
+    const auto cpu = sched_getcpu();
+    const auto node = cpu < 0 ? 0 : numa_node_of_cpu(cpu);
+    return node < 0 ? 0 : static_cast<std::size_t>(node);
+  }
+#endif
+  return 0;
+}
+
+/// @brief Allocates bytes on node
+inline void *allocate_on(std::size_t bytes, std::size_t node) {
+  if (detail::emulated()) {
+    auto *block = static_cast<detail::Header *>(
+        ::operator new(sizeof(detail::Header) + bytes));
+    block->node = node;
+    return block + 1;
+  }
+#if defined(BPLUS_HAVE_LIBNUMA)
+  if (bytes >= detail::page_size()) {
+    auto *pointer = numa_alloc_onnode(bytes, static_cast<int>(node));
+    if (pointer == nullptr) {
+      throw std::bad_alloc();
+    }
+    return pointer;
+  }
+#endif
+  return ::operator new(bytes);
+}
+
+/// @brief Frees a block of allocate_on, from any node
+inline void deallocate(void *pointer, std::size_t bytes) noexcept {
+  if (detail::emulated()) {
+    ::operator delete(static_cast<detail::Header *>(pointer) - 1);
+    return;
+  }
+#if defined(BPLUS_HAVE_LIBNUMA)
+  if (bytes >= detail::page_size()) {
+    numa_free(pointer, bytes);
+    return;
+  }
+#endif
+  ::operator delete(pointer, bytes);
+}
+
+/// @brief Node holding the block of allocate_on at pointer
+inline std::size_t node_of(const void *pointer) noexcept {
+  if (detail::emulated()) {
+    return (static_cast<const detail::Header *>(pointer) - 1)->node;
+  }
+#if defined(BPLUS_HAVE_LIBNUMA)
+  int node = 0;
+  if (get_mempolicy(&node, nullptr, 0, const_cast<void *>(pointer),
+                    MPOL_F_NODE | MPOL_F_ADDR) == 0) {
+    return static_cast<std::size_t>(node);
+  }
+#endif
+  return 0;
+}
+
+} // namespace numa
+
+/**
+ * @brief Allocator placing its memory on one NUMA node
+ * @details Defaults to the node of the constructing thread. Memory of any
+ * node may be freed by any instance, so instances compare equal and trees
+ * bound to different nodes can still split, join and share snapshots.
+ * */
+template <typename T> class NumaAllocator {
+public:
+  using value_type = T;
+
+  NumaAllocator() noexcept : m_node(numa::current_node()) {}
+  explicit NumaAllocator(std::size_t node) noexcept : m_node(node) {}
+  template <typename U>
+  NumaAllocator(const NumaAllocator<U> &other) noexcept
+      : m_node(other.node()) {}
+
+  T *allocate(std::size_t count) {
+    return static_cast<T *>(numa::allocate_on(count * sizeof(T), m_node));
+  }
+
+  void deallocate(T *pointer, std::size_t count) noexcept {
+    numa::deallocate(pointer, count * sizeof(T));
+  }
+
+  [[nodiscard]] std::size_t node() const noexcept { return m_node; }
+
+  template <typename U>
+  bool operator==(const NumaAllocator<U> & /*other*/) const noexcept {
+    return true;
+  }
+
+private:
+  std::size_t m_node;
+};
+
+/**
+ * @brief Per NUMA node read only versions of a tree, following its writes
+ * @details Each replica is a snapshot of the tree made by
+ * BPlusTree::replica, whose internal nodes were copied on its NUMA node with
+ * an allocator_type built from the node number, e.g. NumaAllocator. The
+ * leaves are shared with the tree and the other replicas. Readers take the
+ * replica of their node with local() and read it like any snapshot.
+ *
+ * Every insertion and erasure publishes new replicas, which copy only the
+ * internal nodes along the path to the leaf written, after the write copied
+ * that leaf and its values. The other writes, like clear() or split(),
+ * compare all the internal levels of the tree to those of each replica.
+ * Values written in place through the iterators of the tree reach the
+ * replicas at once, and must not race with their readers. The tree must
+ * outlive the replicas and stay at the same address.
+ * */
+template <typename Tree> class NumaReplicas {
+public:
+  using snapshot_type = typename Tree::Snapshot;
+  using allocator_type = typename Tree::allocator_type;
+
+  /// @brief Replicates tree on every node
+  explicit NumaReplicas(Tree &tree) : m_tree(&tree) {
+    const auto nodes = numa::node_count();
+    m_slots.reserve(nodes);
+    for (std::size_t node = 0; node < nodes; ++node) {
+      m_slots.push_back(std::make_unique<Slot>());
+    }
+    refresh();
+    m_tree->on_write(
+        [this](const typename Tree::key_type *key) { update(key); });
+  }
+
+  ~NumaReplicas() { m_tree->on_write(nullptr); }
+
+  NumaReplicas(const NumaReplicas &) = delete;
+  NumaReplicas &operator=(const NumaReplicas &) = delete;
+
+  /// @brief Publishes the current version of the tree to every node
+  /// @details O(n / M) comparisons per node. The writes already do so, this
+  /// retries the replicas a write failed to copy.
+  void refresh() {
+    if (auto failure = update(nullptr)) {
+      std::rethrow_exception(failure);
+    }
+  }
+
+  /// @brief Replica of node
+  [[nodiscard]] snapshot_type on(std::size_t node) const {
+    auto &slot = *m_slots[node % m_slots.size()];
+    const std::lock_guard lock(slot.mutex);
+    return slot.replica;
+  }
+
+  /// @brief Replica of the node the calling thread runs on
+  [[nodiscard]] snapshot_type local() const {
+    return on(numa::current_node());
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return m_slots.size(); }
+
+private:
+  /// @brief Replica of one node, behind its own lock so that the readers of
+  /// different nodes never share a cache line
+  struct alignas(64) Slot {
+    std::mutex mutex;
+    snapshot_type replica;
+    /// Whether a write did not reach the replica, only the writer reads it
+    bool stale = false;
+  };
+
+  /// @brief Publishes the write of the leaf of key, or of any leaf
+  /// @details Runs on the writing thread. A replica that can not be copied
+  /// keeps the previous version, and the next update compares all its
+  /// levels.
+  /// @return The last failure, which the writes ignore
+  std::exception_ptr update(const typename Tree::key_type *key) noexcept {
+    std::exception_ptr failure;
+    for (std::size_t node = 0; node < m_slots.size(); ++node) {
+      auto &slot = *m_slots[node];
+      try {
+        auto replica = m_tree->replica(allocator_for(node), on(node),
+                                       slot.stale ? nullptr : key);
+        const std::lock_guard lock(slot.mutex);
+        slot.replica = std::move(replica);
+        slot.stale = false;
+      } catch (...) {
+        slot.stale = true;
+        failure = std::current_exception();
+      }
+    }
+    return failure;
+  }
+
+  allocator_type allocator_for(std::size_t node) const {
+    if constexpr (std::is_constructible_v<allocator_type, std::size_t>) {
+      return allocator_type(node);
+    } else {
+      return m_tree->get_allocator();
+    }
+  }
+
+  Tree *m_tree;
+  std::vector<std::unique_ptr<Slot>> m_slots;
+};
+
+/// @}
+
+#endif // !NUMA_HPP
@@ -0,0 +1,62 @@
+#ifndef POINT_INDEX_HPP
+#define POINT_INDEX_HPP
+
+#include <concepts>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+/// @defgroup PointIndex Point index policies
+/// @name PointIndex
+/// @brief Hash index of the keys next to the tree
+/// @details
+/// Values are allocated one by one and never move while they are in the
+/// tree, so a hash map from each key to its value stays valid through every
+/// split, merge and rebalance. The tree updates it on insertion and erasure,
+/// and rebuilds it when it builds or clones whole trees. contains, count,
+/// and misses of find answer from it in O(1), ordered operations ignore it.
+/// The policy is chosen through Traits::point_index.
+/// @{
+
+/**
+ * @brief Default policy: no index
+ * */
+struct NoPointIndex {
+  static constexpr bool enabled = false;
+
+  struct map_base {};
+
+  template <typename Key, typename Value, typename Allocator>
+  using map_type = map_base;
+};
+
+/**
+ * @brief Index kept in a std::unordered_map
+ * @details KeyEqual must consider equal exactly the keys that the comparator
+ * of the tree considers equivalent. The nodes of the map come from the
+ * allocator of the tree. Heterogeneous lookups use the index when Hash
+ * declares is_transparent, and descend the tree otherwise.
+ * */
+template <typename Hash, typename KeyEqual = std::equal_to<>>
+struct HashPointIndex {
+  static constexpr bool enabled = true;
+
+  template <typename Key, typename Value, typename Allocator>
+  using map_type = std::unordered_map<
+      Key, Value *, Hash, KeyEqual,
+      typename std::allocator_traits<Allocator>::template rebind_alloc<
+          std::pair<const Key, Value *>>>;
+};
+
+/**
+ * @brief Concept for a point index policy
+ * */
+template <typename P>
+concept PointIndex = requires {
+  { P::enabled } -> std::convertible_to<bool>;
+};
+
+/// @}
+
+#endif // !POINT_INDEX_HPP
@@ -0,0 +1,21 @@
+#ifndef UTILS_PREFETCH_HPP
+#define UTILS_PREFETCH_HPP
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <xmmintrin.h>
+#endif
+
+namespace utils {
+/// @brief Hints the cpu to pull the cache line holding address
+inline void prefetch(const void *address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address);
+#elif defined(_MSC_VER)
+  _mm_prefetch(static_cast<const char *>(address), _MM_HINT_T0);
+#else
+  static_cast<void>(address);
+#endif
+}
+} // namespace utils
+
+#endif // !UTILS_PREFETCH_HPP
@@ -0,0 +1,65 @@
+#ifndef RELOCATE_HPP
+#define RELOCATE_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+/// @defgroup Relocation Slot relocation
+/// @name Relocation
+/// @brief Moves of node slots, specialized for trivially copyable types
+/// @details Node operations shift and split arrays of keys, value pointers
+/// and children. For trivially copyable slots, which includes every pointer
+/// and the keys of integer trees, a relocation is a single memmove. The
+/// common standard libraries already lower std::move of such ranges to one,
+/// relocate() only makes it explicit. Copies of whole trees copy their values
+/// as bytes in the same case, see BPlusTree::copy_value.
+/// @{
+
+/// @brief Whether slots of T can be relocated by copying their bytes
+template <typename T>
+concept TriviallyRelocatable = std::is_trivially_copyable_v<T>;
+
+/// @brief Moves [first, last) into the range starting at d_first
+/// @details Like std::move, the ranges may overlap if d_first is before
+/// first.
+template <std::contiguous_iterator It, std::contiguous_iterator Out>
+Out relocate(It first, It last, Out d_first) {
+  using value_type = std::iter_value_t<It>;
+  if constexpr (TriviallyRelocatable<value_type> &&
+                std::is_same_v<value_type, std::iter_value_t<Out>>) {
+    const auto count = last - first;
+    if (count > 0) {
+      std::memmove(std::to_address(d_first), std::to_address(first),
+                   static_cast<size_t>(count) * sizeof(value_type));
+    }
+    return d_first + count;
+  } else {
+    return std::move(first, last, d_first);
+  }
+}
+
+/// @brief Moves [first, last) into the range ending at d_last
+/// @details Like std::move_backward, the ranges may overlap if d_last is
+/// after last.
+template <std::contiguous_iterator It, std::contiguous_iterator Out>
+Out relocate_backward(It first, It last, Out d_last) {
+  using value_type = std::iter_value_t<It>;
+  if constexpr (TriviallyRelocatable<value_type> &&
+                std::is_same_v<value_type, std::iter_value_t<Out>>) {
+    const auto count = last - first;
+    if (count > 0) {
+      std::memmove(std::to_address(d_last - count), std::to_address(first),
+                   static_cast<size_t>(count) * sizeof(value_type));
+    }
+    return d_last - count;
+  } else {
+    return std::move_backward(first, last, d_last);
+  }
+}
+
+/// @}
+
+#endif // !RELOCATE_HPP
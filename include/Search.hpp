@@ -0,0 +1,190 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <type_traits>
+
+/// @defgroup Search In-node search policies
+/// @name Search
+/// @brief How leaves and internal nodes find a position among their keys
+/// @details
+/// Every search in a node looks for a partition point: the number of
+/// leading keys for which a predicate holds, e.g. the keys less than the one
+/// looked up. Policies get the predicate below(i), and may also read the key
+/// at index i and the key looked up. The policy is chosen through
+/// Traits::node_search. The linear scan is the fastest for the small default
+/// orders, the others pay off for page sized nodes with M in the hundreds.
+/// @{
+
+/**
+ * @brief Scans the keys in order and stops at the first one not below
+ * @details Default policy, its early exit is well predicted for small nodes.
+ * */
+struct LinearSearch {
+  template <typename Below, typename KeyAt, typename K>
+  static std::size_t partition_point(std::size_t count, Below &&below,
+                                     KeyAt && /*key_at*/, const K & /*key*/) {
+    std::size_t index = 0;
+    while (index < count && below(index)) {
+      ++index;
+    }
+    return index;
+  }
+
+  /// @brief Comparisons made by a search returning index
+  static constexpr std::size_t comparisons(std::size_t index,
+                                           std::size_t count) noexcept {
+    return index < count ? index + 1 : count;
+  }
+};
+
+/**
+ * @brief Binary search whose only branch is the loop itself
+ * @details The range halves on every step whatever the outcome of the
+ * comparison, which selects the next base with a conditional move instead of
+ * a mispredicted jump. ceil(log2(count)) + 1 comparisons.
+ * */
+struct BranchlessSearch {
+  template <typename Below, typename KeyAt, typename K>
+  static std::size_t partition_point(std::size_t count, Below &&below,
+                                     KeyAt && /*key_at*/, const K & /*key*/) {
+    if (count == 0) {
+      return 0;
+    }
+    std::size_t base = 0;
+    while (count > 1) {
+      const auto half = count / 2;
+      base = below(base + half) ? base + half : base;
+      count -= half;
+    }
+    return base + static_cast<std::size_t>(below(base));
+  }
+
+  static constexpr std::size_t comparisons(std::size_t /*index*/,
+                                           std::size_t count) noexcept {
+    return count == 0
+               ? 0
+               : static_cast<std::size_t>(std::bit_width(count - 1)) + 1;
+  }
+};
+
+/**
+ * @brief Counts the keys below over the whole node, without any branch
+ * @details The loop has no data dependent exit, so compilers vectorize it
+ * for arithmetic keys of internal nodes. Leaves store pointers to their
+ * values, and this reads every one of them.
+ * */
+struct CountingSearch {
+  template <typename Below, typename KeyAt, typename K>
+  static std::size_t partition_point(std::size_t count, Below &&below,
+                                     KeyAt && /*key_at*/, const K & /*key*/) {
+    std::size_t index = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      index += static_cast<std::size_t>(below(i));
+    }
+    return index;
+  }
+
+  static constexpr std::size_t comparisons(std::size_t /*index*/,
+                                           std::size_t count) noexcept {
+    return count;
+  }
+};
+
+/**
+ * @brief Predicts the position from the keys, then searches around it
+ * @details For arithmetic keys, the node is modeled as a line through its
+ * first and last keys, which needs no storage and is always in sync with the
+ * node whatever splits, merges or bulk builds did to it. The search gallops
+ * from the predicted position in doubling steps and ends with a
+ * BranchlessSearch over the bracketed range, so dense and near uniform keys,
+ * like sequential ids or timestamps, cost a handful of comparisons even in
+ * page sized nodes. Other keys fall back to BranchlessSearch.
+ * */
+struct InterpolationSearch {
+  template <typename Below, typename KeyAt, typename K>
+  static std::size_t partition_point(std::size_t count, Below &&below,
+                                     KeyAt &&key_at, const K &key) {
+    using stored_type = std::remove_cvref_t<decltype(key_at(0))>;
+    if constexpr (std::is_arithmetic_v<stored_type> &&
+                  std::is_arithmetic_v<K>) {
+      if (count == 0) {
+        return 0;
+      }
+      const auto guess = predict(count, key_at(0), key_at(count - 1), key);
+      // Bracket the partition point in [low, high]
+      std::size_t low = 0;
+      std::size_t high = count;
+      std::size_t step = 1;
+      if (below(guess)) {
+        low = guess + 1;
+        while (low + step - 1 < count && below(low + step - 1)) {
+          low += step;
+          step *= 2;
+        }
+        high = std::min(low + step - 1, count);
+      } else {
+        high = guess;
+        while (high >= step && !below(high - step)) {
+          high -= step;
+          step *= 2;
+        }
+        low = high >= step ? high - step + 1 : 0;
+      }
+      return low + BranchlessSearch::partition_point(
+                       high - low,
+                       [&](std::size_t index) { return below(low + index); },
+                       key_at, key);
+    } else {
+      return BranchlessSearch::partition_point(count, below, key_at, key);
+    }
+  }
+
+  /// @brief Comparisons of a search whose prediction is as far off as can be
+  static constexpr std::size_t comparisons(std::size_t /*index*/,
+                                           std::size_t count) noexcept {
+    return count == 0
+               ? 0
+               : 2 * static_cast<std::size_t>(std::bit_width(count)) + 1;
+  }
+
+private:
+  /// @brief Index of key on the line through (0, first) and (count - 1, last)
+  template <typename Stored, typename K>
+  static std::size_t predict(std::size_t count, Stored first, Stored last,
+                             K key) {
+    const auto span = static_cast<double>(last) - static_cast<double>(first);
+    if (!(span != 0)) {
+      return 0;
+    }
+    const auto fraction =
+        (static_cast<double>(key) - static_cast<double>(first)) / span;
+    if (!(fraction > 0)) {
+      return 0;
+    }
+    if (fraction >= 1) {
+      return count - 1;
+    }
+    return static_cast<std::size_t>(fraction *
+                                    static_cast<double>(count - 1));
+  }
+};
+
+/**
+ * @brief Concept for an in-node search policy
+ * */
+template <typename S>
+concept NodeSearch = requires(std::size_t count, bool (*below)(std::size_t),
+                              long (*key_at)(std::size_t), long key) {
+  {
+    S::partition_point(count, below, key_at, key)
+  } -> std::same_as<std::size_t>;
+  { S::comparisons(count, count) } -> std::same_as<std::size_t>;
+};
+
+/// @}
+
+#endif // !SEARCH_HPP
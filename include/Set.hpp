@@ -7,68 +7,87 @@ template <typename Key, typename value_type> struct SetIndexor {
   const Key &operator()(const value_type &pair) { return pair.first; }
 };
 
-[[maybe_unused]] static void foo() {
+template <size_t M, properKeyValue Key,
+          std::predicate<Key, Key> Compare = std::less<Key>,
+          IsAllocator Allocator = std::allocator<Key>,
+          TreeTraits<std::pair<const Key, Key>> Traits = DefaultTraits>
 
-  SetIndexor<int, std::pair<int, int>> indexor;
+struct Set
+    : public BPlusTree<M, Key, Key, SetIndexor<Key, std::pair<const Key, Key>>,
+                       Compare, Allocator, Traits> {
 
-  int val = indexor(std::pair<int, int>(1, 2));
+  using indexor = SetIndexor<Key, std::pair<const Key, Key>>;
+  using tree = BPlusTree<M, Key, Key, indexor, Compare, Allocator, Traits>;
 
-  std::cout << val << std::endl;
-}
+  // operator= is not inherited by default
+  using tree::operator=;
 
-template <size_t M, properKeyValue Key,
-          std::predicate<Key, Key> Compare = std::less<Key>,
-          IsAllocator Allocator = std::allocator<Key>>
+  using tree::insert;
 
-struct Set : public BPlusTree<M, Key, Key, SetIndexor<Key, std::pair<Key, Key>>,
-                              Compare, Allocator> {
+  [[nodiscard]] static constexpr bool is_map() noexcept { return false; }
 
-  using indexor = SetIndexor<Key, Key>;
+  /// @brief Inserts key into the set
+  std::pair<typename tree::iterator, bool> insert(const Key &key) {
+    return tree::try_emplace(key, key);
+  }
 
-  // operator= is not inherited by default
-  using BPlusTree<M, Key, Key, indexor, Compare, Allocator>::operator=;
+  /// @brief Keys present in either set, values of *this win on ties
+  [[nodiscard]] Set merge_union(const Set &other) const {
+    Set result(this->key_comp(), this->get_allocator());
+    result.assign_union(*this, other);
+    return result;
+  }
+
+  /// @brief Keys present in both sets
+  [[nodiscard]] Set intersect(const Set &other) const {
+    Set result(this->key_comp(), this->get_allocator());
+    result.assign_intersection(*this, other);
+    return result;
+  }
+
+  /// @brief Keys of *this that are not present in other
+  [[nodiscard]] Set difference(const Set &other) const {
+    Set result(this->key_comp(), this->get_allocator());
+    result.assign_difference(*this, other);
+    return result;
+  }
 
   // Forwarding all constructors
 
   Set() : Set(Compare()) {}
 
   explicit Set(const Compare &comp, const Allocator &alloc = Allocator())
-      : BPlusTree<M, Key, Key, indexor, Compare, Allocator>(comp, alloc) {}
+      : tree(comp, alloc) {}
 
-  explicit Set(const Allocator &alloc)
-      : BPlusTree<M, Key, Key, indexor, Compare, Allocator>(alloc) {}
+  explicit Set(const Allocator &alloc) : tree(alloc) {}
 
   template <ValueInputIterator<Key> InputIt>
   Set(InputIt first, InputIt last, const Compare &comp,
       const Allocator &alloc = Allocator())
-      : BPlusTree<M, Key, Key, indexor, Compare, Allocator>(first, last, comp,
-                                                            alloc) {}
+      : tree(first, last, comp, alloc) {}
 
   template <ValueInputIterator<Key> InputIt>
   Set(InputIt first, InputIt last, const Allocator &alloc = Allocator())
-      : BPlusTree<M, Key, Key, indexor, Compare, Allocator>(first, last,
-                                                            alloc) {}
+      : tree(first, last, alloc) {}
 
-  Set(const Set &other)
-      : BPlusTree<M, Key, Key, indexor, Compare, Allocator>(other) {}
+  Set(const Set &other) : tree(other) {}
 
-  Set(const Set &other, const Allocator &alloc)
-      : BPlusTree<M, Key, Key, indexor, Compare, Allocator>(other, alloc) {}
+  Set(const Set &other, const Allocator &alloc) : tree(other, alloc) {}
 
-  Set(Set &&other) noexcept
-      : BPlusTree<M, Key, Key, indexor, Compare, Allocator>(std::move(other)) {}
+  Set(Set &&other) noexcept : tree(std::move(other)) {}
 
-  Set(Set &&other, const Allocator &alloc)
-      : BPlusTree<M, Key, Key, indexor, Compare, Allocator>(std::move(other),
-                                                            alloc) {}
+  Set(Set &&other, const Allocator &alloc) : tree(std::move(other), alloc) {}
+
+  Set &operator=(const Set &other) = default;
+
+  Set &operator=(Set &&other) = default;
 
   Set(std::initializer_list<Key> init, const Compare &comp,
       const Allocator &alloc = Allocator())
-      : BPlusTree<M, Key, Key, indexor, Compare, Allocator>(init, comp, alloc) {
-  }
+      : tree(init, comp, alloc) {}
 
   Set(std::initializer_list<Key> init, const Allocator &alloc)
-      : BPlusTree<M, Key, Key, indexor, Compare, Allocator>(init, alloc) {}
+      : tree(init, alloc) {}
 };
 
 #endif // !SET_HPP
@@ -0,0 +1,101 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @struct OperationCounters
+ * @brief Events counted by a BPlusTree whose Traits::collect_stats is true
+ * @details Counted since construction or the last reset_stats(). With
+ * collect_stats false the tree does not store them and every counter of its
+ * @ref TreeStats snapshot stays 0.
+ * */
+struct OperationCounters {
+  std::size_t leaf_splits = 0;     ///< Leaves split by insertions or joins
+  std::size_t internal_splits = 0; ///< Internal nodes split
+  std::size_t leaf_merges = 0;     ///< Leaves merged into their left sibling
+  std::size_t internal_merges = 0; ///< Internal nodes merged
+  std::size_t rebalances = 0;      ///< Siblings evened out instead of merged
+  std::size_t descents = 0;        ///< Root to leaf walks of every operation
+  std::size_t lookups = 0;         ///< lower_bound/upper_bound based lookups
+  std::size_t lookup_comparisons = 0; ///< Key comparisons made by lookups
+  std::size_t fingerprint_rejections = 0; ///< Misses that compared no key
+  std::size_t hint_hits = 0;   ///< Hinted insertions that used the hint
+  std::size_t hint_misses = 0; ///< Hinted insertions that had to descend
+};
+
+/// @brief Placeholder stored instead of the counters when they are disabled
+struct NoOperationCounters {};
+
+/**
+ * @struct TreeStats
+ * @brief Snapshot returned by BPlusTree::stats()
+ * @details The structural figures are computed by walking the tree when the
+ * snapshot is taken, the event counters come from @ref OperationCounters.
+ * */
+struct TreeStats : OperationCounters {
+  /// @brief Number of buckets of the leaf fill histogram
+  static constexpr std::size_t fill_buckets = 10;
+
+  std::size_t size = 0;   ///< Number of values
+  std::size_t height = 0; ///< Number of levels, 0 for an empty tree
+  std::vector<std::size_t> nodes_per_level; ///< Index 0 is the root level
+
+  /// @brief Leaves per fill factor bucket, bucket i holds the leaves filled
+  /// in [i / fill_buckets, (i + 1) / fill_buckets), full leaves go last
+  std::array<std::size_t, fill_buckets> leaf_fill{};
+
+  std::size_t leaf_bytes = 0;     ///< Bytes allocated for leaves
+  std::size_t internal_bytes = 0; ///< Bytes allocated for internal nodes
+  std::size_t value_bytes = 0;    ///< Bytes allocated for the values
+
+  [[nodiscard]] double comparisons_per_lookup() const noexcept {
+    return lookups == 0 ? 0.0
+                        : static_cast<double>(lookup_comparisons) /
+                              static_cast<double>(lookups);
+  }
+
+  [[nodiscard]] double hint_hit_rate() const noexcept {
+    const auto hints = hint_hits + hint_misses;
+    return hints == 0 ? 0.0
+                      : static_cast<double>(hint_hits) /
+                            static_cast<double>(hints);
+  }
+
+  [[nodiscard]] std::size_t total_bytes() const noexcept {
+    return leaf_bytes + internal_bytes + value_bytes;
+  }
+};
+
+/**
+ * @struct CompactionStats
+ * @brief Work done by BPlusTree::compact
+ * */
+struct CompactionStats {
+  std::size_t leaves_visited = 0;  ///< Leaves packed or skipped as full
+  std::size_t leaves_freed = 0;    ///< Leaves emptied into their siblings
+  std::size_t internals_freed = 0; ///< Internal nodes merged or dropped
+  std::size_t bytes_reclaimed = 0; ///< Bytes of the freed nodes
+};
+
+/**
+ * @struct MemoryUsage
+ * @brief Bytes held by a tree, returned by BPlusTree::memory_usage()
+ * @details slack_bytes is the part of leaf_bytes and internal_bytes taken by
+ * unused value pointers, keys and children. Nodes shared with snapshots are
+ * counted by every tree and snapshot reaching them.
+ * */
+struct MemoryUsage {
+  std::size_t leaf_bytes = 0;     ///< Bytes allocated for leaves
+  std::size_t internal_bytes = 0; ///< Bytes allocated for internal nodes
+  std::size_t value_bytes = 0;    ///< Bytes allocated for the values
+  std::size_t slack_bytes = 0;    ///< Bytes of the unused node slots
+
+  [[nodiscard]] std::size_t total_bytes() const noexcept {
+    return leaf_bytes + internal_bytes + value_bytes;
+  }
+};
+
+#endif // !STATS_HPP
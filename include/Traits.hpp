@@ -0,0 +1,56 @@
+#ifndef TRAITS_HPP
+#define TRAITS_HPP
+
+#include "Augmentation.hpp"
+#include "Fingerprint.hpp"
+#include "PointIndex.hpp"
+#include "Search.hpp"
+
+#include <cstddef>
+
+/**
+ * @struct DefaultTraits
+ * @brief Compile time configuration of a BPlusTree
+ * @details
+ * Custom traits should derive from DefaultTraits and only override the
+ * members they need, e.g.
+ * @code
+ * struct CountedTraits : DefaultTraits {
+ *   using augmentation = SubtreeSize;
+ * };
+ * @endcode
+ * */
+struct DefaultTraits {
+  /// @brief Per-child aggregate cached in internal nodes, see @ref Augmentation
+  using augmentation = NoAugmentation;
+
+  /// @brief Number of descents interleaved by the batched lookups
+  static constexpr size_t batch_width = 16;
+
+  /// @brief How nodes search their keys, see @ref Search
+  using node_search = LinearSearch;
+
+  /// @brief Filter of the leaves for absent keys, see @ref Fingerprint
+  using leaf_fingerprint = NoFingerprint;
+
+  /// @brief Hash index of the keys for point lookups, see @ref PointIndex
+  using point_index = NoPointIndex;
+
+  /// @brief Lazy deletion threshold for leaves
+  /// @details 0 keeps every leaf at least half full. A positive value lets
+  /// erase leave leaves underfull and only rebalances a leaf once it holds
+  /// fewer values than the threshold, 1 only reclaims empty leaves.
+  static constexpr size_t lazy_delete_threshold = 0;
+
+  /// @brief Whether the tree counts the events reported by stats()
+  /// @details Disabled, the counters are neither stored nor updated.
+  static constexpr bool collect_stats = false;
+
+  /// @brief Minimum size of a tree whose copies are cloned in parallel
+  /// @details 0 disables it. Otherwise copies of trees with at least that
+  /// many values clone the subtrees of the root on separate threads, which
+  /// requires the allocator to be thread safe.
+  static constexpr size_t parallel_copy_threshold = 0;
+};
+
+#endif // !TRAITS_HPP
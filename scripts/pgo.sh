@@ -0,0 +1,30 @@
+#!/usr/bin/env sh
+# Profile guided optimization of the benchmarks:
+#   1. builds them instrumented (preset pgo-generate)
+#   2. runs them as the training workload
+#   3. rebuilds them with the collected profile (preset pgo-use)
+# Both phases share the build directory, GCC locates the profile of every
+# object file through its path. Extra arguments are forwarded to the
+# training run, e.g.
+#   scripts/pgo.sh --benchmark_filter='BPlusMap<16'
+set -eu
+
+cd "$(dirname "$0")/.."
+profile_dir=build/pgo-profile
+
+rm -rf "$profile_dir"
+# The training run is kept short, the sizes only change the workload
+cmake --preset pgo-generate -DBPLUS_BENCH_MAX_SIZE=1000000
+cmake --build --preset pgo-generate --target treeBenchmarks
+
+./build/pgo/benchmarks/treeBenchmarks --benchmark_min_time=0.05 "$@"
+
+# Clang writes raw profiles that have to be merged, GCC reads its own
+if ls "$profile_dir"/*.profraw >/dev/null 2>&1; then
+  llvm-profdata merge -o "$profile_dir/default.profdata" \
+    "$profile_dir"/*.profraw
+fi
+
+cmake --preset pgo-use
+cmake --build --preset pgo-use --target treeBenchmarks
+echo "Optimized benchmarks: build/pgo/benchmarks/treeBenchmarks"
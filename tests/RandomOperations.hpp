@@ -0,0 +1,55 @@
+#ifndef RANDOM_OPERATIONS_HPP
+#define RANDOM_OPERATIONS_HPP
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+
+/// @brief Key of a test tree built from value, ordered like the values
+template <typename Key> Key make_key(int value);
+template <> inline int make_key<int>(int value) { return value; }
+template <> inline std::string make_key<std::string>(int value) {
+  // Too long for the small string buffer, so the keys own heap memory
+  return std::string(20, 'k') + std::to_string(100000 + value);
+}
+
+/// @brief std::map holding what a test tree should hold
+template <typename Tree>
+using Expected = std::map<typename Tree::key_type,
+                          typename Tree::value_type::second_type,
+                          typename Tree::key_compare>;
+
+/// @brief Inserts and erases keys drawn from [0, range] in tree and expected
+/// @details One operation in three is an erase, the others insert the index
+/// of the operation. Asserts that both containers report the same results.
+template <typename Tree>
+void random_operations(Tree &tree, Expected<Tree> &expected, int operations,
+                       int range, unsigned seed) {
+  using key_type = typename Tree::key_type;
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<int> distribution(0, range);
+  for (int i = 0; i < operations; ++i) {
+    const auto key = make_key<key_type>(distribution(generator));
+    if (i % 3 == 2) {
+      ASSERT_EQ(tree.erase(key), expected.erase(key));
+    } else {
+      ASSERT_EQ(tree.insert({key, i}).second, expected.insert({key, i}).second);
+    }
+  }
+}
+
+/// @brief Validates tree and compares it with expected in both directions
+template <typename Tree, typename Map>
+void expect_same(const Tree &tree, const Map &expected) {
+  tree.validate();
+  ASSERT_EQ(tree.size(), expected.size());
+  ASSERT_TRUE(
+      std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+  ASSERT_TRUE(std::equal(tree.rbegin(), tree.rend(), expected.rbegin(),
+                         expected.rend()));
+}
+
+#endif // !RANDOM_OPERATIONS_HPP
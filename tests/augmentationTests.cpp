@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+struct CountedTraits : DefaultTraits {
+  using augmentation = SubtreeSize;
+};
+
+struct SummedTraits : DefaultTraits {
+  using augmentation = WithSize<MappedSum<long>>;
+};
+
+struct MinTraits : DefaultTraits {
+  using augmentation = MappedMin<int>;
+};
+
+template <size_t M, typename Traits>
+using AugmentedMap =
+    Map<M, int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+        Traits>;
+
+static std::vector<int> shuffled_keys(int count) {
+  std::vector<int> keys(static_cast<size_t>(count));
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+  return keys;
+}
+
+TEST(AugmentationTest, RankAndSelect) {
+  AugmentedMap<4, CountedTraits> tree;
+  for (auto key : shuffled_keys(2000)) {
+    tree.insert({key * 2, key});
+  }
+
+  ASSERT_EQ(tree.rank(-1), 0);
+  ASSERT_EQ(tree.rank(0), 0);
+  ASSERT_EQ(tree.rank(1), 1);
+  ASSERT_EQ(tree.rank(4000), 2000);
+
+  for (size_t index = 0; index < 2000; ++index) {
+    auto it = tree.select(index);
+    ASSERT_NE(it, tree.end());
+    ASSERT_EQ(it->first, static_cast<int>(index) * 2);
+    ASSERT_EQ(tree.rank(it->first), index);
+  }
+  ASSERT_EQ(tree.select(2000), tree.end());
+}
+
+TEST(AugmentationTest, RangeCount) {
+  AugmentedMap<3, CountedTraits> tree;
+  for (auto key : shuffled_keys(1000)) {
+    tree.insert({key, key});
+  }
+
+  ASSERT_EQ(tree.count(0, 1000), 1000);
+  ASSERT_EQ(tree.count(10, 20), 10);
+  ASSERT_EQ(tree.count(-50, 5), 5);
+  ASSERT_EQ(tree.count(995, 2000), 5);
+  ASSERT_EQ(tree.count(20, 10), 0);
+  ASSERT_EQ(tree.count(7), 1);
+}
+
+TEST(AugmentationTest, RangeSum) {
+  AugmentedMap<5, SummedTraits> tree;
+  for (auto key : shuffled_keys(1500)) {
+    tree.insert({key, key % 17});
+  }
+
+  for (int low = 0; low < 1500; low += 37) {
+    for (int high = low; high <= 1500; high += 91) {
+      long expected = 0;
+      for (int key = low; key < high; ++key) {
+        expected += key % 17;
+      }
+      auto aggregate = tree.range_aggregate(low, high);
+      ASSERT_EQ(aggregate.value, expected);
+      ASSERT_EQ(aggregate.size, static_cast<size_t>(high - low));
+    }
+  }
+  ASSERT_EQ(tree.select(700)->first, 700);
+}
+
+TEST(AugmentationTest, RangeMin) {
+  AugmentedMap<4, MinTraits> tree;
+  for (auto key : shuffled_keys(800)) {
+    tree.insert({key, 1000 - key});
+  }
+
+  ASSERT_EQ(tree.range_aggregate(0, 800), 201);
+  ASSERT_EQ(tree.range_aggregate(100, 200), 801);
+  ASSERT_EQ(tree.range_aggregate(5, 5), std::numeric_limits<int>::max());
+}
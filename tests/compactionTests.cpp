@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "RandomOperations.hpp"
+#include "Set.hpp"
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+struct LazyTraits : DefaultTraits {
+  static constexpr size_t lazy_delete_threshold = 1;
+};
+
+struct LazyCountedTraits : LazyTraits {
+  using augmentation = SubtreeSize;
+};
+
+struct LazyIndexedTraits : LazyTraits {
+  using point_index = HashPointIndex<std::hash<int>>;
+  using leaf_fingerprint = HashFingerprint<std::hash<int>>;
+};
+
+template <size_t M, typename Traits = LazyTraits, typename Key = int>
+using LazyMap = Map<M, Key, int, std::less<Key>,
+                    std::allocator<std::pair<const Key, int>>, Traits>;
+
+/// @brief Fills tree with 0..size and erases most keys at random
+template <typename Tree>
+static std::map<int, int> sparse(Tree &tree, int size, int keep_one_in) {
+  std::map<int, int> expected;
+  std::vector<int> keys;
+  for (int i = 0; i < size; ++i) {
+    tree.insert({i, i});
+    keys.push_back(i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(5));
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (i % keep_one_in == 0) {
+      expected.emplace(keys[i], keys[i]);
+    } else {
+      tree.erase(keys[i]);
+    }
+  }
+  return expected;
+}
+
+template <typename Tree> static size_t node_bytes(const Tree &tree) {
+  const auto stats = tree.stats();
+  return stats.leaf_bytes + stats.internal_bytes;
+}
+
+TEST(CompactionTest, PacksSparseLeaves) {
+  LazyMap<16> tree;
+  const auto expected = sparse(tree, 100000, 10);
+  tree.validate();
+  const auto before = tree.stats();
+
+  const auto bytes = node_bytes(tree);
+  const auto result = tree.compact();
+  expect_same(tree, expected);
+
+  const auto after = tree.stats();
+  ASSERT_EQ(result.bytes_reclaimed, bytes - node_bytes(tree));
+  ASSERT_EQ(result.leaves_freed,
+            before.nodes_per_level.back() - after.nodes_per_level.back());
+  ASSERT_LT(after.height, before.height);
+  // Leaves are only left partly filled around the ends of their parents
+  ASSERT_LT(after.nodes_per_level.back(), expected.size() / 15 * 12 / 10);
+  ASSERT_GT(after.leaf_fill.back(), after.nodes_per_level.back() * 6 / 10);
+
+  // Another pass only finds what the first one left around those ends
+  const auto again = tree.compact();
+  tree.validate();
+  ASSERT_LT(again.leaves_freed, result.leaves_freed / 20);
+}
+
+TEST(CompactionTest, SlicesInterleavedWithWrites) {
+  LazyMap<8> tree;
+  auto expected = sparse(tree, 20000, 4);
+
+  decltype(tree)::Compaction compaction;
+  size_t slices = 0;
+  while (!tree.compact(compaction, 5)) {
+    ++slices;
+    random_operations(tree, expected, 10, 30000,
+                      static_cast<unsigned>(slices));
+    tree.validate();
+  }
+  ASSERT_TRUE(compaction.done());
+  ASSERT_GT(slices, 100);
+  ASSERT_GT(compaction.stats().leaves_freed, 0);
+  ASSERT_LE(compaction.stats().leaves_visited, (slices + 1) * 5);
+  expect_same(tree, expected);
+
+  // A finished compaction stays finished
+  ASSERT_TRUE(tree.compact(compaction, 5));
+}
+
+TEST(CompactionTest, KeepsAggregatesIndexAndValues) {
+  LazyMap<6, LazyCountedTraits> counted;
+  sparse(counted, 30000, 7);
+  counted.compact();
+  counted.validate();
+  ASSERT_EQ(counted.select(100)->first, std::next(counted.begin(), 100)->first);
+
+  LazyMap<12, LazyIndexedTraits> indexed;
+  const auto expected = sparse(indexed, 30000, 7);
+  std::vector<const int *> mapped;
+  for (const auto &[key, value] : expected) {
+    mapped.push_back(&indexed.at(key));
+  }
+  indexed.compact();
+  // validate checks the fingerprints and the index
+  indexed.validate();
+  size_t i = 0;
+  for (const auto &[key, value] : expected) {
+    ASSERT_EQ(&indexed.at(key), mapped[i++]);
+  }
+}
+
+TEST(CompactionTest, SnapshotsKeepTheirLeaves) {
+  LazyMap<8, LazyTraits, std::string> tree;
+  for (int i = 0; i < 5000; ++i) {
+    tree.insert({std::to_string(i), i});
+  }
+  for (int i = 0; i < 5000; i += 3) {
+    tree.erase(std::to_string(i));
+  }
+  const auto snapshot = tree.snapshot();
+  const auto result = tree.compact();
+  tree.validate();
+  ASSERT_GT(result.leaves_freed, 0);
+  ASSERT_EQ(snapshot.size(), tree.size());
+  ASSERT_TRUE(std::equal(snapshot.begin(), snapshot.end(), tree.begin(),
+                         tree.end()));
+}
+
+TEST(CompactionTest, SmallTreesAndStrictFill) {
+  LazyMap<4> tree;
+  ASSERT_TRUE(tree.compact().leaves_visited == 0);
+  tree.insert({1, 1});
+  tree.compact();
+  tree.validate();
+
+  // Half full leaves of the default traits are packed as well
+  Set<32, int> set;
+  for (int i = 0; i < 20000; ++i) {
+    set.insert(i);
+  }
+  const auto leaves = set.stats().nodes_per_level.back();
+  const auto result = set.compact();
+  set.validate();
+  ASSERT_GT(result.leaves_freed, leaves / 4);
+  ASSERT_EQ(set.size(), 20000);
+}
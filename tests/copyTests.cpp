@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+/// @brief Allocator whose instances only compare equal with the same tag
+template <typename T> struct TaggedAllocator {
+  using value_type = T;
+
+  TaggedAllocator() = default;
+  explicit TaggedAllocator(int tag) : tag(tag) {}
+  template <typename U>
+  TaggedAllocator(const TaggedAllocator<U> &other) noexcept : tag(other.tag) {}
+
+  T *allocate(size_t count) { return std::allocator<T>{}.allocate(count); }
+  void deallocate(T *pointer, size_t count) noexcept {
+    std::allocator<T>{}.deallocate(pointer, count);
+  }
+
+  template <typename U>
+  bool operator==(const TaggedAllocator<U> &other) const noexcept {
+    return tag == other.tag;
+  }
+
+  int tag = 0;
+};
+
+/// @brief Value whose copies throw once the countdown reaches 0
+struct Fragile {
+  static inline int live = 0;
+  static inline int countdown = -1;
+
+  explicit Fragile(int value) : value(value) { ++live; }
+  Fragile(const Fragile &other) : value(other.value) {
+    if (countdown >= 0 && countdown-- == 0) {
+      throw std::runtime_error("copy failed");
+    }
+    ++live;
+  }
+  Fragile(Fragile &&other) noexcept : value(other.value) { ++live; }
+  Fragile &operator=(const Fragile &) = default;
+  ~Fragile() { --live; }
+
+  int value;
+};
+
+struct ParallelTraits : DefaultTraits {
+  static constexpr size_t parallel_copy_threshold = 1000;
+};
+
+struct ParallelCountedTraits : ParallelTraits {
+  using augmentation = SubtreeSize;
+};
+
+template <size_t M, typename Traits = DefaultTraits>
+using TraitsMap =
+    Map<M, int, std::string, std::less<int>,
+        std::allocator<std::pair<const int, std::string>>, Traits>;
+
+template <typename Tree> static Tree make_tree(int count) {
+  Tree tree;
+  for (int i = 0; i < count; ++i) {
+    tree.insert({(i * 7919) % count, std::to_string(i)});
+  }
+  return tree;
+}
+
+template <typename Tree>
+static void expect_clone(const Tree &copy, const Tree &original) {
+  copy.validate();
+  ASSERT_EQ(copy.size(), original.size());
+  ASSERT_TRUE(std::equal(copy.begin(), copy.end(), original.begin(),
+                         original.end()));
+  ASSERT_TRUE(std::equal(copy.rbegin(), copy.rend(), original.rbegin(),
+                         original.rend()));
+  ASSERT_EQ(copy.stats().nodes_per_level, original.stats().nodes_per_level);
+  for (auto it = copy.begin(), other = original.begin(); it != copy.end();
+       ++it, ++other) {
+    ASSERT_NE(&*it, &*other);
+  }
+}
+
+TEST(CopyTest, CopyPreservesTheShape) {
+  const auto original = make_tree<TraitsMap<4>>(5000);
+  TraitsMap<4> copy(original);
+  expect_clone(copy, original);
+
+  copy.erase(10);
+  copy.insert({-1, "new"});
+  ASSERT_TRUE(original.contains(10));
+  ASSERT_FALSE(original.contains(-1));
+  original.validate();
+}
+
+TEST(CopyTest, CopyOfEmptyAndSingleLeafTrees) {
+  const TraitsMap<4> empty;
+  TraitsMap<4> copy(empty);
+  ASSERT_TRUE(copy.empty());
+  ASSERT_EQ(copy.begin(), copy.end());
+  copy.insert({1, "one"});
+
+  const auto small = make_tree<TraitsMap<8>>(5);
+  TraitsMap<8> small_copy(small);
+  expect_clone(small_copy, small);
+}
+
+TEST(CopyTest, CopyAssignment) {
+  const auto original = make_tree<TraitsMap<5>>(3000);
+  auto target = make_tree<TraitsMap<5>>(100);
+  target = original;
+  expect_clone(target, original);
+
+  const auto &self = target;
+  target = self;
+  expect_clone(target, original);
+
+  target = TraitsMap<5>();
+  ASSERT_TRUE(target.empty());
+}
+
+TEST(CopyTest, UnequalAllocators) {
+  using Allocator = TaggedAllocator<std::pair<const int, int>>;
+  using Tree = Map<4, int, int, std::less<int>, Allocator>;
+
+  Tree original{Allocator(1)};
+  for (int i = 0; i < 1000; ++i) {
+    original.insert({i, i});
+  }
+
+  Tree copy(original, Allocator(2));
+  copy.validate();
+  ASSERT_EQ(copy.get_allocator().tag, 2);
+  ASSERT_TRUE(std::equal(copy.begin(), copy.end(), original.begin(),
+                         original.end()));
+
+  Tree moved(std::move(copy), Allocator(3));
+  moved.validate();
+  ASSERT_EQ(moved.get_allocator().tag, 3);
+  ASSERT_TRUE(copy.empty());
+  ASSERT_EQ(moved.size(), 1000);
+
+  // Without propagation the target keeps its allocator
+  Tree assigned{Allocator(4)};
+  assigned = moved;
+  ASSERT_EQ(assigned.get_allocator().tag, 4);
+  ASSERT_EQ(assigned.size(), 1000);
+
+  // and moves the values into nodes of its own allocator
+  Tree target{Allocator(5)};
+  target.insert({-1, -1});
+  target = std::move(moved);
+  target.validate();
+  ASSERT_EQ(target.get_allocator().tag, 5);
+  ASSERT_TRUE(moved.empty());
+  ASSERT_TRUE(std::equal(target.begin(), target.end(), original.begin(),
+                         original.end()));
+  static_assert(!std::is_nothrow_move_assignable_v<Tree>);
+}
+
+/// @brief TaggedAllocator handed over on move assignment
+template <typename T> struct MovingAllocator : TaggedAllocator<T> {
+  using propagate_on_container_move_assignment = std::true_type;
+  template <typename U> struct rebind {
+    using other = MovingAllocator<U>;
+  };
+
+  using TaggedAllocator<T>::TaggedAllocator;
+  template <typename U>
+  MovingAllocator(const MovingAllocator<U> &other) noexcept
+      : TaggedAllocator<T>(other) {}
+};
+
+TEST(CopyTest, PropagatedMoveAssignment) {
+  using Allocator = MovingAllocator<std::pair<const int, int>>;
+  using Tree = Map<4, int, int, std::less<int>, Allocator>;
+
+  Tree source{Allocator(1)};
+  for (int i = 0; i < 1000; ++i) {
+    source.insert({i, i});
+  }
+  const auto *first = &*source.begin();
+  Tree target{Allocator(2)};
+  target = std::move(source);
+  ASSERT_EQ(target.get_allocator().tag, 1);
+  ASSERT_EQ(&*target.begin(), first);
+  ASSERT_TRUE(source.empty());
+  static_assert(std::is_nothrow_move_assignable_v<Tree>);
+}
+
+TEST(CopyTest, ParallelCopy) {
+  const auto original = make_tree<TraitsMap<8, ParallelTraits>>(50000);
+  TraitsMap<8, ParallelTraits> copy(original);
+  expect_clone(copy, original);
+
+  const auto counted = make_tree<TraitsMap<4, ParallelCountedTraits>>(20000);
+  TraitsMap<4, ParallelCountedTraits> counted_copy(counted);
+  expect_clone(counted_copy, counted);
+  ASSERT_EQ(counted_copy.rank(12345), 12345);
+  ASSERT_EQ(counted_copy.select(777)->first, 777);
+}
+
+TEST(CopyTest, FailedCopyLeaksNothing) {
+  {
+    Map<4, int, Fragile> original;
+    for (int i = 0; i < 2000; ++i) {
+      original.insert({i, Fragile(i)});
+    }
+    const auto live = Fragile::live;
+
+    Fragile::countdown = 1500;
+    ASSERT_THROW((Map<4, int, Fragile>(original)), std::runtime_error);
+    ASSERT_EQ(Fragile::live, live);
+
+    Map<4, int, Fragile> target;
+    target.insert({-1, Fragile(-1)});
+    Fragile::countdown = 10;
+    ASSERT_THROW(target = original, std::runtime_error);
+    ASSERT_EQ(target.size(), 1);
+    ASSERT_EQ(target.begin()->first, -1);
+    Fragile::countdown = -1;
+  }
+  ASSERT_EQ(Fragile::live, 0);
+}
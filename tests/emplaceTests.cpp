@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "Set.hpp"
+
+#include <array>
+#include <memory>
+#include <string>
+
+/// @brief 1 KB payload counting how often it is copied or moved
+struct Payload {
+  static inline int copies = 0;
+  static inline int moves = 0;
+
+  explicit Payload(int value = 0) { bytes.fill(static_cast<char>(value)); }
+  Payload(const Payload &other) : bytes(other.bytes) { ++copies; }
+  Payload(Payload &&other) noexcept : bytes(other.bytes) { ++moves; }
+  Payload &operator=(const Payload &) = delete;
+  Payload &operator=(Payload &&) = delete;
+  ~Payload() = default;
+
+  [[nodiscard]] int value() const { return bytes[0]; }
+
+  std::array<char, 1024> bytes{};
+};
+
+struct StatsTraits : DefaultTraits {
+  static constexpr bool collect_stats = true;
+};
+
+TEST(EmplaceTest, MoveOnlyValues) {
+  Map<4, int, std::unique_ptr<int>> tree;
+  for (int i = 0; i < 300; ++i) {
+    auto [it, inserted] = tree.insert({i, std::make_unique<int>(i)});
+    ASSERT_TRUE(inserted);
+    ASSERT_EQ(*it->second, i);
+  }
+  for (int i = 300; i < 600; ++i) {
+    ASSERT_TRUE(tree.emplace(i, std::make_unique<int>(i)).second);
+  }
+  for (int i = 600; i < 900; ++i) {
+    ASSERT_TRUE(tree.try_emplace(i, std::make_unique<int>(i)).second);
+  }
+
+  auto duplicate = std::make_unique<int>(-1);
+  ASSERT_FALSE(tree.try_emplace(5, std::move(duplicate)).second);
+  ASSERT_NE(duplicate, nullptr) << "try_emplace consumed its argument";
+  ASSERT_FALSE(tree.emplace(5, std::make_unique<int>(-1)).second);
+
+  ASSERT_EQ(tree.size(), 900);
+  tree.validate();
+  for (const auto &[key, value] : tree) {
+    ASSERT_EQ(*value, key);
+  }
+}
+
+TEST(EmplaceTest, ValuesAreNeverCopied) {
+  Map<8, int, Payload> tree;
+  Payload::copies = 0;
+  Payload::moves = 0;
+
+  for (int i = 0; i < 500; ++i) {
+    tree.try_emplace(i, i);
+  }
+  ASSERT_EQ(Payload::moves, 0);
+  for (int i = 500; i < 1000; ++i) {
+    tree.emplace(std::piecewise_construct, std::forward_as_tuple(i),
+                 std::forward_as_tuple(i));
+  }
+  ASSERT_EQ(Payload::moves, 0);
+  for (int i = 1000; i < 1500; ++i) {
+    tree.insert({i, Payload(i)});
+  }
+  // Only the temporary pairs are moved into place, splits move no values
+  ASSERT_EQ(Payload::moves, 1000);
+  ASSERT_EQ(Payload::copies, 0);
+
+  tree.validate();
+  for (const auto &[key, value] : tree) {
+    ASSERT_EQ(value.value(), static_cast<char>(key));
+  }
+}
+
+TEST(EmplaceTest, TryEmplaceMovesTheKeyOnlyWhenInserting) {
+  Map<3, std::string, int> tree;
+  std::string key(40, 'k');
+  ASSERT_TRUE(tree.try_emplace(std::move(key), 1).second);
+  ASSERT_TRUE(key.empty());
+
+  std::string present(40, 'k');
+  ASSERT_FALSE(tree.try_emplace(std::move(present), 2).second);
+  ASSERT_EQ(present, std::string(40, 'k'));
+  ASSERT_EQ(tree.begin()->second, 1);
+}
+
+TEST(EmplaceTest, SequentialHintsSkipTheDescent) {
+  Map<8, int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+      StatsTraits>
+      tree;
+  for (int i = 0; i < 1000; ++i) {
+    auto it = tree.insert(tree.end(), {i, i});
+    ASSERT_EQ(it->first, i);
+  }
+  tree.validate();
+  ASSERT_EQ(tree.size(), 1000);
+
+  auto stats = tree.stats();
+  // Only the appends into a full tail leaf descend
+  ASSERT_GT(stats.hint_hits, 700);
+  ASSERT_EQ(stats.hint_hits + stats.hint_misses, 1000);
+}
+
+TEST(EmplaceTest, WrongHintsStillInsert) {
+  Map<4, int, int> tree;
+  for (int i = 0; i < 500; i += 2) {
+    tree.insert({i, i});
+  }
+  for (int i = 1; i < 500; i += 2) {
+    auto it = tree.emplace_hint(tree.begin(), i, i);
+    ASSERT_EQ(it->first, i);
+    it = tree.try_emplace(tree.end(), i + 1000, i);
+    ASSERT_EQ(it->first, i + 1000);
+  }
+  // Present keys return the existing element
+  auto it = tree.insert(tree.find(10), {4, -1});
+  ASSERT_EQ(it->first, 4);
+  ASSERT_EQ(it->second, 4);
+
+  tree.validate();
+  ASSERT_EQ(tree.size(), 750);
+}
+
+TEST(EmplaceTest, HintBeforeItsSuccessor) {
+  Map<16, int, int> tree;
+  for (int i = 0; i < 100; ++i) {
+    tree.insert({i * 10, i});
+  }
+  for (int i = 0; i < 99; ++i) {
+    auto next = tree.find((i + 1) * 10);
+    auto it = tree.insert(next, {i * 10 + 5, -i});
+    ASSERT_EQ(it->first, i * 10 + 5);
+    ASSERT_EQ(std::next(it)->first, (i + 1) * 10);
+  }
+  tree.validate();
+  ASSERT_EQ(tree.size(), 199);
+}
+
+TEST(EmplaceTest, SetInsertion) {
+  Set<3, std::string> set;
+  ASSERT_TRUE(set.insert(std::string("b")).second);
+  ASSERT_FALSE(set.insert(std::string("b")).second);
+  ASSERT_TRUE(set.insert(std::string("a")).second);
+  ASSERT_EQ(set.begin()->first, "a");
+  ASSERT_EQ(set.size(), 2);
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "RandomOperations.hpp"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
+#include <vector>
+
+struct CountedTraits : DefaultTraits {
+  using augmentation = SubtreeSize;
+};
+
+struct LazyTraits : DefaultTraits {
+  static constexpr size_t lazy_delete_threshold = 1;
+};
+
+template <size_t M, typename Traits = DefaultTraits>
+using TraitsMap =
+    Map<M, int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+        Traits>;
+
+template <typename Tree> static void random_erase(int count) {
+  Tree tree;
+  std::map<int, int> expected;
+  std::mt19937 generator(7);
+  std::uniform_int_distribution<int> distribution(0, count);
+
+  for (int i = 0; i < count; ++i) {
+    auto key = distribution(generator);
+    tree.insert({key, i});
+    expected.insert({key, i});
+  }
+  for (int i = 0; i < 2 * count; ++i) {
+    auto key = distribution(generator);
+    ASSERT_EQ(tree.erase(key), expected.erase(key));
+    if (i % 97 == 0) {
+      expect_same(tree, expected);
+    }
+  }
+  expect_same(tree, expected);
+
+  for (auto [key, value] : std::map<int, int>(expected)) {
+    ASSERT_EQ(tree.erase(key), 1);
+  }
+  ASSERT_TRUE(tree.empty());
+  ASSERT_EQ(tree.begin(), tree.end());
+}
+
+TEST(ErasureTest, RandomKeys) {
+  random_erase<TraitsMap<3>>(3000);
+  random_erase<TraitsMap<4>>(3000);
+  random_erase<TraitsMap<7>>(3000);
+  random_erase<TraitsMap<16>>(3000);
+}
+
+TEST(ErasureTest, LazyDelete) { random_erase<TraitsMap<8, LazyTraits>>(3000); }
+
+TEST(ErasureTest, Iterator) {
+  TraitsMap<4> tree;
+  for (int key = 0; key < 500; ++key) {
+    tree.insert({key, key});
+  }
+
+  // Erase every odd key walking forward
+  auto it = tree.begin();
+  while (it != tree.end()) {
+    it = it->first % 2 == 1 ? tree.erase(it) : std::next(it);
+  }
+  ASSERT_EQ(tree.size(), 250);
+  for (const auto &[key, value] : tree) {
+    ASSERT_EQ(key % 2, 0);
+  }
+  it = tree.erase(tree.find(498));
+  ASSERT_EQ(it, tree.end());
+}
+
+TEST(ErasureTest, Range) {
+  std::mt19937 generator(11);
+  for (int round = 0; round < 200; ++round) {
+    TraitsMap<4> tree;
+    std::map<int, int> expected;
+    const int count = 1 + round * 13;
+    for (int key = 0; key < count; ++key) {
+      tree.insert({key, key});
+      expected.insert({key, key});
+    }
+
+    std::uniform_int_distribution<int> distribution(0, count);
+    auto low = distribution(generator);
+    auto high = distribution(generator);
+    if (low > high) {
+      std::swap(low, high);
+    }
+
+    auto it = tree.erase(tree.lower_bound(low), tree.lower_bound(high));
+    expected.erase(expected.lower_bound(low), expected.lower_bound(high));
+    expect_same(tree, expected);
+    ASSERT_EQ(it, tree.lower_bound(high));
+
+    // The joined tree keeps working
+    for (int key = low; key < high; key += 3) {
+      tree.insert({key, -key});
+      expected.insert({key, -key});
+    }
+    for (int key = 0; key < count; key += 5) {
+      tree.erase(key);
+      expected.erase(key);
+    }
+    expect_same(tree, expected);
+  }
+}
+
+TEST(ErasureTest, RangeWholeTree) {
+  TraitsMap<5> tree;
+  for (int key = 0; key < 1000; ++key) {
+    tree.insert({key, key});
+  }
+  auto it = tree.erase(tree.begin(), tree.end());
+  ASSERT_EQ(it, tree.end());
+  ASSERT_TRUE(tree.empty());
+  tree.insert({1, 1});
+  ASSERT_EQ(tree.size(), 1);
+}
+
+TEST(ErasureTest, KeepsAggregates) {
+  TraitsMap<4, CountedTraits> tree;
+  std::vector<int> keys(2000);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(3));
+  for (auto key : keys) {
+    tree.insert({key, key});
+  }
+
+  for (int key = 0; key < 2000; key += 2) {
+    tree.erase(key);
+  }
+  tree.erase(tree.lower_bound(501), tree.lower_bound(1501));
+
+  std::vector<int> remaining;
+  for (int key = 1; key < 2000; key += 2) {
+    if (key < 501 || key >= 1501) {
+      remaining.push_back(key);
+    }
+  }
+  ASSERT_EQ(tree.size(), remaining.size());
+  for (size_t index = 0; index < remaining.size(); ++index) {
+    ASSERT_EQ(tree.select(index)->first, remaining[index]);
+    ASSERT_EQ(tree.rank(remaining[index]), index);
+  }
+  ASSERT_EQ(tree.count(0, 2000), remaining.size());
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "RandomOperations.hpp"
+#include "Set.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static_assert(LeafFingerprint<NoFingerprint, int>);
+static_assert(LeafFingerprint<HashFingerprint<std::hash<int>>, int>);
+
+template <typename Key> struct FingerprintTraits : DefaultTraits {
+  using leaf_fingerprint = HashFingerprint<std::hash<Key>>;
+  static constexpr bool collect_stats = true;
+};
+
+template <size_t M, typename Key, typename Compare = std::less<Key>>
+using FingerprintMap =
+    Map<M, Key, int, Compare, std::allocator<std::pair<const Key, int>>,
+        FingerprintTraits<Key>>;
+
+template <typename Tree> static void random_lookups() {
+  using key_type = typename Tree::key_type;
+  Tree tree;
+  Expected<Tree> expected;
+  random_operations(tree, expected, 30000, 20000, 3);
+  // validate checks every fingerprint against its key
+  expect_same(tree, expected);
+
+  for (int i = -100; i < 20100; ++i) {
+    const auto key = make_key<key_type>(i);
+    const auto it = tree.find(key);
+    const auto other = expected.find(key);
+    ASSERT_EQ(it == tree.end(), other == expected.end());
+    if (other != expected.end()) {
+      ASSERT_EQ(it->second, other->second);
+    }
+    ASSERT_EQ(tree.count(key), expected.count(key));
+  }
+}
+
+TEST(FingerprintTest, IntegerTrees) {
+  random_lookups<FingerprintMap<3, int>>();
+  random_lookups<FingerprintMap<16, int>>();
+  random_lookups<FingerprintMap<256, int>>();
+}
+
+TEST(FingerprintTest, StringTrees) {
+  random_lookups<FingerprintMap<4, std::string>>();
+  random_lookups<FingerprintMap<64, std::string>>();
+}
+
+struct StatsTraits : DefaultTraits {
+  static constexpr bool collect_stats = true;
+};
+
+TEST(FingerprintTest, MissesCompareNoKey) {
+  FingerprintMap<64, int> tree;
+  Map<64, int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+      StatsTraits>
+      plain;
+  for (int i = 0; i < 100000; i += 2) {
+    tree.insert({i, i});
+    plain.insert({i, i});
+  }
+  tree.reset_stats();
+  plain.reset_stats();
+  for (int i = 1; i < 100000; i += 2) {
+    ASSERT_FALSE(tree.contains(i));
+    ASSERT_FALSE(plain.contains(i));
+  }
+  const auto stats = tree.stats();
+  ASSERT_EQ(stats.lookups, 50000);
+  // About 1 in 256 values shares the fingerprint of the key looked up, the
+  // internal nodes make the same comparisons
+  ASSERT_GT(stats.fingerprint_rejections, 40000);
+  ASSERT_EQ(plain.stats().fingerprint_rejections, 0);
+  ASSERT_GT(plain.stats().lookup_comparisons,
+            stats.lookup_comparisons + 50000 * 10);
+
+  tree.reset_stats();
+  for (int i = 0; i < 100000; i += 2) {
+    ASSERT_TRUE(tree.contains(i));
+  }
+  ASSERT_EQ(tree.stats().fingerprint_rejections, 0);
+}
+
+TEST(FingerprintTest, BatchedLookups) {
+  FingerprintMap<32, int> tree;
+  std::vector<int> keys;
+  for (int i = 0; i < 5000; ++i) {
+    tree.insert({i * 3, i});
+    keys.push_back(i * 2);
+  }
+  std::vector<decltype(tree)::iterator> found(keys.size());
+  tree.find_batch(keys, found);
+  std::unique_ptr<bool[]> contained(new bool[keys.size()]);
+  tree.contains_batch(keys, std::span<bool>(contained.get(), keys.size()));
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const bool present = keys[i] % 3 == 0;
+    ASSERT_EQ(found[i] != tree.end(), present);
+    ASSERT_EQ(contained[i], present);
+    if (present) {
+      ASSERT_EQ(found[i]->first, keys[i]);
+    }
+  }
+}
+
+TEST(FingerprintTest, StructuralOperations) {
+  FingerprintMap<8, int> tree;
+  std::vector<std::pair<int, int>> sorted;
+  for (int i = 0; i < 10000; ++i) {
+    sorted.emplace_back(i, i);
+  }
+  tree.insert(sorted.begin(), sorted.end());
+  tree.validate();
+
+  auto copy = tree;
+  copy.validate();
+  const auto snapshot = tree.snapshot();
+  tree.erase(5000);
+  tree.validate();
+
+  decltype(tree) high;
+  tree.split(7000, high);
+  tree.erase(tree.find(100), tree.find(900));
+  tree.join(high);
+  tree.validate();
+  ASSERT_FALSE(tree.contains(500));
+  ASSERT_TRUE(tree.contains(7000));
+  ASSERT_TRUE(copy.contains(5000));
+  ASSERT_TRUE(snapshot.contains(5000));
+}
+
+TEST(FingerprintTest, TransparentLookupsSkipTheFingerprints) {
+  FingerprintMap<8, std::string, std::less<>> tree;
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert({make_key<std::string>(i), i});
+  }
+  const auto key500 = make_key<std::string>(500);
+  ASSERT_EQ(tree.find(std::string_view(key500))->second, 500);
+  ASSERT_TRUE(tree.contains(std::string_view(make_key<std::string>(999))));
+  ASSERT_FALSE(tree.contains(std::string_view(make_key<std::string>(1000))));
+  ASSERT_TRUE(tree.contains(make_key<std::string>(7)));
+}
+
+TEST(FingerprintTest, Sets) {
+  Set<16, int, std::less<int>, std::allocator<int>, FingerprintTraits<int>>
+      set;
+  for (int i = 0; i < 3000; ++i) {
+    set.insert(i * 5);
+  }
+  set.validate();
+  ASSERT_TRUE(set.contains(2995));
+  ASSERT_FALSE(set.contains(2996));
+}
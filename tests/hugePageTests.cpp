@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include "HugePages.hpp"
+#include "Map.hpp"
+#include "RandomOperations.hpp"
+#include "Set.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+template <typename Key, typename T = int>
+using SlabMap = Map<16, Key, T, std::less<Key>,
+                    HugePageAllocator<std::pair<const Key, T>>>;
+
+TEST(HugePageTest, ArenaReusesFreedBlocks) {
+  HugePageArena arena;
+  std::vector<void *> blocks;
+  for (int i = 0; i < 1000; ++i) {
+    auto *block = arena.allocate(40, 8);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(block) %
+                  HugePageArena::granule,
+              0);
+    blocks.push_back(block);
+  }
+  ASSERT_EQ(arena.usage().slabs, 1);
+  ASSERT_EQ(arena.usage().bytes_in_use, 1000 * 48);
+
+  const std::unordered_set<void *> freed(blocks.begin(), blocks.end());
+  for (auto *block : blocks) {
+    arena.deallocate(block, 40, 8);
+  }
+  ASSERT_EQ(arena.usage().bytes_in_use, 0);
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(freed.contains(arena.allocate(33, 8)));
+  }
+  ASSERT_EQ(arena.usage().slabs, 1);
+}
+
+TEST(HugePageTest, ArenaGrowsAndBypassesLargeBlocks) {
+  HugePageArena arena;
+  std::vector<void *> blocks;
+  const auto count = 2 * HugePageArena::slab_size / HugePageArena::max_block;
+  for (size_t i = 0; i < count; ++i) {
+    blocks.push_back(arena.allocate(HugePageArena::max_block, 16));
+  }
+  ASSERT_GE(arena.usage().slabs, 2);
+
+  auto *large = arena.allocate(HugePageArena::max_block + 1, 8);
+  auto *aligned = arena.allocate(64, 64);
+  ASSERT_EQ(reinterpret_cast<std::uintptr_t>(aligned) % 64, 0);
+  ASSERT_EQ(arena.usage().bytes_in_use, count * HugePageArena::max_block);
+  arena.deallocate(large, HugePageArena::max_block + 1, 8);
+  arena.deallocate(aligned, 64, 64);
+  for (auto *block : blocks) {
+    arena.deallocate(block, HugePageArena::max_block, 16);
+  }
+}
+
+TEST(HugePageTest, RandomOperations) {
+  HugePageArena arena;
+  SlabMap<int> tree{HugePageAllocator<std::pair<const int, int>>(arena)};
+  Expected<SlabMap<int>> expected;
+  random_operations(tree, expected, 100000, 50000, 7);
+  expect_same(tree, expected);
+  ASSERT_GT(arena.usage().bytes_in_use, 0);
+
+  tree.clear();
+  ASSERT_EQ(arena.usage().bytes_in_use, 0);
+}
+
+TEST(HugePageTest, TreesOfOneArenaExchangeNodes) {
+  HugePageArena arena;
+  HugePageArena other_arena;
+  using Allocator = HugePageAllocator<std::pair<const std::string, int>>;
+  ASSERT_TRUE(Allocator(arena) == HugePageAllocator<int>(arena));
+  ASSERT_FALSE(Allocator(arena) == Allocator(other_arena));
+  ASSERT_TRUE(Allocator() == Allocator(HugePageArena::global()));
+  {
+    SlabMap<std::string> tree{Allocator(arena)};
+    for (int i = 0; i < 5000; ++i) {
+      tree.insert({std::to_string(i), i});
+    }
+    SlabMap<std::string> high{Allocator(arena)};
+    tree.split("5", high);
+    auto copy = high;
+    ASSERT_TRUE(copy.get_allocator() == high.get_allocator());
+
+    // Unequal arenas fall back to moving every value
+    SlabMap<std::string> elsewhere{Allocator(other_arena)};
+    elsewhere.join(copy);
+    ASSERT_TRUE(copy.empty());
+    ASSERT_GT(other_arena.usage().bytes_in_use, 0);
+
+    tree.join(high);
+    tree.validate();
+    elsewhere.validate();
+    ASSERT_EQ(tree.size(), 5000);
+    ASSERT_EQ(elsewhere.at("7"), 7);
+  }
+  ASSERT_EQ(arena.usage().bytes_in_use, 0);
+  ASSERT_EQ(other_arena.usage().bytes_in_use, 0);
+}
+
+TEST(HugePageTest, DefaultArena) {
+  Set<32, int64_t, std::less<int64_t>, HugePageAllocator<int64_t>> set;
+  for (int64_t i = 0; i < 20000; ++i) {
+    set.insert(i * 7);
+  }
+  set.validate();
+  ASSERT_TRUE(set.contains(7 * 1234));
+  ASSERT_FALSE(set.contains(7 * 1234 + 1));
+  ASSERT_GE(HugePageArena::global().usage().slabs, 1);
+}
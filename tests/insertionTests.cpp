@@ -13,15 +13,12 @@ TEST(BPlusTreeTest, InsertionTest1) {
   auto succes2 = tree.insert({1, 1});
   auto succes3 = tree.insert({1, 1});
   ASSERT_TRUE(succes1.second == INSERTION::SUCCESS);
-  ASSERT_TRUE(succes2.second == INSERTION::SUCCESS);
-  ASSERT_TRUE(succes3.second == INSERTION::WAS_FULL);
+  ASSERT_FALSE(succes2.second);
+  ASSERT_FALSE(succes3.second);
 
-  // ASSERT_TRUE(pair.second);
-
-  // TODO (enrique): Uncomment the following lines after implementing the
-  // iterator
-  // ASSERT_EQ(pair.first->first, 1);
-  // ASSERT_EQ(pair.first->second, 1);
+  ASSERT_EQ(succes1.first->first, 1);
+  ASSERT_EQ(succes1.first->second, 1);
+  ASSERT_EQ(succes1.first, succes3.first);
 }
 
 // TEST(BPlusTreeTest, InsertionTest_Rvalue1) {
@@ -54,44 +51,70 @@ TEST(BPlusTreeTest, InsertionTest1) {
 //   // ASSERT_EQ(it->second, 2);
 // }
 //
-// TEST(BPlusTreeTest, InsertionTest_Range1) {
-//   Map<3, int, int> tree;
-//
-//   // std::initializer_list<std::pair<const int, int>> list = {{1, 1}, {2,
-//   2}};
-//   // tree.insert(begin(list), end(list));
-//   //
-//   // auto it = tree.find(1);
-//   //
-//   // ASSERT_NE(it, tree.end());
-//   // ASSERT_EQ(it->first, 1);
-//   // ASSERT_EQ(it->second, 1);
-//
-//   // it = tree.find(2);
-//   //
-//   // ASSERT_NE(it, tree.end());
-//   // ASSERT_EQ(it->first, 2);
-//   // ASSERT_EQ(it->second, 2);
-// }
-//
-// TEST(BPlusTreeTest, InsertionTest_InitializerList1) {
-//   Map<3, int, int> tree;
-//
-//   // tree.insert({{1, 1}, {2, 2}});
-//   //
-//   // auto it = tree.find(1);
-//   //
-//   // ASSERT_NE(it, tree.end());
-//   // ASSERT_EQ(it->first, 1);
-//   // ASSERT_EQ(it->second, 1);
-//   //
-//   // it = tree.find(2);
-//   //
-//   // ASSERT_NE(it, tree.end());
-//   // ASSERT_EQ(it->first, 2);
-//   // ASSERT_EQ(it->second, 2);
-// }
-//
+TEST(BPlusTreeTest, InsertionTest_Range1) {
+  Map<3, int, int> tree;
+
+  std::initializer_list<std::pair<const int, int>> list = {{1, 1}, {2, 2}};
+  tree.insert(begin(list), end(list));
+
+  auto it = tree.find(1);
+
+  ASSERT_NE(it, tree.end());
+  ASSERT_EQ(it->first, 1);
+  ASSERT_EQ(it->second, 1);
+
+  it = tree.find(2);
+
+  ASSERT_NE(it, tree.end());
+  ASSERT_EQ(it->first, 2);
+  ASSERT_EQ(it->second, 2);
+}
+
+TEST(BPlusTreeTest, InsertionTest_InitializerList1) {
+  Map<3, int, int> tree;
+
+  tree.insert({{1, 1}, {2, 2}});
+
+  auto it = tree.find(1);
+
+  ASSERT_NE(it, tree.end());
+  ASSERT_EQ(it->first, 1);
+  ASSERT_EQ(it->second, 1);
+
+  it = tree.find(2);
+
+  ASSERT_NE(it, tree.end());
+  ASSERT_EQ(it->first, 2);
+  ASSERT_EQ(it->second, 2);
+}
+
+TEST(BPlusTreeTest, InsertionTest_Split) {
+  Map<3, int, int> tree;
+
+  for (int i = 0; i < 1000; ++i) {
+    auto key = (i * 7919) % 1000;
+    ASSERT_TRUE(tree.insert({key, -key}).second);
+  }
+  ASSERT_EQ(tree.size(), 1000);
+
+  int expected = 0;
+  for (const auto &[key, value] : tree) {
+    ASSERT_EQ(key, expected);
+    ASSERT_EQ(value, -expected);
+    ++expected;
+  }
+  ASSERT_EQ(expected, 1000);
+
+  for (auto it = tree.rbegin(); it != tree.rend(); ++it) {
+    ASSERT_EQ(it->first, --expected);
+  }
+
+  ASSERT_EQ(tree.lower_bound(500)->first, 500);
+  ASSERT_EQ(tree.upper_bound(500)->first, 501);
+  ASSERT_EQ(tree.find(1000), tree.end());
+  ASSERT_TRUE(tree.contains(999));
+}
+
 // TEST(insert, InsertUniqValue) {
 //   auto map = Map<3, int, std::string>();
 //   // auto [iter, inserted] = map.insert(std::make_pair(1, "value1"));
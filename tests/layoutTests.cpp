@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "Set.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+
+// Nodes hold no comparator or allocator, the tree passes them down to every
+// node operation. These track the node sizes, so new members are deliberate.
+
+template <size_t M, typename Key, typename T,
+          typename Compare = std::less<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, T>>,
+          typename Traits = DefaultTraits>
+struct Nodes {
+  using Indexor_ = MapIndexor<Key, std::pair<const Key, T>>;
+  using Leaf =
+      LeafNode<M, Key, T, Indexor_, Compare, Allocator, Traits, M, M - 1>;
+  using Internal =
+      InternalNode<M, Key, T, Indexor_, Compare, Allocator, Traits, M, M - 1>;
+  using Handler =
+      NodeHandler<M, Key, T, Indexor_, Compare, Allocator, Traits, M, M - 1>;
+
+  struct ExpectedLeaf {
+    std::array<void *, M - 1> values;
+    size_t count;
+    void *next;
+    void *prev;
+    std::atomic<size_t> refs;
+  };
+
+  struct ExpectedInternal {
+    std::array<Key, M - 1> keys;
+    std::array<Handler, M> children;
+    size_t count;
+    std::atomic<size_t> refs;
+  };
+
+  struct ExpectedTree {
+    Handler root;
+    void *head;
+    void *tail;
+    size_t size;
+    bool shared;
+    std::shared_ptr<void> versions;
+    void *on_write;
+  };
+
+  static constexpr bool leaf_is_minimal = sizeof(Leaf) == sizeof(ExpectedLeaf);
+  static constexpr bool internal_is_minimal =
+      sizeof(Internal) == sizeof(ExpectedInternal);
+  static constexpr bool tree_is_minimal =
+      sizeof(Map<M, Key, T, Compare, Allocator, Traits>) ==
+      sizeof(ExpectedTree);
+};
+
+static_assert(Nodes<3, int, int>::leaf_is_minimal);
+static_assert(Nodes<3, int, int>::internal_is_minimal);
+static_assert(Nodes<4, char, char>::leaf_is_minimal);
+static_assert(Nodes<4, char, char>::internal_is_minimal);
+static_assert(Nodes<64, long, std::string>::leaf_is_minimal);
+static_assert(Nodes<64, std::string, long>::internal_is_minimal);
+
+/// @brief Comparator with state, which has to be stored
+struct Descending {
+  bool operator()(int left, int right) const { return left > right; }
+  int unused = 0;
+};
+
+TEST(LayoutTest, NodesHoldNoBackReferences) {
+  // Each value pointer is the only per value cost of a leaf
+  using Small = Nodes<4, int, int>;
+  using Large = Nodes<5, int, int>;
+  ASSERT_EQ(sizeof(Large::Leaf) - sizeof(Small::Leaf), sizeof(void *));
+  ASSERT_EQ(sizeof(Nodes<4, int, int, Descending>::Leaf),
+            sizeof(Small::Leaf));
+}
+
+TEST(LayoutTest, StatelessMembersTakeNoSpace) {
+  ASSERT_TRUE((Nodes<4, int, int>::tree_is_minimal));
+  ASSERT_TRUE((Nodes<16, std::string, int, std::less<>>::tree_is_minimal));
+  ASSERT_GT(sizeof(Map<4, int, int, Descending>), sizeof(Map<4, int, int>));
+  ASSERT_EQ(sizeof(Set<4, int>), sizeof(Map<4, int, int>));
+}
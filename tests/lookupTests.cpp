@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using StringMap = Map<4, std::string, int, std::less<>>;
+
+// std::string is only explicitly constructible from std::string_view, so
+// these lookups compile only through the heterogeneous overloads
+template <typename Tree>
+concept FindsStringView = requires(Tree tree, std::string_view key) {
+  tree.find(key);
+  tree.erase(key);
+};
+static_assert(FindsStringView<StringMap>);
+static_assert(!FindsStringView<Map<4, std::string, int>>);
+
+TEST(LookupTest, FindBatchMatchesFind) {
+  Map<4, int, int> tree;
+  for (int i = 0; i < 3000; ++i) {
+    tree.insert({(i * 7919) % 6000, i});
+  }
+
+  std::vector<int> keys;
+  for (int i = 0; i < 1000; ++i) {
+    keys.push_back((i * 104729) % 7000 - 500);
+  }
+
+  std::vector<Map<4, int, int>::iterator> results(keys.size());
+  tree.find_batch(keys, results);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(results[i], tree.find(keys[i]));
+  }
+
+  const auto &const_tree = tree;
+  std::vector<Map<4, int, int>::const_iterator> const_results(keys.size());
+  const_tree.find_batch(keys, const_results);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(const_results[i], const_tree.find(keys[i]));
+  }
+
+  auto found = std::make_unique<bool[]>(keys.size());
+  tree.contains_batch(keys, std::span<bool>(found.get(), keys.size()));
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(found[i], tree.contains(keys[i]));
+  }
+}
+
+TEST(LookupTest, FindBatchEmptyTree) {
+  Map<3, int, int> tree;
+  std::vector<int> keys{1, 2, 3};
+  std::vector<Map<3, int, int>::iterator> results(keys.size());
+
+  tree.find_batch(keys, results);
+  for (auto &result : results) {
+    ASSERT_EQ(result, tree.end());
+  }
+
+  std::vector<Map<3, int, int>::iterator> too_small(1);
+  ASSERT_THROW(tree.find_batch(keys, too_small), std::runtime_error);
+}
+
+TEST(LookupTest, TransparentLookup) {
+  StringMap tree;
+  for (int i = 0; i < 500; ++i) {
+    tree.insert({"key" + std::to_string(i * 2), i});
+  }
+
+  for (int i = 0; i < 1000; ++i) {
+    const auto owned = "key" + std::to_string(i);
+    const std::string_view key = owned;
+    ASSERT_EQ(tree.find(key), tree.find(owned));
+    ASSERT_EQ(tree.contains(key), i % 2 == 0);
+    ASSERT_EQ(tree.count(key), tree.count(owned));
+    ASSERT_EQ(tree.lower_bound(key), tree.lower_bound(owned));
+    ASSERT_EQ(tree.upper_bound(key), tree.upper_bound(owned));
+    ASSERT_EQ(tree.equal_range(key), tree.equal_range(owned));
+  }
+
+  const auto &const_tree = tree;
+  ASSERT_EQ(const_tree.find("key10")->second, 5);
+  ASSERT_EQ(const_tree.find("key11"), const_tree.end());
+  ASSERT_EQ(const_tree.lower_bound("key11")->first, "key110");
+  ASSERT_EQ(const_tree.upper_bound("key12")->first, "key120");
+
+  ASSERT_EQ(tree.erase(std::string_view("key10")), 1);
+  ASSERT_EQ(tree.erase("key10"), 0);
+  ASSERT_FALSE(tree.contains("key10"));
+  ASSERT_EQ(tree.size(), 499);
+  tree.validate();
+}
@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "MemoryBudget.hpp"
+#include "RandomOperations.hpp"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+using Allocator = BudgetAllocator<std::pair<const int, int>>;
+template <size_t M = 16>
+using BudgetMap = Map<M, int, int, std::less<int>, Allocator>;
+
+struct LazyTraits : DefaultTraits {
+  static constexpr size_t lazy_delete_threshold = 1;
+};
+
+TEST(MemoryBudgetTest, UsageMatchesTheAllocations) {
+  MemoryBudget budget;
+  {
+    BudgetMap<> tree{Allocator(budget)};
+    Expected<BudgetMap<>> expected;
+    random_operations(tree, expected, 50000, 100000, 3);
+    expect_same(tree, expected);
+
+    const auto usage = tree.memory_usage();
+    const auto stats = tree.stats();
+    ASSERT_EQ(usage.leaf_bytes, stats.leaf_bytes);
+    ASSERT_EQ(usage.internal_bytes, stats.internal_bytes);
+    ASSERT_EQ(usage.value_bytes, tree.size() * sizeof(std::pair<int, int>));
+    ASSERT_EQ(usage.total_bytes(), budget.used());
+    ASSERT_GT(usage.slack_bytes, 0);
+    ASSERT_LT(usage.slack_bytes, usage.leaf_bytes + usage.internal_bytes);
+
+    tree.clear();
+    ASSERT_EQ(tree.memory_usage().total_bytes(), 0);
+  }
+  ASSERT_EQ(budget.used(), 0);
+  ASSERT_EQ(budget.exceeded(), 0);
+}
+
+TEST(MemoryBudgetTest, SlackShrinksWithCompaction) {
+  Map<16, int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+      LazyTraits>
+      tree;
+  for (int i = 0; i < 20000; ++i) {
+    tree.insert({i, i});
+  }
+  for (int i = 0; i < 20000; ++i) {
+    if (i % 8 != 0) {
+      tree.erase(i);
+    }
+  }
+  const auto sparse = tree.memory_usage();
+  tree.compact();
+  const auto packed = tree.memory_usage();
+  ASSERT_LT(packed.slack_bytes, sparse.slack_bytes / 4);
+  ASSERT_LT(packed.total_bytes(), sparse.total_bytes());
+  ASSERT_EQ(packed.value_bytes, sparse.value_bytes);
+}
+
+TEST(MemoryBudgetTest, CallbackEvictsBeforeInserting) {
+  constexpr size_t limit = 64 << 10U;
+  BudgetMap<> *evicting = nullptr;
+  std::vector<size_t> excesses;
+  MemoryBudget budget(limit, [&](size_t excess) {
+    excesses.push_back(excess);
+    // Drops the oldest keys, the tree is inserted in key order
+    for (int i = 0; i < 64 && !evicting->empty(); ++i) {
+      evicting->erase(evicting->begin());
+    }
+  });
+
+  BudgetMap<> tree{Allocator(budget)};
+  evicting = &tree;
+  for (int i = 0; i < 20000; ++i) {
+    tree.insert({i, i});
+    if (i % 3 == 0) {
+      tree.emplace_hint(tree.end(), i + 100000, i);
+    }
+    tree.try_emplace(i + 200000, i);
+  }
+  tree.validate();
+  ASSERT_GT(budget.exceeded(), 0);
+  ASSERT_EQ(budget.exceeded(), excesses.size());
+  ASSERT_GT(excesses.front(), 0);
+  ASSERT_EQ(budget.used(), tree.memory_usage().total_bytes());
+  // The budget is soft, but the evictions kept the tree close to it
+  ASSERT_LT(budget.used(), limit + 4096);
+  ASSERT_TRUE(tree.contains(19999));
+  ASSERT_FALSE(tree.contains(0));
+}
+
+TEST(MemoryBudgetTest, CallbackSpillsIntoAnotherTree) {
+  BudgetMap<8> *hot = nullptr;
+  BudgetMap<8> *cold = nullptr;
+  MemoryBudget budget(16 << 10U, [&](size_t /*excess*/) {
+    // Moving nodes between trees of one budget allocates no value, and the
+    // insertions into cold do not call back again
+    for (int i = 0; i < 32 && !hot->empty(); ++i) {
+      cold->insert(hot->extract(hot->begin()));
+    }
+  });
+
+  BudgetMap<8> hot_tree{Allocator(budget)};
+  BudgetMap<8> cold_tree{Allocator(budget)};
+  hot = &hot_tree;
+  cold = &cold_tree;
+  for (int i = 0; i < 5000; ++i) {
+    hot_tree.insert({i, i});
+  }
+  hot_tree.validate();
+  cold_tree.validate();
+  ASSERT_GT(budget.exceeded(), 0);
+  ASSERT_EQ(hot_tree.size() + cold_tree.size(), 5000);
+  ASSERT_GT(cold_tree.size(), 0);
+  ASSERT_EQ(budget.used(), hot_tree.memory_usage().total_bytes() +
+                               cold_tree.memory_usage().total_bytes());
+}
+
+TEST(MemoryBudgetTest, TreesOfDifferentBudgets) {
+  MemoryBudget first;
+  MemoryBudget second;
+  ASSERT_TRUE(Allocator(first) == BudgetAllocator<int>(first));
+  ASSERT_FALSE(Allocator(first) == Allocator(second));
+  {
+    BudgetMap<> tree{Allocator(first)};
+    BudgetMap<> other{Allocator(second)};
+    for (int i = 0; i < 3000; ++i) {
+      tree.insert({i, i});
+      other.insert({i + 3000, i});
+    }
+
+    // Unequal budgets move every value instead of exchanging nodes
+    tree.join(other);
+    ASSERT_TRUE(other.empty());
+    tree.validate();
+    ASSERT_EQ(tree.size(), 6000);
+    ASSERT_EQ(first.used(), tree.memory_usage().total_bytes());
+    ASSERT_EQ(second.used(), other.memory_usage().total_bytes());
+
+    // Without a callback the budget is only counted
+    first.set_limit(0);
+    tree.insert({-1, -1});
+    ASSERT_EQ(first.exceeded(), 0);
+  }
+  ASSERT_EQ(first.used(), 0);
+  ASSERT_EQ(second.used(), 0);
+}
+
+TEST(MemoryBudgetTest, OnlyAllocatingInsertionsCallBack) {
+  size_t calls = 0;
+  MemoryBudget budget(0, [&](size_t /*excess*/) { ++calls; });
+  BudgetMap<8> tree{Allocator(budget)};
+  BudgetMap<8> other{Allocator(budget)};
+  for (int i = 0; i < 100; ++i) {
+    tree.insert({i, i});
+  }
+  ASSERT_EQ(calls, 100);
+
+  // Present keys allocate nothing, whatever the insertion
+  calls = 0;
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_FALSE(tree.insert({i, -i}).second);
+    ASSERT_FALSE(tree.try_emplace(i, -i).second);
+    tree.emplace_hint(tree.find(i), i, -i);
+  }
+  ASSERT_EQ(calls, 0);
+  ASSERT_EQ(tree.at(42), 42);
+
+  // Nodes of the same budget are relinked, only a leaf split allocates
+  other.insert({1000, 0});
+  calls = 0;
+  ASSERT_TRUE(other.insert(tree.extract(50)).inserted);
+  other.insert(other.end(), tree.extract(51));
+  ASSERT_EQ(calls, 0);
+  ASSERT_EQ(other.size(), 3);
+  other.validate();
+}
+
+TEST(MemoryBudgetTest, CallbackMayEraseFromTheSourceOfAMerge) {
+  BudgetMap<4> *source = nullptr;
+  MemoryBudget budget(std::numeric_limits<size_t>::max(),
+                      [&](size_t /*excess*/) {
+                        if (!source->empty()) {
+                          source->erase(std::prev(source->end()));
+                        }
+                      });
+  BudgetMap<4> target{Allocator(budget)};
+  BudgetMap<4> source_tree{Allocator(budget)};
+  source = &source_tree;
+  for (int i = 0; i < 400; ++i) {
+    if (i % 2 == 0) {
+      target.insert({i, i});
+    }
+    source_tree.insert({i, i});
+  }
+  const auto before = target.size() + source_tree.size();
+
+  // Every leaf split of the merge evicts the last value of source
+  budget.set_limit(0);
+  target.merge(source_tree);
+  target.validate();
+  source_tree.validate();
+  ASSERT_LT(target.size() + source_tree.size(), before);
+  for (const auto &[key, value] : source_tree) {
+    ASSERT_TRUE(target.contains(key));
+  }
+  ASSERT_EQ(budget.used(), target.memory_usage().total_bytes() +
+                               source_tree.memory_usage().total_bytes());
+}
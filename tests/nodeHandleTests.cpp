@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "Set.hpp"
+
+#include <map>
+#include <string>
+
+/// @brief Value counting its copies and live instances
+struct Tracked {
+  static inline int copies = 0;
+  static inline int live = 0;
+
+  explicit Tracked(int value = 0) : value(value) { ++live; }
+  Tracked(const Tracked &other) : value(other.value) {
+    ++copies;
+    ++live;
+  }
+  Tracked(Tracked &&other) noexcept : value(other.value) { ++live; }
+  Tracked &operator=(const Tracked &other) {
+    value = other.value;
+    ++copies;
+    return *this;
+  }
+  Tracked &operator=(Tracked &&other) noexcept {
+    value = other.value;
+    return *this;
+  }
+  ~Tracked() { --live; }
+
+  int value;
+};
+
+using TrackedMap = Map<4, int, Tracked>;
+
+static void fill(TrackedMap &tree, int first, int last, int step = 1) {
+  for (int key = first; key < last; key += step) {
+    tree.insert({key, Tracked(key)});
+  }
+}
+
+TEST(NodeHandleTest, ExtractAndInsertRelinkTheValue) {
+  TrackedMap source;
+  TrackedMap target;
+  fill(source, 0, 300);
+  fill(target, 1000, 1100);
+  Tracked::copies = 0;
+
+  const auto *address = &*source.find(150);
+  auto node = source.extract(150);
+  ASSERT_FALSE(node.empty());
+  ASSERT_EQ(node.key(), 150);
+  ASSERT_EQ(node.mapped().value, 150);
+  ASSERT_EQ(&node.value(), address);
+  ASSERT_EQ(source.size(), 299);
+  ASSERT_FALSE(source.contains(150));
+  source.validate();
+
+  auto result = target.insert(std::move(node));
+  ASSERT_TRUE(result.inserted);
+  ASSERT_TRUE(result.node.empty());
+  ASSERT_TRUE(node.empty());
+  ASSERT_EQ(&*result.position, address);
+  ASSERT_EQ(&*target.find(150), address);
+  ASSERT_EQ(target.size(), 101);
+  target.validate();
+  ASSERT_EQ(Tracked::copies, 0);
+}
+
+TEST(NodeHandleTest, ExtractByIterator) {
+  TrackedMap tree;
+  fill(tree, 0, 100);
+
+  for (int key = 0; key < 100; key += 2) {
+    auto node = tree.extract(tree.find(key));
+    ASSERT_EQ(node.key(), key);
+  }
+  ASSERT_EQ(tree.size(), 50);
+  tree.validate();
+  for (const auto &[key, value] : tree) {
+    ASSERT_EQ(key % 2, 1);
+  }
+}
+
+TEST(NodeHandleTest, ExtractMissingKeyIsEmpty) {
+  TrackedMap tree;
+  ASSERT_TRUE(tree.extract(1).empty());
+  fill(tree, 0, 10);
+  auto node = tree.extract(42);
+  ASSERT_TRUE(node.empty());
+  ASSERT_FALSE(node);
+  ASSERT_EQ(tree.size(), 10);
+
+  auto result = tree.insert(std::move(node));
+  ASSERT_FALSE(result.inserted);
+  ASSERT_EQ(result.position, tree.end());
+}
+
+TEST(NodeHandleTest, InsertOfPresentKeyHandsTheNodeBack) {
+  TrackedMap tree;
+  fill(tree, 0, 10);
+  TrackedMap other;
+  other.insert({5, Tracked(-5)});
+
+  auto result = tree.insert(other.extract(5));
+  ASSERT_FALSE(result.inserted);
+  ASSERT_EQ(result.position, tree.find(5));
+  ASSERT_EQ(result.position->second.value, 5);
+  ASSERT_EQ(result.node.mapped().value, -5);
+  ASSERT_EQ(tree.size(), 10);
+}
+
+TEST(NodeHandleTest, HintedInsertOfPresentKeyKeepsTheNode) {
+  TrackedMap tree;
+  fill(tree, 0, 10);
+  TrackedMap other;
+  other.insert({5, Tracked(-5)});
+  other.insert({20, Tracked(-20)});
+
+  auto node = other.extract(5);
+  const auto *address = &node.value();
+  auto position = tree.insert(tree.find(6), std::move(node));
+  ASSERT_EQ(position, tree.find(5));
+  ASSERT_EQ(position->second.value, 5);
+  ASSERT_FALSE(node.empty());
+  ASSERT_EQ(node.key(), 5);
+  ASSERT_EQ(node.mapped().value, -5);
+  ASSERT_EQ(&node.value(), address);
+  ASSERT_EQ(tree.size(), 10);
+
+  auto absent = other.extract(20);
+  address = &absent.value();
+  position = tree.insert(tree.end(), std::move(absent));
+  ASSERT_TRUE(absent.empty());
+  ASSERT_EQ(&*position, address);
+  ASSERT_EQ(tree.size(), 11);
+  tree.validate();
+
+  ASSERT_EQ(tree.insert(tree.begin(), TrackedMap::node_type()), tree.end());
+}
+
+TEST(NodeHandleTest, DroppedNodeDestroysTheValue) {
+  {
+    TrackedMap tree;
+    fill(tree, 0, 50);
+    const auto live = Tracked::live;
+    tree.extract(7);
+    ASSERT_EQ(Tracked::live, live - 1);
+  }
+  ASSERT_EQ(Tracked::live, 0);
+}
+
+TEST(NodeHandleTest, MergeKeepsPresentKeysInSource) {
+  TrackedMap target;
+  TrackedMap source;
+  std::map<int, int> expected;
+  fill(target, 0, 600, 3);
+  fill(source, 0, 600, 2);
+  for (int key = 0; key < 600; key += 3) {
+    expected[key] = key;
+  }
+  for (int key = 0; key < 600; key += 2) {
+    expected.insert({key, key});
+  }
+  Tracked::copies = 0;
+
+  target.merge(source);
+  target.validate();
+  source.validate();
+  ASSERT_EQ(Tracked::copies, 0);
+  ASSERT_EQ(target.size(), expected.size());
+  for (const auto &[key, value] : target) {
+    ASSERT_EQ(value.value, expected.at(key));
+  }
+  // Only the multiples of 6 were present in both
+  ASSERT_EQ(source.size(), 100);
+  for (const auto &[key, value] : source) {
+    ASSERT_EQ(key % 6, 0);
+  }
+}
+
+TEST(NodeHandleTest, MergeOfDisjointRangesJoins) {
+  TrackedMap target;
+  TrackedMap source;
+  fill(target, 0, 500);
+  fill(source, 500, 1000);
+  Tracked::copies = 0;
+
+  target.merge(std::move(source));
+  target.validate();
+  ASSERT_TRUE(source.empty());
+  ASSERT_EQ(target.size(), 1000);
+  ASSERT_EQ(Tracked::copies, 0);
+
+  TrackedMap lower;
+  fill(lower, -100, 0);
+  target.merge(lower);
+  target.validate();
+  ASSERT_TRUE(lower.empty());
+  ASSERT_EQ(target.begin()->first, -100);
+  ASSERT_EQ(target.size(), 1100);
+}
+
+TEST(NodeHandleTest, SetNodes) {
+  Set<3, std::string> first;
+  Set<3, std::string> second;
+  for (int i = 0; i < 100; ++i) {
+    first.insert(std::to_string(i));
+  }
+
+  auto node = first.extract("42");
+  ASSERT_EQ(node.key(), "42");
+  ASSERT_TRUE(second.insert(std::move(node)).inserted);
+  ASSERT_TRUE(second.contains("42"));
+  ASSERT_FALSE(first.contains("42"));
+
+  second.merge(first);
+  ASSERT_TRUE(first.empty());
+  ASSERT_EQ(second.size(), 100);
+  second.validate();
+}
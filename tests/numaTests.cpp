@@ -0,0 +1,293 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "Numa.hpp"
+#include "RandomOperations.hpp"
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Every test emulates two nodes, on a machine with one or more of them
+
+template <typename T> struct IsInternal : std::false_type {};
+template <size_t M, typename Key, typename T, typename Indexor,
+          typename Compare, typename Allocator, typename Traits,
+          size_t MAX_CHILDS, size_t MAX_KEYS>
+struct IsInternal<InternalNode<M, Key, T, Indexor, Compare, Allocator, Traits,
+                               MAX_CHILDS, MAX_KEYS>> : std::true_type {};
+
+/// @brief Internal nodes allocated on each node
+static std::array<std::atomic<int>, 2> internals{};
+
+/// @brief Internal nodes allocated on each node, freed or not
+static std::array<std::atomic<int>, 2> allocations{};
+
+/// @brief NumaAllocator counting the internal nodes it allocates per node
+template <typename T> struct RecordingAllocator : NumaAllocator<T> {
+  using value_type = T;
+
+  RecordingAllocator() = default;
+  explicit RecordingAllocator(size_t node) : NumaAllocator<T>(node) {}
+  template <typename U>
+  RecordingAllocator(const RecordingAllocator<U> &other) noexcept
+      : NumaAllocator<T>(other.node()) {}
+
+  T *allocate(size_t count) {
+    if constexpr (IsInternal<T>::value) {
+      ++internals[this->node()];
+      ++allocations[this->node()];
+    }
+    return NumaAllocator<T>::allocate(count);
+  }
+
+  void deallocate(T *pointer, size_t count) noexcept {
+    if constexpr (IsInternal<T>::value) {
+      --internals[numa::node_of(pointer)];
+    }
+    NumaAllocator<T>::deallocate(pointer, count);
+  }
+};
+
+using NumaMap = Map<8, int, int, std::less<int>,
+                    NumaAllocator<std::pair<const int, int>>>;
+using RecordingMap = Map<8, int, int, std::less<int>,
+                         RecordingAllocator<std::pair<const int, int>>>;
+
+TEST(NumaTest, AllocatorPlacesOnItsNode) {
+  numa::emulate(2);
+  ASSERT_EQ(numa::node_count(), 2);
+  numa::set_thread_node(1);
+  ASSERT_EQ(numa::current_node(), 1);
+  ASSERT_EQ(NumaAllocator<int>().node(), 1);
+  numa::set_thread_node(0);
+
+  NumaMap tree{NumaAllocator<std::pair<const int, int>>(1)};
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert({i, i});
+  }
+  for (const auto &value : tree) {
+    ASSERT_EQ(numa::node_of(&value), 1);
+  }
+
+  // Trees of different nodes still exchange nodes
+  NumaMap other{NumaAllocator<std::pair<const int, int>>(0)};
+  tree.split(500, other);
+  tree.join(other);
+  tree.validate();
+  ASSERT_EQ(tree.size(), 1000);
+}
+
+TEST(NumaTest, ReplicasCopyTheInternalNodesOnEveryNode) {
+  numa::emulate(2);
+  {
+    RecordingMap tree{RecordingAllocator<std::pair<const int, int>>(0)};
+    for (int i = 0; i < 5000; ++i) {
+      tree.insert({i, i});
+    }
+    const auto levels = tree.stats().nodes_per_level;
+    int count = 0;
+    for (size_t level = 0; level + 1 < levels.size(); ++level) {
+      count += static_cast<int>(levels[level]);
+    }
+    ASSERT_EQ(internals[0], count);
+
+    NumaReplicas<RecordingMap> replicas(tree);
+    ASSERT_EQ(replicas.size(), 2);
+    ASSERT_EQ(internals[0], 2 * count);
+    ASSERT_EQ(internals[1], count);
+
+    for (size_t node = 0; node < 2; ++node) {
+      const auto replica = replicas.on(node);
+      ASSERT_EQ(replica.size(), 5000);
+      ASSERT_TRUE(std::equal(replica.begin(), replica.end(), tree.begin(),
+                             tree.end()));
+      ASSERT_EQ(replica.find(4321)->second, 4321);
+    }
+
+    // Writes reach the replicas at once
+    tree.erase(7);
+    ASSERT_FALSE(replicas.local().contains(7));
+    tree.insert({-1, -1});
+    ASSERT_TRUE(replicas.on(1).contains(-1));
+    tree.validate();
+  }
+  // The tree and its replicas freed every internal node
+  ASSERT_EQ(internals[0], 0);
+  ASSERT_EQ(internals[1], 0);
+}
+
+TEST(NumaTest, WritesCopyOnlyTheirPaths) {
+  numa::emulate(2);
+  {
+    RecordingMap tree{RecordingAllocator<std::pair<const int, int>>(0)};
+    std::map<int, int> expected;
+    for (int i = 0; i < 20000; ++i) {
+      tree.insert({i, i});
+      expected.insert({i, i});
+    }
+    NumaReplicas<RecordingMap> replicas(tree);
+    const auto height = static_cast<int>(tree.stats().nodes_per_level.size());
+    const auto before = allocations[1].load();
+
+    // Nothing written, nothing copied
+    replicas.refresh();
+    ASSERT_EQ(allocations[1], before);
+
+    tree.erase(10);
+    expected.erase(10);
+    ASSERT_GT(allocations[1], before);
+    ASSERT_LE(allocations[1], before + 2 * height);
+    for (size_t node = 0; node < 2; ++node) {
+      const auto replica = replicas.on(node);
+      ASSERT_TRUE(std::equal(replica.begin(), replica.end(), expected.begin(),
+                             expected.end()));
+    }
+
+    // Each write copies its own path, restructuring ones their siblings too
+    for (unsigned round = 0; round < 20; ++round) {
+      const auto copied = allocations[1].load();
+      random_operations(tree, expected, 200, 30000, round);
+      ASSERT_LE(allocations[1], copied + 200 * 3 * height);
+      const auto replica = replicas.on(round % 2);
+      ASSERT_TRUE(std::equal(replica.begin(), replica.end(), expected.begin(),
+                             expected.end()));
+      for (const auto &[key, value] : expected) {
+        ASSERT_EQ(replica.find(key)->second, value);
+      }
+    }
+    tree.validate();
+  }
+  ASSERT_EQ(internals[0], 0);
+  ASSERT_EQ(internals[1], 0);
+}
+
+TEST(NumaTest, ReplicasOfSmallAndEmptyTrees) {
+  numa::emulate(2);
+  NumaMap tree;
+  NumaReplicas<NumaMap> replicas(tree);
+  ASSERT_TRUE(replicas.on(0).empty());
+  tree.insert({1, 1});
+  ASSERT_TRUE(replicas.on(1).contains(1));
+  ASSERT_EQ(replicas.on(1).size(), 1);
+
+  // Writes that split or drop the root
+  for (int i = 2; i < 1000; ++i) {
+    tree.insert({i, i});
+  }
+  ASSERT_EQ(replicas.on(0).size(), 999);
+  for (int i = 1; i < 999; ++i) {
+    tree.erase(i);
+  }
+  ASSERT_EQ(replicas.on(0).size(), 1);
+  ASSERT_TRUE(replicas.on(1).contains(999));
+  tree.clear();
+  ASSERT_TRUE(replicas.on(1).empty());
+}
+
+TEST(NumaTest, ReadsOfTheTreeDoNotCopyLeaves) {
+  numa::emulate(2);
+  NumaMap tree;
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert({i, i});
+  }
+  NumaReplicas<NumaMap> replicas(tree);
+
+  // Values written in place reach the replicas
+  const auto *value = &*tree.find(500);
+  tree.find(500)->second = -1;
+  tree.at(501) = -1;
+  ASSERT_EQ(&*tree.find(500), value);
+  ASSERT_EQ(replicas.on(0).find(500)->second, -1);
+  ASSERT_EQ(replicas.on(1).find(501)->second, -1);
+
+  // A snapshot still copies the leaf, the replicas take the copy with the
+  // next write in it
+  const auto snapshot = tree.snapshot();
+  auto it = tree.find(500);
+  auto next = tree.find(501);
+  it->second = -2;
+  next->second = -2;
+  ASSERT_NE(&*tree.find(500), value);
+  ASSERT_EQ(snapshot.find(500)->second, -1);
+  ASSERT_EQ(replicas.on(0).find(500)->second, -1);
+  tree.erase(502);
+  ASSERT_EQ(replicas.on(0).find(500)->second, -2);
+  ASSERT_EQ(replicas.on(1).find(501)->second, -2);
+  tree.validate();
+}
+
+/// @brief Allocator whose instances only compare equal with the same tag
+template <typename T> struct TaggedAllocator : std::allocator<T> {
+  TaggedAllocator() = default;
+  explicit TaggedAllocator(int tag) : tag(tag) {}
+  template <typename U>
+  TaggedAllocator(const TaggedAllocator<U> &other) noexcept : tag(other.tag) {}
+
+  template <typename U> struct rebind {
+    using other = TaggedAllocator<U>;
+  };
+
+  template <typename U>
+  bool operator==(const TaggedAllocator<U> &other) const noexcept {
+    return tag == other.tag;
+  }
+
+  int tag = 0;
+};
+
+TEST(NumaTest, ReplicaNeedsAnEqualAllocator) {
+  using Allocator = TaggedAllocator<std::pair<const int, int>>;
+  Map<4, int, int, std::less<int>, Allocator> tree{Allocator(1)};
+  tree.insert({1, 1});
+  ASSERT_THROW(static_cast<void>(tree.replica(Allocator(2))),
+               std::runtime_error);
+  ASSERT_TRUE(tree.replica(Allocator(1)).contains(1));
+}
+
+TEST(NumaTest, ConcurrentReadersOnEveryNode) {
+  numa::emulate(2);
+  NumaMap tree;
+  for (int i = 0; i < 20000; ++i) {
+    tree.insert({i, 1});
+  }
+  NumaReplicas<NumaMap> replicas(tree);
+
+  std::atomic<bool> done = false;
+  std::atomic<bool> failed = false;
+  std::vector<std::thread> readers;
+  for (size_t reader = 0; reader < 4; ++reader) {
+    readers.emplace_back([&replicas, &done, &failed, reader] {
+      numa::set_thread_node(reader % 2);
+      while (!done) {
+        const auto replica = replicas.local();
+        long sum = 0;
+        for (const auto &[key, value] : replica) {
+          sum += value;
+        }
+        // A replica may be taken between an erase and the insert after it
+        if (sum != static_cast<long>(replica.size()) ||
+            (replica.size() != 20000 && replica.size() != 19999)) {
+          failed = true;
+        }
+      }
+    });
+  }
+
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 0; i < 100; ++i) {
+      const auto key = round * 100 + i;
+      tree.erase(key);
+      tree.insert({key + 20000, 1});
+    }
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  ASSERT_FALSE(failed);
+  tree.validate();
+}
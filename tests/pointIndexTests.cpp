@@ -0,0 +1,238 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "Set.hpp"
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+static_assert(PointIndex<NoPointIndex>);
+static_assert(PointIndex<HashPointIndex<std::hash<int>>>);
+
+template <typename Key> struct IndexedTraits : DefaultTraits {
+  using point_index = HashPointIndex<std::hash<Key>>;
+};
+
+template <typename Key> struct IndexedCountedTraits : IndexedTraits<Key> {
+  using augmentation = SubtreeSize;
+};
+
+template <size_t M, typename Key, typename T = int,
+          typename Traits = IndexedTraits<Key>>
+using IndexedMap =
+    Map<M, Key, T, std::less<Key>, std::allocator<std::pair<const Key, T>>,
+        Traits>;
+
+TEST(PointIndexTest, RandomOperations) {
+  IndexedMap<4, int> tree;
+  std::map<int, int> expected;
+  std::mt19937 generator(13);
+  std::uniform_int_distribution<int> distribution(0, 5000);
+
+  for (int i = 0; i < 30000; ++i) {
+    const auto key = distribution(generator);
+    switch (i % 5) {
+    case 0:
+      ASSERT_EQ(tree.erase(key), expected.erase(key));
+      break;
+    case 1:
+      tree.extract(key);
+      expected.erase(key);
+      break;
+    case 2:
+      tree.emplace_hint(tree.lower_bound(key), key, i);
+      expected.emplace(key, i);
+      break;
+    default:
+      ASSERT_EQ(tree.insert({key, i}).second, expected.insert({key, i}).second);
+    }
+  }
+  // validate checks that the index holds exactly the stored values
+  tree.validate();
+  for (int key = -10; key < 5010; ++key) {
+    ASSERT_EQ(tree.contains(key), expected.contains(key));
+    ASSERT_EQ(tree.count(key), expected.count(key));
+    ASSERT_EQ(tree.find(key) == tree.end(), !expected.contains(key));
+  }
+}
+
+TEST(PointIndexTest, AtAndSubscript) {
+  IndexedMap<8, std::string, std::string> tree;
+  tree["one"] = "1";
+  tree["two"] = "2";
+  ASSERT_EQ(tree.at("one"), "1");
+  std::string key = "three";
+  tree[std::move(key)] += "3";
+  ASSERT_EQ(tree.size(), 3);
+  ASSERT_EQ(tree["three"], "3");
+  ASSERT_THROW(static_cast<void>(tree.at("four")), std::out_of_range);
+
+  const auto &constant = tree;
+  ASSERT_EQ(constant.at("two"), "2");
+  tree.validate();
+
+  // Without an index they descend
+  Map<4, int, int> plain;
+  plain[5] = 50;
+  ++plain[5];
+  ASSERT_EQ(plain.at(5), 51);
+  ASSERT_THROW(static_cast<void>(plain.at(6)), std::out_of_range);
+}
+
+TEST(PointIndexTest, RangeEraseSplitAndJoin) {
+  IndexedMap<5, int, int, IndexedCountedTraits<int>> tree;
+  for (int i = 0; i < 5000; ++i) {
+    tree.insert({i, i});
+  }
+  tree.erase(tree.find(1000), tree.find(2000));
+  tree.validate();
+  ASSERT_FALSE(tree.contains(1500));
+  ASSERT_TRUE(tree.contains(2000));
+
+  decltype(tree) high;
+  tree.split(3000, high);
+  tree.validate();
+  high.validate();
+  ASSERT_FALSE(tree.contains(3000));
+  ASSERT_TRUE(high.contains(3000));
+  ASSERT_EQ(high.at(4999), 4999);
+
+  tree.join(high);
+  tree.validate();
+  high.validate();
+  ASSERT_TRUE(high.empty());
+  ASSERT_EQ(tree.at(4999), 4999);
+  ASSERT_EQ(tree.size(), 4000);
+
+  decltype(tree) other;
+  for (int i = 10000; i < 10100; ++i) {
+    other.insert({i, i});
+  }
+  other.insert({0, -1});
+  tree.merge(other);
+  tree.validate();
+  other.validate();
+  ASSERT_EQ(tree.at(10050), 10050);
+  ASSERT_EQ(tree.at(0), 0);
+  ASSERT_EQ(other.at(0), -1);
+}
+
+TEST(PointIndexTest, CopiesMovesAndSnapshots) {
+  IndexedMap<4, int> tree;
+  for (int i = 0; i < 3000; ++i) {
+    tree.insert({i, i});
+  }
+  auto copy = tree;
+  copy.validate();
+  ASSERT_NE(&copy.at(7), &tree.at(7));
+
+  auto moved = std::move(copy);
+  moved.validate();
+  copy.validate();
+  ASSERT_FALSE(copy.contains(7));
+  ASSERT_TRUE(moved.contains(7));
+
+  auto snapshot = tree.snapshot();
+  // Writes copy the shared leaves, the index follows the copied values
+  tree.erase(100);
+  tree.at(2999) = -1;
+  tree.insert({5000, 0});
+  tree.validate();
+  ASSERT_EQ(snapshot.find(2999)->second, 2999);
+  auto *mapped = &tree.at(50);
+  ASSERT_EQ(mapped, &tree.find(50)->second);
+  ASSERT_NE(mapped, &snapshot.find(50)->second);
+
+  tree.swap(moved);
+  tree.validate();
+  moved.validate();
+  ASSERT_TRUE(moved.contains(5000));
+  tree.clear();
+  tree.validate();
+  ASSERT_FALSE(tree.contains(1));
+}
+
+TEST(PointIndexTest, SetAlgebraAndSets) {
+  using Indexed = Set<8, int, std::less<int>, std::allocator<int>,
+                      IndexedTraits<int>>;
+  Indexed evens;
+  Indexed triples;
+  for (int i = 0; i < 1000; ++i) {
+    evens.insert(i * 2);
+    triples.insert(i * 3);
+  }
+  auto both = evens.intersect(triples);
+  both.validate();
+  ASSERT_TRUE(both.contains(6));
+  ASSERT_FALSE(both.contains(4));
+
+  auto all = evens.merge_union(triples);
+  all.validate();
+  ASSERT_EQ(all.count(2997), 1);
+  ASSERT_EQ(all.count(2999), 0);
+}
+
+/// @brief Hash of std::string_view throwing for one key
+struct ThrowingHash {
+  using is_transparent = void;
+  static inline std::string poisoned;
+
+  size_t operator()(std::string_view key) const {
+    if (key == poisoned) {
+      throw std::runtime_error("index full");
+    }
+    return std::hash<std::string_view>{}(key);
+  }
+};
+
+struct ThrowingIndexTraits : DefaultTraits {
+  using point_index = HashPointIndex<ThrowingHash>;
+};
+
+TEST(PointIndexTest, ThrowingIndexLeavesTreeAndNodeUnchanged) {
+  using Tree = IndexedMap<4, std::string, int, ThrowingIndexTraits>;
+  Tree tree;
+  Tree source;
+  for (int i = 0; i < 200; ++i) {
+    tree.insert({std::to_string(i), i});
+  }
+  source.insert({"x", 1});
+  auto node = source.extract("x");
+  const auto *address = &node.value();
+  ThrowingHash::poisoned = "x";
+
+  ASSERT_THROW(tree.insert(std::move(node)), std::runtime_error);
+  ASSERT_FALSE(node.empty());
+  ASSERT_EQ(&node.value(), address);
+  ASSERT_THROW(tree.insert(tree.end(), std::move(node)), std::runtime_error);
+  ASSERT_FALSE(node.empty());
+  ASSERT_THROW(tree.insert({"x", 2}), std::runtime_error);
+  ASSERT_EQ(tree.size(), 200);
+  tree.validate();
+
+  ThrowingHash::poisoned.clear();
+  ASSERT_TRUE(tree.insert(std::move(node)).inserted);
+  ASSERT_EQ(&tree.at("x"), &address->second);
+  tree.validate();
+}
+
+TEST(PointIndexTest, TransparentLookupsUseTheIndex) {
+  using Tree = Map<8, std::string, int, std::less<>,
+                   std::allocator<std::pair<const std::string, int>>,
+                   ThrowingIndexTraits>;
+  Tree tree;
+  for (int i = 0; i < 500; ++i) {
+    tree.insert({std::to_string(i), i});
+  }
+  ASSERT_TRUE(tree.contains(std::string_view("42")));
+  ASSERT_FALSE(tree.contains(std::string_view("-1")));
+  ASSERT_EQ(tree.find(std::string_view("7"))->second, 7);
+  // Only the index hashes, so a poisoned key reaches it
+  ThrowingHash::poisoned = "13";
+  ASSERT_THROW(static_cast<void>(tree.contains(std::string_view("13"))),
+               std::runtime_error);
+  ThrowingHash::poisoned.clear();
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "RandomOperations.hpp"
+#include "Relocate.hpp"
+
+#include <array>
+#include <string>
+
+static_assert(TriviallyRelocatable<int>);
+static_assert(TriviallyRelocatable<std::pair<const int, double> *>);
+static_assert(!TriviallyRelocatable<std::string>);
+
+/// @brief Allocator counting the calls to its destroy member
+template <typename T> struct DestroyCountingAllocator {
+  using value_type = T;
+
+  static inline size_t destroyed = 0;
+
+  DestroyCountingAllocator() = default;
+  template <typename U>
+  DestroyCountingAllocator(
+      const DestroyCountingAllocator<U> & /*other*/) noexcept {}
+
+  T *allocate(size_t count) { return std::allocator<T>{}.allocate(count); }
+  void deallocate(T *pointer, size_t count) noexcept {
+    std::allocator<T>{}.deallocate(pointer, count);
+  }
+
+  template <typename U> void destroy(U *pointer) {
+    ++destroyed;
+    pointer->~U();
+  }
+
+  template <typename U>
+  bool
+  operator==(const DestroyCountingAllocator<U> & /*other*/) const noexcept {
+    return true;
+  }
+};
+
+template <typename Tree> static void random_relocations() {
+  Tree tree;
+  Expected<Tree> expected;
+  random_operations(tree, expected, 20000, 20000, 11);
+  expect_same(tree, expected);
+
+  tree.clear();
+  ASSERT_TRUE(tree.empty());
+}
+
+TEST(RelocationTest, OverlappingRanges) {
+  std::array<int, 8> ints{0, 1, 2, 3, 4, 5, 6, 7};
+  relocate_backward(ints.begin(), ints.begin() + 5, ints.begin() + 7);
+  ASSERT_EQ(ints, (std::array<int, 8>{0, 1, 0, 1, 2, 3, 4, 7}));
+  relocate(ints.begin() + 2, ints.begin() + 7, ints.begin());
+  ASSERT_EQ(ints, (std::array<int, 8>{0, 1, 2, 3, 4, 3, 4, 7}));
+
+  std::array<std::string, 4> strings{"a", "b", "c", "d"};
+  relocate_backward(strings.begin(), strings.begin() + 3, strings.end());
+  ASSERT_EQ(strings[1], "a");
+  ASSERT_EQ(strings[3], "c");
+  relocate(strings.begin() + 1, strings.end(), strings.begin());
+  ASSERT_EQ(strings[0], "a");
+  ASSERT_EQ(strings[2], "c");
+}
+
+TEST(RelocationTest, EmptyRanges) {
+  std::array<int, 2> ints{1, 2};
+  ASSERT_EQ(relocate(ints.begin(), ints.begin(), ints.begin() + 1),
+            ints.begin() + 1);
+  ASSERT_EQ(relocate_backward(ints.end(), ints.end(), ints.begin()),
+            ints.begin());
+  ASSERT_EQ(ints, (std::array<int, 2>{1, 2}));
+}
+
+TEST(RelocationTest, TrivialKeysInWideNodes) {
+  random_relocations<Map<128, int, int>>();
+  random_relocations<Map<5, int, int>>();
+}
+
+TEST(RelocationTest, NonTrivialKeysInWideNodes) {
+  random_relocations<Map<128, std::string, int>>();
+  random_relocations<Map<5, std::string, int>>();
+}
+
+TEST(RelocationTest, CustomDestroyIsStillCalled) {
+  using Allocator = DestroyCountingAllocator<std::pair<const int, int>>;
+  {
+    Map<4, int, int, std::less<int>, Allocator> tree;
+    for (int i = 0; i < 100; ++i) {
+      tree.insert({i, i});
+    }
+    Allocator::destroyed = 0;
+    tree.erase(50);
+    ASSERT_EQ(Allocator::destroyed, 1);
+    tree.clear();
+  }
+  // The nodes are destroyed through allocators rebound to their own types
+  ASSERT_EQ(Allocator::destroyed, 100);
+}
+
+TEST(RelocationTest, CopiesOfTrivialValues) {
+  Map<8, int, double> tree;
+  for (int i = 0; i < 5000; ++i) {
+    tree.insert({i * 7 % 5000, i * 0.5});
+  }
+  auto copy = tree;
+  copy.validate();
+  ASSERT_TRUE(std::equal(copy.cbegin(), copy.cend(), tree.cbegin(),
+                         tree.cend()));
+
+  // Writes copy the leaves shared with a snapshot the same way
+  auto snapshot = copy.snapshot();
+  for (int i = 0; i < 5000; i += 10) {
+    copy.erase(i);
+  }
+  ASSERT_TRUE(std::equal(snapshot.begin(), snapshot.end(), tree.cbegin(),
+                         tree.cend()));
+  ASSERT_EQ(copy.size(), 4500);
+  copy.validate();
+}
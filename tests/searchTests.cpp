@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "RandomOperations.hpp"
+#include "Search.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+static_assert(NodeSearch<LinearSearch>);
+static_assert(NodeSearch<BranchlessSearch>);
+static_assert(NodeSearch<CountingSearch>);
+static_assert(NodeSearch<InterpolationSearch>);
+
+/// @brief Runs searches over count keys, with key_at(i) as the key at i
+template <typename Search, typename KeyAt>
+static void expect_partition_points(KeyAt key_at, bool exact) {
+  for (size_t count = 0; count <= 70; ++count) {
+    for (size_t point = 0; point <= count; ++point) {
+      size_t calls = 0;
+      const auto key = point < count ? key_at(point) : key_at(count) + 1;
+      const auto found = Search::partition_point(
+          count,
+          [&](size_t index) {
+            EXPECT_LT(index, count);
+            ++calls;
+            return index < point;
+          },
+          key_at, key);
+      ASSERT_EQ(found, point) << "count " << count;
+      if (exact) {
+        ASSERT_EQ(calls, Search::comparisons(found, count))
+            << "count " << count;
+      } else {
+        ASSERT_LE(calls, Search::comparisons(found, count))
+            << "count " << count;
+      }
+    }
+  }
+}
+
+template <typename Search> static void expect_partition_points() {
+  expect_partition_points<Search>([](size_t index) { return int(index); },
+                                  true);
+}
+
+TEST(SearchTest, LinearPartitionPoints) {
+  expect_partition_points<LinearSearch>();
+}
+
+TEST(SearchTest, BranchlessPartitionPoints) {
+  expect_partition_points<BranchlessSearch>();
+}
+
+TEST(SearchTest, CountingPartitionPoints) {
+  expect_partition_points<CountingSearch>();
+}
+
+TEST(SearchTest, InterpolationPartitionPoints) {
+  // Uniform, skewed and flat keys, the prediction is right or far off
+  expect_partition_points<InterpolationSearch>(
+      [](size_t index) { return int(index) * 3; }, false);
+  expect_partition_points<InterpolationSearch>(
+      [](size_t index) { return int(index * index * index); }, false);
+  expect_partition_points<InterpolationSearch>(
+      [](size_t index) { return index < 60 ? 0.5 : 1e9 + double(index); },
+      false);
+}
+
+TEST(SearchTest, InterpolationOfUniformKeys) {
+  size_t calls = 0;
+  const auto found = InterpolationSearch::partition_point(
+      512,
+      [&](size_t index) {
+        ++calls;
+        return index * 10 < 3001;
+      },
+      [](size_t index) { return long(index * 10); }, 3001L);
+  ASSERT_EQ(found, 301);
+  ASSERT_LE(calls, 3);
+}
+
+template <typename Search> struct SearchTraits : DefaultTraits {
+  using node_search = Search;
+  static constexpr bool collect_stats = true;
+};
+
+template <size_t M, typename Key, typename Search>
+using SearchMap = Map<M, Key, int, std::less<Key>,
+                      std::allocator<std::pair<const Key, int>>,
+                      SearchTraits<Search>>;
+
+template <typename Tree> static void random_bounds() {
+  using key_type = typename Tree::key_type;
+  Tree tree;
+  Expected<Tree> expected;
+  random_operations(tree, expected, 30000, 30000, 5);
+  expect_same(tree, expected);
+
+  std::mt19937 generator(6);
+  std::uniform_int_distribution<int> distribution(0, 30000);
+  for (int i = 0; i < 2000; ++i) {
+    const auto key = make_key<key_type>(distribution(generator));
+    auto it = tree.lower_bound(key);
+    auto other = expected.lower_bound(key);
+    ASSERT_EQ(it == tree.end(), other == expected.end());
+    if (other != expected.end()) {
+      ASSERT_EQ(it->first, other->first);
+    }
+    ASSERT_EQ(tree.upper_bound(key) == tree.end(),
+              expected.upper_bound(key) == expected.end());
+  }
+}
+
+TEST(SearchTest, BranchlessTrees) {
+  random_bounds<SearchMap<3, int, BranchlessSearch>>();
+  random_bounds<SearchMap<128, int, BranchlessSearch>>();
+  random_bounds<SearchMap<512, int, BranchlessSearch>>();
+  random_bounds<SearchMap<128, std::string, BranchlessSearch>>();
+}
+
+TEST(SearchTest, CountingTrees) {
+  random_bounds<SearchMap<4, int, CountingSearch>>();
+  random_bounds<SearchMap<256, int, CountingSearch>>();
+  random_bounds<SearchMap<64, std::string, CountingSearch>>();
+}
+
+TEST(SearchTest, InterpolationTrees) {
+  random_bounds<SearchMap<3, int, InterpolationSearch>>();
+  random_bounds<SearchMap<256, int, InterpolationSearch>>();
+  random_bounds<SearchMap<64, std::string, InterpolationSearch>>();
+
+  SearchMap<128, double, InterpolationSearch> reals;
+  std::mt19937 generator(9);
+  std::exponential_distribution<double> distribution(0.01);
+  std::map<double, int> expected;
+  for (int i = 0; i < 20000; ++i) {
+    const auto key = distribution(generator);
+    reals.insert({key, i});
+    expected.insert({key, i});
+  }
+  reals.validate();
+  for (const auto &[key, value] : expected) {
+    ASSERT_EQ(reals.find(key)->second, value);
+  }
+  ASSERT_EQ(reals.find(-1.0), reals.end());
+  ASSERT_EQ(reals.lower_bound(1e9), reals.end());
+}
+
+TEST(SearchTest, BinarySearchComparesLess) {
+  SearchMap<256, int, LinearSearch> linear;
+  SearchMap<256, int, BranchlessSearch> branchless;
+  for (int i = 0; i < 100000; ++i) {
+    linear.insert({i, i});
+    branchless.insert({i, i});
+  }
+  linear.reset_stats();
+  branchless.reset_stats();
+  for (int i = 0; i < 100000; i += 7) {
+    ASSERT_TRUE(linear.contains(i));
+    ASSERT_TRUE(branchless.contains(i));
+  }
+  ASSERT_LT(branchless.stats().lookup_comparisons * 4,
+            linear.stats().lookup_comparisons);
+}
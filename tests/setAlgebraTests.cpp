@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "Set.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+struct CountedTraits : DefaultTraits {
+  using augmentation = SubtreeSize;
+};
+
+static std::set<int> random_keys(int count, int range, unsigned seed) {
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<int> distribution(0, range);
+  std::set<int> keys;
+  while (keys.size() < static_cast<size_t>(count)) {
+    keys.insert(distribution(generator));
+  }
+  return keys;
+}
+
+template <typename Tree>
+static void expect_keys(const Tree &tree, const std::vector<int> &expected) {
+  ASSERT_EQ(tree.size(), expected.size());
+  std::vector<int> keys;
+  for (const auto &value : tree) {
+    keys.push_back(value.first);
+  }
+  ASSERT_EQ(keys, expected);
+  std::vector<int> reversed;
+  for (auto it = tree.rbegin(); it != tree.rend(); ++it) {
+    reversed.push_back(it->first);
+  }
+  ASSERT_TRUE(std::equal(reversed.rbegin(), reversed.rend(), expected.begin(),
+                         expected.end()));
+}
+
+template <size_t M> static void compare_with_std(int first_count,
+                                                 int second_count, int range) {
+  auto first_keys = random_keys(first_count, range, 1);
+  auto second_keys = random_keys(second_count, range, 2);
+  Set<M, int> first;
+  Set<M, int> second;
+  for (auto key : first_keys) {
+    first.insert(key);
+  }
+  for (auto key : second_keys) {
+    second.insert(key);
+  }
+
+  std::vector<int> expected;
+  std::set_union(first_keys.begin(), first_keys.end(), second_keys.begin(),
+                 second_keys.end(), std::back_inserter(expected));
+  expect_keys(first.merge_union(second), expected);
+
+  expected.clear();
+  std::set_intersection(first_keys.begin(), first_keys.end(),
+                        second_keys.begin(), second_keys.end(),
+                        std::back_inserter(expected));
+  expect_keys(first.intersect(second), expected);
+
+  expected.clear();
+  std::set_difference(first_keys.begin(), first_keys.end(),
+                      second_keys.begin(), second_keys.end(),
+                      std::back_inserter(expected));
+  auto difference = first.difference(second);
+  expect_keys(difference, expected);
+
+  // The bulk built tree is a regular tree
+  for (auto key : second_keys) {
+    difference.insert(key);
+  }
+  for (auto key : first_keys) {
+    difference.erase(key);
+  }
+  expected.clear();
+  std::set_difference(second_keys.begin(), second_keys.end(),
+                      first_keys.begin(), first_keys.end(),
+                      std::back_inserter(expected));
+  expect_keys(difference, expected);
+}
+
+TEST(SetAlgebraTest, MatchesStd) {
+  compare_with_std<3>(500, 700, 2000);
+  compare_with_std<4>(3000, 20, 100000);
+  compare_with_std<8>(20, 3000, 100000);
+  compare_with_std<16>(4000, 4000, 6000);
+  compare_with_std<5>(0, 100, 1000);
+  compare_with_std<5>(100, 0, 1000);
+}
+
+TEST(SetAlgebraTest, MapValuesFromFirst) {
+  Map<4, int, int> first;
+  Map<4, int, int> second;
+  for (int key = 0; key < 300; ++key) {
+    first.insert({key * 2, 1});
+    second.insert({key * 3, 2});
+  }
+
+  auto both = first.merge_union(second);
+  for (const auto &[key, value] : both) {
+    ASSERT_EQ(value, key % 2 == 0 && key < 600 ? 1 : 2);
+  }
+  for (const auto &[key, value] : first.intersect(second)) {
+    ASSERT_EQ(key % 6, 0);
+    ASSERT_EQ(value, 1);
+  }
+}
+
+TEST(SetAlgebraTest, KeepsAggregates) {
+  Map<4, int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+      CountedTraits>
+      first;
+  decltype(first) second;
+  for (int key = 0; key < 1000; ++key) {
+    first.insert({key, key});
+    second.insert({key + 500, key});
+  }
+  auto result = first.difference(second);
+  ASSERT_EQ(result.size(), 500);
+  for (size_t index = 0; index < 500; ++index) {
+    ASSERT_EQ(result.select(index)->first, static_cast<int>(index));
+  }
+  ASSERT_EQ(result.count(100, 200), 100);
+}
+
+/// @brief Key whose copies throw once the countdown reaches 0
+struct FragileKey {
+  static inline int live = 0;
+  static inline int countdown = -1;
+
+  FragileKey() : FragileKey(0) {}
+  explicit FragileKey(int value) : value(value) { ++live; }
+  FragileKey(const FragileKey &other) : value(other.value) {
+    tick();
+    ++live;
+  }
+  FragileKey &operator=(const FragileKey &other) {
+    tick();
+    value = other.value;
+    return *this;
+  }
+  ~FragileKey() { --live; }
+
+  static void tick() {
+    if (countdown >= 0 && countdown-- == 0) {
+      throw std::runtime_error("copy failed");
+    }
+  }
+  bool operator<(const FragileKey &other) const { return value < other.value; }
+
+  int value;
+};
+
+TEST(SetAlgebraTest, FailuresLeakNothing) {
+  Set<4, FragileKey> first;
+  Set<4, FragileKey> second;
+  for (int key = 0; key < 200; ++key) {
+    first.insert(FragileKey(key * 2));
+    second.insert(FragileKey(key * 3));
+  }
+
+  // Every copy fails in turn, of the values and of the separator keys
+  const auto live = FragileKey::live;
+  bool failed = true;
+  for (int countdown = 0; failed; ++countdown) {
+    FragileKey::countdown = countdown;
+    try {
+      auto result = first.merge_union(second);
+      FragileKey::countdown = -1;
+      ASSERT_EQ(result.size(), 333);
+      result.validate();
+      failed = false;
+    } catch (const std::runtime_error &) {
+      FragileKey::countdown = -1;
+      ASSERT_EQ(FragileKey::live, live);
+    }
+  }
+  ASSERT_EQ(FragileKey::live, live);
+}
@@ -0,0 +1,401 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+#include "RandomOperations.hpp"
+#include "Set.hpp"
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @brief Value counting its live instances
+struct Counted {
+  static inline int live = 0;
+
+  explicit Counted(int value) : value(value) { ++live; }
+  Counted(const Counted &other) : value(other.value) { ++live; }
+  Counted &operator=(const Counted &) = default;
+  ~Counted() { --live; }
+
+  int value;
+};
+
+struct CountedTraits : DefaultTraits {
+  using augmentation = SubtreeSize;
+};
+
+struct StatsTraits : DefaultTraits {
+  static constexpr bool collect_stats = true;
+};
+
+template <typename Snapshot, typename Expected>
+static void expect_equal(const Snapshot &snapshot, const Expected &expected) {
+  ASSERT_EQ(snapshot.size(), expected.size());
+  ASSERT_TRUE(std::equal(snapshot.begin(), snapshot.end(), expected.begin(),
+                         expected.end()));
+}
+
+TEST(SnapshotTest, WritesAreNotSeen) {
+  Map<4, int, int> tree;
+  std::map<int, int> expected;
+  for (int i = 0; i < 5000; ++i) {
+    tree.insert({i, i});
+    expected.insert({i, i});
+  }
+
+  auto snapshot = tree.snapshot();
+  for (int i = 0; i < 5000; i += 2) {
+    tree.erase(i);
+  }
+  for (int i = 5000; i < 7000; ++i) {
+    tree.insert({i, -i});
+  }
+  tree.try_emplace(-1, -1);
+  tree.extract(4999);
+
+  tree.validate();
+  ASSERT_EQ(tree.size(), 2500 + 2000);
+  ASSERT_EQ(tree.begin()->first, -1);
+  expect_equal(snapshot, expected);
+  ASSERT_TRUE(snapshot.contains(0));
+  ASSERT_FALSE(snapshot.contains(5000));
+  ASSERT_EQ(snapshot.find(4999)->second, 4999);
+  ASSERT_EQ(snapshot.find(-1), snapshot.end());
+}
+
+TEST(SnapshotTest, OnlyThePathIsCopied) {
+  Map<8, int, int> tree;
+  for (int i = 0; i < 10000; ++i) {
+    tree.insert({i, i});
+  }
+  auto snapshot = tree.snapshot();
+  // The const lookups keep the nodes shared
+  const auto &view = tree;
+  ASSERT_EQ(&*view.find(9000), &*snapshot.find(9000));
+
+  tree.insert({10000, 0});
+  tree.erase(5000);
+  // Far away values still live in the shared leaves
+  ASSERT_EQ(&*view.find(10), &*snapshot.find(10));
+  ASSERT_NE(&*view.find(9999), &*snapshot.find(9999));
+  ASSERT_EQ(snapshot.find(5000)->second, 5000);
+  tree.validate();
+}
+
+TEST(SnapshotTest, WritesThroughIteratorsAreNotSeen) {
+  Map<4, int, int> tree;
+  std::map<int, int> expected;
+  for (int i = 0; i < 2000; ++i) {
+    tree.insert({i, i});
+    expected.insert({i, i});
+  }
+  auto snapshot = tree.snapshot();
+  tree.find(10)->second = -1;
+  tree.begin()->second = -1;
+  std::prev(tree.end())->second = -1;
+  for (auto it = tree.lower_bound(500); it != tree.upper_bound(1500); ++it) {
+    it->second = -1;
+  }
+  tree.equal_range(1700).first->second = -1;
+  tree.validate();
+  expect_equal(snapshot, expected);
+  ASSERT_EQ(tree.at(10), -1);
+  ASSERT_EQ(tree.at(1999), -1);
+  ASSERT_EQ(tree.at(1000), -1);
+
+  // A later snapshot shares the nodes copied for the first one
+  auto second = tree.snapshot();
+  for (auto &[key, value] : tree) {
+    value = key * 2;
+  }
+  ASSERT_EQ(second.find(10)->second, -1);
+  ASSERT_EQ(second.find(11)->second, 11);
+  expect_equal(snapshot, expected);
+}
+
+TEST(SnapshotTest, WritesThroughReturnedIteratorsAreNotSeen) {
+  Map<4, int, int> tree;
+  std::map<int, int> expected;
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert({i, i});
+    expected.insert({i, i});
+  }
+  auto snapshot = tree.snapshot();
+  auto [it, inserted] = tree.insert({1, -1});
+  ASSERT_FALSE(inserted);
+  for (int i = 0; i < 500; ++i) {
+    ++it;
+    it->second = 777;
+  }
+  auto emplaced = tree.try_emplace(-1, -1).first;
+  std::next(emplaced, 2)->second = 777;
+  tree.validate();
+  expect_equal(snapshot, expected);
+  ASSERT_EQ(tree.at(2), 777);
+  ASSERT_EQ(tree.at(501), 777);
+
+  auto second = tree.snapshot();
+  auto after = tree.erase(tree.find(600));
+  ASSERT_EQ(after->first, 601);
+  for (; after != tree.end(); ++after) {
+    after->second = -2;
+  }
+  for (int i = 0; i < 100; ++i) {
+    (--after)->second = -3;
+  }
+  tree.erase(tree.find(100), tree.find(200))->second = -4;
+  tree.validate();
+  expect_equal(snapshot, expected);
+  ASSERT_EQ(second.size(), 1001);
+  ASSERT_EQ(second.find(200)->second, 777);
+  ASSERT_EQ(second.find(700)->second, 700);
+  ASSERT_EQ(second.find(999)->second, 999);
+  ASSERT_EQ(tree.at(200), -4);
+  ASSERT_EQ(tree.at(700), -2);
+  ASSERT_EQ(tree.at(999), -3);
+}
+
+TEST(SnapshotTest, LookupsCopyOnlyTheirLeaf) {
+  Map<4, int, Counted> tree;
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert({i, Counted(i)});
+  }
+  auto snapshot = tree.snapshot();
+  const auto live = Counted::live;
+  tree.find(42)->second.value = -1;
+  tree.lower_bound(500)->second.value = -1;
+  tree.begin()->second.value = -1;
+  std::prev(tree.end())->second.value = -1;
+  // A leaf holds at most 3 values
+  ASSERT_LE(Counted::live, live + 4 * 3);
+  ASSERT_EQ(snapshot.find(42)->second.value, 42);
+  ASSERT_EQ(snapshot.find(999)->second.value, 999);
+  ASSERT_EQ(tree.at(0).value, -1);
+  ASSERT_EQ(tree.at(999).value, -1);
+  tree.validate();
+}
+
+TEST(SnapshotTest, RangeErasureCopiesOnlyItsEnds) {
+  Map<4, int, Counted> tree;
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert({i, Counted(i)});
+  }
+  auto snapshot = tree.snapshot();
+  const auto live = Counted::live;
+  tree.erase(tree.find(100), tree.find(900));
+  // The leaves at both ends and the siblings they are joined with
+  ASSERT_LE(Counted::live, live + 8 * 3);
+  ASSERT_EQ(tree.size(), 200);
+  ASSERT_EQ(snapshot.size(), 1000);
+  ASSERT_EQ(snapshot.find(500)->second.value, 500);
+  tree.validate();
+  snapshot = {};
+  ASSERT_EQ(Counted::live, 200);
+}
+
+TEST(SnapshotTest, SplitAndJoinCopyOnlyTheirPaths) {
+  Map<4, int, Counted> tree;
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert({i, Counted(i)});
+  }
+  auto snapshot = tree.snapshot();
+  const auto live = Counted::live;
+  Map<4, int, Counted> other;
+  tree.split(500, other);
+  // The leaf at the cut and the siblings it is joined with
+  ASSERT_LE(Counted::live, live + 8 * 3);
+  ASSERT_EQ(tree.size(), 500);
+  ASSERT_EQ(other.size(), 500);
+  tree.validate();
+  other.validate();
+
+  // The nodes of other stay shared with the snapshot of tree
+  other.insert({1000, Counted(1000)});
+  other.join(tree);
+  ASSERT_LE(Counted::live, live + 8 * 8);
+  ASSERT_EQ(other.size(), 1001);
+  ASSERT_TRUE(tree.empty());
+  other.validate();
+  ASSERT_EQ(snapshot.size(), 1000);
+  ASSERT_EQ(snapshot.find(500)->second.value, 500);
+  ASSERT_EQ(snapshot.find(1000), snapshot.end());
+  snapshot = {};
+  other.insert({1001, Counted(1001)});
+  ASSERT_EQ(Counted::live, 1002);
+}
+
+TEST(SnapshotTest, SharingEndsWithTheLastSnapshot) {
+  Map<8, int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+      StatsTraits>
+      tree;
+  for (int i = 0; i < 100; ++i) {
+    tree.insert({i, i});
+  }
+  const auto hits = [&tree] { return tree.stats().hint_hits; };
+
+  // Hinted insertions skip the descent only into unshared leaves
+  auto snapshot = tree.snapshot();
+  auto copy = snapshot;
+  tree.emplace_hint(tree.cend(), 100, 100);
+  ASSERT_EQ(hits(), 0);
+  snapshot = {};
+  tree.emplace_hint(tree.cend(), 101, 101);
+  ASSERT_EQ(hits(), 0);
+  copy = {};
+  tree.emplace_hint(tree.cend(), 102, 102);
+  ASSERT_EQ(hits(), 1);
+
+  // Moved trees keep counting the snapshots of their nodes
+  snapshot = tree.snapshot();
+  auto moved = std::move(tree);
+  const auto moved_hits = moved.stats().hint_hits;
+  moved.emplace_hint(moved.cend(), 103, 103);
+  ASSERT_EQ(moved.stats().hint_hits, moved_hits);
+  snapshot = {};
+  moved.emplace_hint(moved.cend(), 104, 104);
+  ASSERT_EQ(moved.stats().hint_hits, moved_hits + 1);
+  moved.validate();
+  ASSERT_EQ(moved.size(), 105);
+}
+
+TEST(SnapshotTest, Bounds) {
+  Set<5, int> set;
+  for (int i = 0; i < 1000; i += 10) {
+    set.insert(i);
+  }
+  const auto snapshot = set.snapshot();
+  set.clear();
+
+  ASSERT_EQ(snapshot.lower_bound(15)->first, 20);
+  ASSERT_EQ(snapshot.lower_bound(20)->first, 20);
+  ASSERT_EQ(snapshot.upper_bound(20)->first, 30);
+  ASSERT_EQ(snapshot.lower_bound(991), snapshot.end());
+  ASSERT_EQ(snapshot.upper_bound(-5)->first, 0);
+  ASSERT_EQ(snapshot.count(990), 1);
+  ASSERT_EQ(std::distance(snapshot.lower_bound(500), snapshot.end()), 50);
+
+  const Map<4, int, int>::Snapshot empty;
+  ASSERT_TRUE(empty.empty());
+  ASSERT_EQ(empty.begin(), empty.end());
+  ASSERT_FALSE(empty.contains(1));
+}
+
+TEST(SnapshotTest, SnapshotsOfEveryVersion) {
+  Map<3, int, int> tree;
+  std::map<int, int> expected;
+  std::vector<Map<3, int, int>::Snapshot> snapshots;
+  std::vector<std::map<int, int>> versions;
+
+  for (unsigned round = 0; round < 20; ++round) {
+    random_operations(tree, expected, 200, 500, round);
+    snapshots.push_back(tree.snapshot());
+    versions.push_back(expected);
+  }
+
+  tree.validate();
+  for (size_t i = 0; i < snapshots.size(); ++i) {
+    expect_equal(snapshots[i], versions[i]);
+  }
+}
+
+TEST(SnapshotTest, RestructuringWrites) {
+  Map<4, int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+      CountedTraits>
+      tree;
+  std::map<int, int> expected;
+  for (int i = 0; i < 3000; ++i) {
+    tree.insert({i, i});
+    expected.insert({i, i});
+  }
+  auto snapshot = tree.snapshot();
+
+  decltype(tree) high;
+  tree.split(2000, high);
+  tree.erase(tree.find(100), tree.find(900));
+  tree.join(high);
+  ASSERT_EQ(tree.size(), 2200);
+  ASSERT_EQ(tree.rank(1500), 700);
+  tree.validate();
+  expect_equal(snapshot, expected);
+
+  auto copy = tree;
+  copy.validate();
+  tree.clear();
+  expect_equal(snapshot, expected);
+}
+
+TEST(SnapshotTest, NothingLeaks) {
+  {
+    Map<4, int, Counted> tree;
+    for (int i = 0; i < 1000; ++i) {
+      tree.insert({i, Counted(i)});
+    }
+    const auto live = Counted::live;
+    {
+      auto snapshot = tree.snapshot();
+      for (int i = 0; i < 1000; i += 3) {
+        tree.erase(i);
+      }
+      ASSERT_GT(Counted::live, live - 334);
+      ASSERT_EQ(snapshot.size(), 1000);
+    }
+    // The copied leaves were freed with the snapshot
+    ASSERT_EQ(Counted::live, live - 334);
+
+    auto snapshot = tree.snapshot();
+    tree.insert({-1, Counted(-1)});
+    Map<4, int, Counted> moved(std::move(tree));
+    moved.insert({-2, Counted(-2)});
+    ASSERT_EQ(snapshot.size(), 666);
+  }
+  ASSERT_EQ(Counted::live, 0);
+}
+
+TEST(SnapshotTest, SnapshotOutlivesTheTree) {
+  Map<4, int, std::string>::Snapshot snapshot;
+  {
+    Map<4, int, std::string> tree;
+    for (int i = 0; i < 500; ++i) {
+      tree.insert({i, std::to_string(i)});
+    }
+    snapshot = tree.snapshot();
+    tree.erase(7);
+  }
+  ASSERT_EQ(snapshot.size(), 500);
+  ASSERT_EQ(snapshot.find(7)->second, "7");
+}
+
+TEST(SnapshotTest, ConcurrentReaders) {
+  Map<16, int, int> tree;
+  for (int i = 0; i < 20000; ++i) {
+    tree.insert({i, 1});
+  }
+
+  std::atomic<bool> failed = false;
+  std::vector<std::thread> readers;
+  for (int reader = 0; reader < 4; ++reader) {
+    readers.emplace_back([snapshot = tree.snapshot(), &failed] {
+      for (int pass = 0; pass < 5; ++pass) {
+        long sum = 0;
+        for (const auto &[key, value] : snapshot) {
+          sum += value;
+        }
+        if (sum != 20000 || !snapshot.contains(19999)) {
+          failed = true;
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < 20000; ++i) {
+    tree.erase(i);
+    tree.insert({i + 20000, 2});
+  }
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  ASSERT_FALSE(failed);
+  tree.validate();
+}
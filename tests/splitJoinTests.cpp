@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <stdexcept>
+
+struct CountedTraits : DefaultTraits {
+  using augmentation = SubtreeSize;
+};
+
+struct IndexedTraits : DefaultTraits {
+  using point_index = HashPointIndex<std::hash<int>>;
+};
+
+template <size_t M, typename Traits = DefaultTraits>
+using TraitsMap =
+    Map<M, int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+        Traits>;
+
+template <typename Tree>
+static void expect_range(const Tree &tree, int low, int high) {
+  ASSERT_EQ(tree.size(), static_cast<size_t>(high - low));
+  int expected = low;
+  for (const auto &[key, value] : tree) {
+    ASSERT_EQ(key, expected);
+    ASSERT_EQ(value, expected);
+    ++expected;
+  }
+  ASSERT_EQ(expected, high);
+  if (!tree.empty()) {
+    ASSERT_EQ(std::prev(tree.end())->first, high - 1);
+    ASSERT_EQ(tree.rbegin()->first, high - 1);
+  }
+}
+
+template <typename Tree> static void split_everywhere(int count) {
+  for (int at = -1; at <= count + 1; at += 1 + count / 37) {
+    Tree lower;
+    for (int key = 0; key < count; ++key) {
+      lower.insert({key, key});
+    }
+    Tree upper;
+    upper.insert({-100, 0});
+    lower.split(at, upper);
+
+    const int seam = std::clamp(at, 0, count);
+    lower.validate();
+    upper.validate();
+    expect_range(lower, 0, seam);
+    expect_range(upper, seam, count);
+
+    // Both halves are still valid trees
+    lower.insert({-1, -1});
+    upper.insert({count, count});
+    lower.erase(-1);
+    upper.erase(count);
+
+    lower.join(upper);
+    ASSERT_TRUE(upper.empty());
+    expect_range(lower, 0, count);
+  }
+}
+
+TEST(SplitJoinTest, SplitAndJoinBack) {
+  split_everywhere<TraitsMap<3>>(1000);
+  split_everywhere<TraitsMap<4>>(1000);
+  split_everywhere<TraitsMap<8>>(1000);
+  split_everywhere<TraitsMap<4, CountedTraits>>(1000);
+  split_everywhere<TraitsMap<4, IndexedTraits>>(1000);
+}
+
+TEST(SplitJoinTest, JoinUnevenHeights) {
+  for (int small : {0, 1, 3, 20}) {
+    TraitsMap<4, CountedTraits> big;
+    TraitsMap<4, CountedTraits> tiny;
+    for (int key = 0; key < 3000; ++key) {
+      big.insert({key, key});
+    }
+    for (int key = 3000; key < 3000 + small; ++key) {
+      tiny.insert({key, key});
+    }
+    big.join(tiny);
+    expect_range(big, 0, 3000 + small);
+    ASSERT_EQ(big.select(2999)->first, 2999);
+
+    // Lower keys on the joined side
+    TraitsMap<4, CountedTraits> prefix;
+    for (int key = -small; key < 0; ++key) {
+      prefix.insert({key, key});
+    }
+    prefix.join(big);
+    expect_range(prefix, -small, 3000 + small);
+    ASSERT_EQ(prefix.rank(0), static_cast<size_t>(small));
+  }
+}
+
+TEST(SplitJoinTest, JoinOverlapping) {
+  TraitsMap<4> left;
+  TraitsMap<4> right;
+  for (int key = 0; key < 100; ++key) {
+    left.insert({key, key});
+    right.insert({key + 50, key});
+  }
+  ASSERT_THROW(left.join(right), std::runtime_error);
+  ASSERT_EQ(left.size(), 100);
+  ASSERT_EQ(right.size(), 100);
+}
+
+TEST(SplitJoinTest, RandomShards) {
+  std::map<int, int> expected;
+  TraitsMap<5> tree;
+  std::mt19937 generator(5);
+  std::uniform_int_distribution<int> distribution(0, 100000);
+  for (int i = 0; i < 5000; ++i) {
+    auto key = distribution(generator);
+    tree.insert({key, key});
+    expected.insert({key, key});
+  }
+
+  for (int round = 0; round < 50; ++round) {
+    auto at = distribution(generator);
+    TraitsMap<5> shard;
+    tree.split(at, shard);
+    ASSERT_EQ(tree.size() + shard.size(), expected.size());
+    if (!shard.empty()) {
+      ASSERT_EQ(shard.begin()->first, expected.lower_bound(at)->first);
+    }
+    shard.join(tree);
+    ASSERT_TRUE(tree.empty());
+    tree.swap(shard);
+    ASSERT_TRUE(std::equal(tree.begin(), tree.end(), expected.begin(),
+                           expected.end()));
+  }
+}
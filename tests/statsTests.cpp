@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include "Map.hpp"
+
+#include <numeric>
+
+struct StatsTraits : DefaultTraits {
+  static constexpr bool collect_stats = true;
+};
+
+template <size_t M, typename Traits = DefaultTraits>
+using TraitsMap =
+    Map<M, int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+        Traits>;
+
+TEST(StatsTest, Structure) {
+  TraitsMap<4> tree;
+  ASSERT_EQ(tree.stats().height, 0);
+  for (int key = 0; key < 1000; ++key) {
+    tree.insert({key, key});
+  }
+
+  auto stats = tree.stats();
+  ASSERT_EQ(stats.size, 1000);
+  ASSERT_EQ(stats.height, stats.nodes_per_level.size());
+  ASSERT_EQ(stats.nodes_per_level.front(), 1);
+
+  const auto leaves = stats.nodes_per_level.back();
+  ASSERT_EQ(std::accumulate(stats.leaf_fill.begin(), stats.leaf_fill.end(),
+                            size_t{0}),
+            leaves);
+  ASSERT_GT(stats.leaf_bytes, 0);
+  ASSERT_GT(stats.internal_bytes, 0);
+  ASSERT_EQ(stats.value_bytes, 1000 * sizeof(std::pair<const int, int>));
+
+  // Counters are compiled out by default
+  ASSERT_EQ(stats.leaf_splits, 0);
+  ASSERT_EQ(stats.descents, 0);
+}
+
+TEST(StatsTest, Counters) {
+  TraitsMap<4, StatsTraits> tree;
+  for (int key = 0; key < 1000; ++key) {
+    tree.insert({key, key});
+  }
+
+  auto stats = tree.stats();
+  ASSERT_EQ(stats.descents, 1000);
+  // Every leaf but the first one comes from a split
+  ASSERT_EQ(stats.leaf_splits + 1, stats.nodes_per_level.back());
+  ASSERT_EQ(stats.internal_splits + stats.height - 1,
+            std::accumulate(stats.nodes_per_level.begin(),
+                            stats.nodes_per_level.end() - 1, size_t{0}));
+
+  tree.reset_stats();
+  for (int key = 0; key < 100; ++key) {
+    ASSERT_TRUE(tree.contains(key));
+  }
+  stats = tree.stats();
+  ASSERT_EQ(stats.lookups, 100);
+  ASSERT_EQ(stats.descents, 100);
+  ASSERT_GE(stats.comparisons_per_lookup(), static_cast<double>(stats.height));
+
+  for (int key = 0; key < 1000; ++key) {
+    tree.erase(key);
+  }
+  stats = tree.stats();
+  ASSERT_GT(stats.leaf_merges, 0);
+  ASSERT_GT(stats.internal_merges, 0);
+  ASSERT_EQ(stats.height, 0);
+}
+
+TEST(StatsTest, DisabledCountersTakeNoSpace) {
+  ASSERT_EQ(sizeof(TraitsMap<4>) + sizeof(OperationCounters),
+            sizeof(TraitsMap<4, StatsTraits>));
+}